@@ -7,7 +7,9 @@
 #include <iris/arch/x86/amd64/idt.h>
 #include <iris/arch/x86/amd64/io_instructions.h>
 #include <iris/arch/x86/amd64/msr.h>
+#include <iris/arch/x86/amd64/page_fault.h>
 #include <iris/arch/x86/amd64/segment_descriptor.h>
+#include <iris/arch/x86/amd64/system_call.h>
 #include <iris/arch/x86/amd64/system_instructions.h>
 #include <iris/arch/x86/amd64/system_segment_descriptor.h>
 #include <iris/arch/x86/amd64/tss.h>
@@ -28,6 +30,7 @@
 #include <iris/mm/address_space.h>
 #include <iris/mm/map_physical_address.h>
 #include <iris/mm/page_frame_allocator.h>
+#include <iris/mm/page_operations.h>
 #include <iris/mm/sections.h>
 #include <iris/uapi/syscall.h>
 
@@ -46,6 +49,7 @@ extern "C" void bsp_cpu_init() {
 
     global_state.processor_info = detect_processor_info();
     global_state.processor_info.print_to_console();
+    mm::init_page_operations();
 
     global_state.boot_processor.arch_processor().enable_cpu_features();
 
@@ -53,27 +57,13 @@ extern "C" void bsp_cpu_init() {
     global_state.current_processor_available = true;
 
     x86::amd64::idt::init_idt();
+    x86::amd64::init_page_fault_handler();
 
     x86::amd64::init_tss();
     x86::amd64::init_gdt();
 
     set_current_processor(global_state.boot_processor);
-
-    // Setup the page fault handler.
-    *register_exception_handler(GlobalIrqNumber(14), [](IrqContext& context) -> IrqStatus {
-        auto instruction_pointer = mm::VirtualAddress(context.task_state.rip);
-        auto address = mm::VirtualAddress(x86::amd64::read_cr2());
-
-        if (instruction_pointer == kernel_userspace_copy_instruction) {
-            context.task_state.set_instruction_pointer(kernel_userspace_copy_return.raw_value());
-            context.task_state.rax = di::to_underlying(Error::BadAddress);
-            return IrqStatus::Handled;
-        }
-
-        println("ERROR: Unexpected page fault: ip={}, address={}"_sv, instruction_pointer, address);
-        ASSERT(false);
-        return IrqStatus::Handled;
-    });
+    x86::amd64::init_system_calls();
 
     iris_main();
 }
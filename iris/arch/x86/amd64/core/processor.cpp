@@ -58,6 +58,29 @@ void ArchProcessor::enable_cpu_features(bool print_info) {
         }
         x86::amd64::load_cr4(x86::amd64::read_cr4() | (1 << 16));
     }
+
+    if (global_state.processor_info.has_pcid()) {
+        if (print_info) {
+            iris::println("Enabling PCID..."_sv);
+        }
+        x86::amd64::load_cr4(x86::amd64::read_cr4() | (1 << 17));
+    }
+}
+
+PcidAssignment ArchProcessor::assign_pcid(u64 address_space_id, u64 tlb_generation) {
+    for (auto [i, slot] : di::enumerate(m_pcid_slots)) {
+        if (slot.address_space_id == address_space_id) {
+            auto stale = slot.tlb_generation != tlb_generation;
+            slot.tlb_generation = tlb_generation;
+            return { u16(i + 1), stale };
+        }
+    }
+
+    // Evict slots in round-robin order. The evicted address space's translations are flushed when the PCID is loaded.
+    auto index = m_next_pcid_slot;
+    m_next_pcid_slot = (m_next_pcid_slot + 1) % pcid_slot_count;
+    m_pcid_slots[index] = { address_space_id, tlb_generation };
+    return { u16(index + 1), true };
 }
 }
 
@@ -66,10 +89,23 @@ void Processor::flush_tlb_local() {
     x86::amd64::load_cr3(x86::amd64::read_cr3());
 }
 
-void Processor::flush_tlb_local(mm::VirtualAddress base, usize byte_length) {
-    auto num_pages = di::divide_round_up(base.raw_value() % 4096 + byte_length, 4096);
-    for (auto address : di::iota(base) | di::take(num_pages)) {
-        x86::amd64::invlpg(address);
+void Processor::flush_tlb_local(mm::TlbFlushBatch const& batch) {
+    // With PCIDs enabled, invlpg and reloading cr3 only affect the current context. Kernel mappings may be cached under
+    // every PCID, so they must be invalidated in all contexts.
+    if (batch.kernel() && global_state().processor_info.has_pcid()) {
+        x86::amd64::invpcid(x86::amd64::InvpcidType::AllContexts);
+        return;
+    }
+
+    if (batch.flush_everything()) {
+        flush_tlb_local();
+        return;
+    }
+
+    for (auto const& range : batch.ranges()) {
+        for (auto i : di::range(range.page_count)) {
+            x86::amd64::invlpg(range.base + i * 4096);
+        }
     }
 }
 }
@@ -7,8 +7,8 @@
 namespace iris::arch {
 TaskState::TaskState(bool userspace) {
     if (userspace) {
-        ss = 8 * 8 + 3;
-        cs = 7 * 8 + 3;
+        ss = 7 * 8 + 3;
+        cs = 8 * 8 + 3;
         rflags = interrupt_enable_flag | 2;
     } else {
         ss = 0 * 8 + 0;
@@ -51,7 +51,24 @@ TaskState::TaskState(bool userspace) {
                  "iretq\n");
 }
 
+[[gnu::naked]] void switch_to_kernel_context(uptr) {
+    // The stack pointer is passed in the %rdi register. This pops the registers in the reverse order that
+    // Scheduler::yield() pushed them, and then returns to its caller.
+    asm volatile("movq %rdi, %rsp\n"
+                 "popfq\n"
+                 "popq %r15\n"
+                 "popq %r14\n"
+                 "popq %r13\n"
+                 "popq %r12\n"
+                 "popq %rbx\n"
+                 "popq %rbp\n"
+                 "retq\n");
+}
+
 FpuState::~FpuState() {
+    if (m_loaded_on) {
+        m_loaded_on->forget_fpu_owner(*this);
+    }
     if (fpu_state) {
         ::operator delete(fpu_state, global_state().processor_info.fpu_max_state_size, std::align_val_t { 64 });
     }
@@ -88,25 +105,39 @@ Expected<di::Byte*> FpuState::allocate_fpu_state() {
 }
 
 void FpuState::load() {
-    if (fpu_state) {
-        if (global_state().processor_info.has_xsave()) {
-            // NOTE: modern processors may have optimized versions of these instructions for use in the kernel.
-            x86::amd64::xrstor(fpu_state);
-        } else {
-            x86::amd64::fxrstor(fpu_state);
-        }
+    if (!fpu_state) {
+        return;
     }
+
+    // SAFETY: This is safe since interrupts are disabled.
+    auto& processor = current_processor_unsafe().arch_processor();
+    if (m_loaded_on == &processor && processor.fpu_owner() == this) {
+        return;
+    }
+
+    if (global_state().processor_info.has_xsave()) {
+        x86::amd64::xrstor(fpu_state);
+    } else {
+        x86::amd64::fxrstor(fpu_state);
+    }
+    m_loaded_on = &processor;
+    processor.set_fpu_owner(this);
 }
 
 void FpuState::save() {
-    if (fpu_state) {
-        if (global_state().processor_info.has_xsave()) {
-            // NOTE: modern processors may have optimized versions of these instructions for use in the kernel. Such as:
-            //       xsaveopt.
-            x86::amd64::xsave(fpu_state);
-        } else {
-            x86::amd64::fxsave(fpu_state);
-        }
+    if (!fpu_state) {
+        return;
+    }
+
+    // NOTE: xsaveopt relies on the buffer being unchanged since the last xrstor from it. This holds because the buffer
+    //       is only ever written by saving the registers, and a state is always loaded before it runs on a processor.
+    auto const& processor_info = global_state().processor_info;
+    if (processor_info.has_xsaveopt()) {
+        x86::amd64::xsaveopt(fpu_state);
+    } else if (processor_info.has_xsave()) {
+        x86::amd64::xsave(fpu_state);
+    } else {
+        x86::amd64::fxsave(fpu_state);
     }
 }
 }
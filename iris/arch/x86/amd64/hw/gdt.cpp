@@ -70,14 +70,15 @@ void init_gdt() {
     gdt[6] = SegmentDescriptor(LimitLow(0xFFFF), Writable(true), DataOrCodeSegment(true), Present(true), LimitHigh(0xF),
                                Not16Bit(true), Granular(true));
 
+    // 64 bit User Data Descriptor. This must come right before the user code descriptor, since sysretq derives both
+    // selectors from the STAR MSR.
+    gdt[7] = SegmentDescriptor(LimitLow(0xFFFF), Writable(true), DataOrCodeSegment(true), DPL(3), Present(true),
+                               LimitHigh(0xF), Not16Bit(true), Granular(true));
+
     // 64 bit User Code Descriptor.
-    gdt[7] = SegmentDescriptor(LimitLow(0xFFFF), Readable(true), Code(true), DataOrCodeSegment(true), DPL(3),
+    gdt[8] = SegmentDescriptor(LimitLow(0xFFFF), Readable(true), Code(true), DataOrCodeSegment(true), DPL(3),
                                Present(true), LimitHigh(0xF), LongMode(true), Granular(true));
 
-    // 64 bit User Data Descriptor.
-    gdt[8] = SegmentDescriptor(LimitLow(0xFFFF), Writable(true), DataOrCodeSegment(true), DPL(3), Present(true),
-                               LimitHigh(0xF), Not16Bit(true), Granular(true));
-
     auto gdtr = iris::x86::amd64::GDTR { sizeof(gdt) - 1, di::to_uintptr(gdt.data()) };
     iris::x86::amd64::load_gdt(gdtr);
 
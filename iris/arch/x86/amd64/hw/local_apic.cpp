@@ -6,6 +6,7 @@
 #include <iris/arch/x86/amd64/idt.h>
 #include <iris/arch/x86/amd64/io_instructions.h>
 #include <iris/arch/x86/amd64/msr.h>
+#include <iris/arch/x86/amd64/system_call.h>
 #include <iris/arch/x86/amd64/system_instructions.h>
 #include <iris/arch/x86/amd64/tss.h>
 #include <iris/core/global_state.h>
@@ -17,86 +18,143 @@
 
 namespace iris {
 void Processor::handle_pending_ipi_messages() {
-    // This takes the lock, and then empties the queue into a local variable.
-    auto messages = m_ipi_message_queue.with_lock([](auto& queue) {
-        auto result = di::move(queue);
-        queue.clear();
-        return result;
-    });
+    auto messages = m_ipi_inbox.take();
 
-    for (auto* message : messages) {
-        if (message->tlb_flush_size > 0) {
-            // NOTE: the caller is responsible for freeing the message.
-            flush_tlb_local(message->tlb_flush_base, message->tlb_flush_size);
-            message->times_processed.fetch_add(1, di::MemoryOrder::Release);
+    auto const& global_state = iris::global_state();
+    for (auto [index, senders] : di::enumerate(messages.tlb_flush_senders)) {
+        while (senders) {
+            auto sender_id = u32(index * 64 + usize(di::countr_zero(senders)));
+            senders &= senders - 1;
+
+            // NOTE: the sender waits until every target has processed its request.
+            auto& request = (*global_state.processor_map.at(sender_id))->m_tlb_flush_request;
+            flush_tlb_local(request.batch);
+            request.remaining.fetch_sub(1, di::MemoryOrder::Release);
         }
+    }
 
-        if (message->task_to_schedule != nullptr) {
-            // NOTE: we are responsible for freeing the message.
-            scheduler().schedule_task(*message->task_to_schedule);
-
-            global_state().ipi_message_pool.lock()->deallocate(*message);
+    auto drain_requested = false;
+    for (auto [index, senders] : di::enumerate(messages.page_frame_cache_drain_senders)) {
+        while (senders) {
+            auto sender_id = u32(index * 64 + usize(di::countr_zero(senders)));
+            senders &= senders - 1;
+
+            // A single drain satisfies every sender, since the cache is empty afterwards.
+            if (!di::exchange(drain_requested, true)) {
+                m_page_frame_cache.drain();
+            }
+            auto& sender = **global_state.processor_map.at(sender_id);
+            sender.m_page_frame_cache_drains_remaining.fetch_sub(1, di::MemoryOrder::Release);
         }
     }
+
+    for (auto* task = messages.tasks_to_schedule; task;) {
+        // Read the next task first, since the task may start running on another processor once it is scheduled.
+        auto* next = task->next_in_ipi_inbox();
+        scheduler().schedule_task(*task);
+        task = next;
+    }
 }
 
-void Processor::send_ipi(u32 target_processor_id, di::FunctionRef<void(IpiMessage&)> factory) {
+static void send_ipi(x86::amd64::LocalApic& local_apic, x86::amd64::ApicInterruptCommandRegister command) {
+    while (local_apic.interrupt_command_register().get<x86::amd64::ApicInterruptCommandDeliveryStatus>()) {
+        x86::amd64::io_wait_us(20);
+    }
+    local_apic.write_interrupt_command_register(command);
+}
+
+static void send_ipi(x86::amd64::LocalApic& local_apic, u32 target_processor_id) {
     ASSERT(di::math::representable_as<u8>(target_processor_id));
-    auto processor_id = static_cast<u8>(target_processor_id);
+    send_ipi(local_apic,
+             x86::amd64::ApicInterruptCommandRegister(x86::amd64::ApicInterruptCommandVector(63),
+                                                      x86::amd64::ApicInterruptCommandDestination(target_processor_id)));
+}
 
-    // Find the target processor.
-    auto const& global_state = iris::global_state();
-    auto* target_processor = *global_state.processor_map.at(processor_id);
+void Processor::send_task_to_schedule(u32 target_processor_id, Task& task) {
+    auto* target_processor = *global_state().processor_map.at(target_processor_id);
+    if (target_processor->m_ipi_inbox.post_task_to_schedule(task)) {
+        send_ipi(arch_processor().local_apic(), target_processor_id);
+    }
+}
 
-    // Get IPI message from global object pool.
-    auto& message = *global_state.ipi_message_pool.lock()->allocate();
+void Processor::send_tlb_flush(di::FunctionRef<bool(Processor&)> filter, mm::TlbFlushBatch const& batch) {
+    ASSERT_EQ(m_tlb_flush_request.remaining.load(di::MemoryOrder::Relaxed), 0u);
+    m_tlb_flush_request.batch = batch;
+
+    // Count each target before posting to it, so that the count never drops to zero early.
+    auto& local_apic = arch_processor().local_apic();
+    for (auto [id, processor] : global_state().processor_map) {
+        if (processor == this || !filter(*processor)) {
+            continue;
+        }
+        m_tlb_flush_request.remaining.fetch_add(1, di::MemoryOrder::Relaxed);
+        if (processor->m_ipi_inbox.post_tlb_flush(m_id)) {
+            send_ipi(local_apic, id);
+        }
+    }
 
-    factory(message);
+    while (m_tlb_flush_request.remaining.load(di::MemoryOrder::Acquire) != 0) {
+        di::cpu_relax();
+    }
+}
 
-    // Add the message to the target's queue.
-    *target_processor->m_ipi_message_queue.lock()->push(&message);
+void Processor::drain_remote_page_frame_caches() {
+    ASSERT_EQ(m_page_frame_cache_drains_remaining.load(di::MemoryOrder::Relaxed), 0u);
 
-    // Send the IPI.
     auto& local_apic = arch_processor().local_apic();
-    while (local_apic.interrupt_command_register().get<x86::amd64::ApicInterruptCommandDeliveryStatus>()) {
-        x86::amd64::io_wait_us(20);
+    for (auto [id, processor] : global_state().processor_map) {
+        if (processor == this) {
+            continue;
+        }
+        m_page_frame_cache_drains_remaining.fetch_add(1, di::MemoryOrder::Relaxed);
+        if (processor->m_ipi_inbox.post_page_frame_cache_drain(m_id)) {
+            send_ipi(local_apic, id);
+        }
+    }
+
+    while (m_page_frame_cache_drains_remaining.load(di::MemoryOrder::Acquire) != 0) {
+        di::cpu_relax();
     }
-    local_apic.write_interrupt_command_register(x86::amd64::ApicInterruptCommandRegister(
-        x86::amd64::ApicInterruptCommandVector(63), x86::amd64::ApicInterruptCommandDestination(target_processor_id)));
 }
 
-void Processor::broadcast_ipi(di::FunctionRef<void(IpiMessage&)> factory) {
-    // Get IPI message from global object pool.
-    auto& message = *iris::global_state().ipi_message_pool.lock()->allocate();
+void Processor::broadcast_tlb_flush(mm::TlbFlushBatch const& batch) {
+    ASSERT_EQ(m_tlb_flush_request.remaining.load(di::MemoryOrder::Relaxed), 0u);
+    m_tlb_flush_request.batch = batch;
 
-    factory(message);
+    // Post the request to every processor first. When all of them need to be interrupted, a single IPI reaches them.
+    auto const& processor_map = global_state().processor_map;
+    auto target_count = u32(processor_map.size() - 1);
+    m_tlb_flush_request.remaining.store(target_count, di::MemoryOrder::Relaxed);
 
-    // Add the message each processor's queue.
-    auto count = 0_u32;
-    for (auto [_, processor] : iris::global_state().processor_map) {
+    auto targets_to_interrupt = di::Array<u64, IpiInbox::max_processors / 64> {};
+    auto interrupt_count = 0_u32;
+    for (auto [id, processor] : processor_map) {
         if (processor == this) {
             continue;
         }
-        *processor->m_ipi_message_queue.lock()->push(&message);
-        count++;
+        if (processor->m_ipi_inbox.post_tlb_flush(m_id)) {
+            targets_to_interrupt[id / 64] |= 1_u64 << (id % 64);
+            interrupt_count++;
+        }
     }
 
-    // Send the IPI.
     auto& local_apic = arch_processor().local_apic();
-    while (local_apic.interrupt_command_register().get<x86::amd64::ApicInterruptCommandDeliveryStatus>()) {
-        x86::amd64::io_wait_us(20);
+    if (interrupt_count == target_count) {
+        send_ipi(local_apic, x86::amd64::ApicInterruptCommandRegister(
+                                 x86::amd64::ApicInterruptCommandVector(63),
+                                 x86::amd64::ApicInterruptCommandDestinationShorthand(
+                                     x86::amd64::ApicDestinationShorthand::AllExcludingSelf)));
+    } else if (interrupt_count > 0) {
+        for (auto [id, _] : processor_map) {
+            if (targets_to_interrupt[id / 64] & (1_u64 << (id % 64))) {
+                send_ipi(local_apic, id);
+            }
+        }
     }
-    local_apic.write_interrupt_command_register(x86::amd64::ApicInterruptCommandRegister(
-        x86::amd64::ApicInterruptCommandVector(63),
-        x86::amd64::ApicInterruptCommandDestinationShorthand(x86::amd64::ApicDestinationShorthand::AllExcludingSelf)));
 
-    // Wait for the message to be processed by all processors.
-    while (message.times_processed.load(di::MemoryOrder::Acquire) != count) {
+    while (m_tlb_flush_request.remaining.load(di::MemoryOrder::Acquire) != 0) {
         di::cpu_relax();
     }
-
-    // Return the message to the pool.
-    iris::global_state().ipi_message_pool.lock()->deallocate(message);
 }
 }
 
@@ -121,7 +179,8 @@ private:
     friend di::StringView tag_invoke(di::Tag<timer_name>, LocalApicTimer const&) { return "APIC"_sv; }
 
     friend TimerCapabilities tag_invoke(di::Tag<timer_capabilities>, LocalApicTimer const&) {
-        return TimerCapabilities::Periodic | TimerCapabilities::NeedsCalibration | TimerCapabilities::PerCpu;
+        return TimerCapabilities::SingleShot | TimerCapabilities::Periodic | TimerCapabilities::NeedsCalibration |
+               TimerCapabilities::PerCpu;
     }
 
     friend TimerResolution tag_invoke(di::Tag<timer_resolution>, LocalApicTimer const& self) {
@@ -145,13 +204,75 @@ private:
 
         // Set the APIC timer to count down from the calculated number of ticks.
         local_apic.write_timer_divide_configuration(ApicTimerDivideConfiguration::DivideBy2);
-        local_apic.write_lvt_entry(ApicOffset::TimerLvtEntry,
-                                   ApicLvtEntry(ApicLvtEntryVector(62), ApicLvtEntryTimerMode(true)));
+        local_apic.write_lvt_entry(
+            ApicOffset::TimerLvtEntry,
+            ApicLvtEntry(ApicLvtEntryVector(62), ApicLvtEntryTimerMode(ApicTimerMode::Periodic)));
         local_apic.write_timer_initial_count(ticks);
 
         return {};
     }
 
+    friend Expected<void> tag_invoke(di::Tag<timer_set_single_shot>, LocalApicTimer& self, TimerResolution duration,
+                                     di::Function<void(IrqContext&)> callback) {
+        ASSERT(interrupts_disabled());
+
+        // SAFETY: interrupts are disabled.
+        auto& processor = current_processor_unsafe();
+        auto& local_apic = processor.arch_processor().local_apic();
+
+        processor.arch_processor().set_local_apic_callback(di::move(callback));
+
+        auto mode = self.m_use_tsc_deadline ? ApicTimerMode::TscDeadline : ApicTimerMode::OneShot;
+        local_apic.write_timer_divide_configuration(ApicTimerDivideConfiguration::DivideBy2);
+        local_apic.write_lvt_entry(ApicOffset::TimerLvtEntry,
+                                   ApicLvtEntry(ApicLvtEntryVector(62), ApicLvtEntryTimerMode(mode)));
+
+        // The write to the LVT entry must complete before writing the deadline MSR, or the deadline may be ignored.
+        if (self.m_use_tsc_deadline) {
+            asm volatile("mfence" ::: "memory");
+        }
+
+        return self.restart(local_apic, duration);
+    }
+
+    friend Expected<void> tag_invoke(di::Tag<timer_restart_single_shot>, LocalApicTimer& self,
+                                     TimerResolution duration) {
+        ASSERT(interrupts_disabled());
+
+        // SAFETY: interrupts are disabled.
+        return self.restart(current_processor_unsafe().arch_processor().local_apic(), duration);
+    }
+
+    friend Expected<void> tag_invoke(di::Tag<timer_stop>, LocalApicTimer& self) {
+        ASSERT(interrupts_disabled());
+
+        // Writing 0 to either the deadline or the initial count disarms the timer.
+        if (self.m_use_tsc_deadline) {
+            write_msr(ModelSpecificRegister::TscDeadline, 0);
+        } else {
+            // SAFETY: interrupts are disabled.
+            current_processor_unsafe().arch_processor().local_apic().write_timer_initial_count(0);
+        }
+        return {};
+    }
+
+    Expected<void> restart(LocalApic& local_apic, TimerResolution duration) {
+        // In TSC-deadline mode, the timer fires once the time stamp counter reaches an absolute value. This is cheaper
+        // to program than the count down, and is not limited to 32 bits.
+        if (m_use_tsc_deadline) {
+            // Long durations overflow 64 bits when scaled, so compute in 128 bits and clamp the deadline instead.
+            auto now = rdtsc();
+            auto cycles = u128(u64(di::max(duration.count(), 0_i64)) / 1000) * m_tsc_cycles_per_ms / 1'000'000;
+            cycles = di::clamp(cycles, u128(1), u128(di::NumericLimits<u64>::max - now));
+            write_msr(ModelSpecificRegister::TscDeadline, now + u64(cycles));
+            return {};
+        }
+
+        auto ticks = di::clamp(u64(duration / m_resolution), 1_u64, u64(di::NumericLimits<u32>::max));
+        local_apic.write_timer_initial_count(u32(ticks));
+        return {};
+    }
+
     friend Expected<void> tag_invoke(di::Tag<timer_calibrate>, LocalApicTimer& self) {
         ASSERT(interrupts_disabled());
 
@@ -169,10 +290,17 @@ private:
         local_apic.write_lvt_entry(ApicOffset::TimerLvtEntry, ApicLvtEntry(ApicLvtEntryVector(62)));
         local_apic.write_timer_initial_count(0xFFFFFFFF);
 
-        // Now set the reference timer to fire in 50 ms.
-        auto new_ticks = 0xFFFFFFFF_u32;
-        *timer_set_single_shot(*calibration_timer.lock(), 50_ms, [&](IrqContext&) {
-            new_ticks = local_apic.timer_current_count();
+        // Now set the reference timer to fire in 50 ms. The time stamp counter is measured at the same time, since it
+        // is needed to program TSC deadlines.
+        struct Measurement {
+            u32 ticks { 0xFFFFFFFF };
+            u64 tsc { 0 };
+        };
+        auto measurement = Measurement {};
+        auto start_tsc = rdtsc();
+        *timer_set_single_shot(*calibration_timer.lock(), 50_ms, [&measurement, &local_apic](IrqContext&) {
+            measurement.ticks = local_apic.timer_current_count();
+            measurement.tsc = rdtsc();
 
             // Disable the APIC timer.
             local_apic.write_lvt_entry(ApicOffset::TimerLvtEntry,
@@ -191,16 +319,27 @@ private:
         // Calculate the resolution.
         // NOTE: picoseconds are used because modern CPUs have a frequency larger than 1 GHz. They thus have
         // sub-nanosecond resolution.
-        auto ticks = 0xFFFFFFFF_u32 - new_ticks;
+        auto ticks = 0xFFFFFFFF_u32 - measurement.ticks;
         self.m_resolution = di::Picoseconds(50_ms) / ticks;
 
         println("APIC timer resolution: {} ps. {} ticks elapsed. Waited for {} ps."_sv, self.m_resolution.count(),
                 ticks, di::Picoseconds(50_ms).count());
 
+        // The TSC also backs the monotonic clock.
+        auto& global_state = global_state_in_boot();
+        self.m_tsc_cycles_per_ms = u32((measurement.tsc - start_tsc) / 50);
+        self.m_use_tsc_deadline = global_state.processor_info.has_tsc_deadline() && self.m_tsc_cycles_per_ms != 0;
+        global_state.boot_cycle_counter = measurement.tsc;
+        global_state.cycle_counter_cycles_per_ms = self.m_tsc_cycles_per_ms;
+        println("APIC timer TSC deadline mode: {}. {} TSC cycles per ms."_sv, self.m_use_tsc_deadline,
+                self.m_tsc_cycles_per_ms);
+
         return {};
     }
 
     di::Picoseconds m_resolution;
+    u32 m_tsc_cycles_per_ms { 0 };
+    bool m_use_tsc_deadline { false };
 };
 
 static_assert(di::Impl<LocalApicTimer, TimerInterface>);
@@ -378,6 +517,7 @@ extern "C" void iris_ap_entry(ApBootInfo* info_in) {
     init_gdt();
 
     set_current_processor(*info.processor);
+    init_system_calls();
 
     info.processor->arch_processor().setup_fpu_support_for_processor(false);
 
@@ -490,9 +630,6 @@ void init_alternative_processors() {
 
     *global_state.processor_map.try_emplace(global_state.boot_processor.id(), &global_state.boot_processor);
 
-    auto message_pool = *ObjectPool<IpiMessage>::create(256);
-    global_state.ipi_message_pool.get_assuming_no_concurrent_accesses() = di::move(message_pool);
-
     auto count = 0_u32;
     for (auto const& local_apic : global_state.acpi_info->local_apic) {
         if (local_apic.apic_id == global_state.boot_processor.arch_processor().local_apic().id()) {
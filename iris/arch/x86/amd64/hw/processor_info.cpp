@@ -16,7 +16,9 @@ namespace cpuid {
     enum class FamilyFlagsEcx {
         Avx = (1 << 28),
         Xsave = (1 << 26),
+        TscDeadline = (1 << 24),
         X2Apic = (1 << 21),
+        Pcid = (1 << 17),
         Sse4_2 = (1 << 20),
         Sse4_1 = (1 << 19),
         Ssse3 = (1 << 9),
@@ -39,7 +41,9 @@ namespace cpuid {
     /// Corresponds to leaf ebx for [EAX=0000_00007h](https://sandpile.org/x86/cpuid.htm#level_0000_0007h).
     enum class FeatureFlagsEbx : u32 {
         Smap = (1 << 20),
+        Invpcid = (1 << 10),
         Avx512Foundations = (1 << 16),
+        Erms = (1 << 9),
         Smep = (1 << 7),
         Avx2 = (1 << 5),
         FsGsBase = (1 << 0),
@@ -54,6 +58,13 @@ namespace cpuid {
 
     DI_DEFINE_ENUM_BITWISE_OPERATIONS(ExtendedFeatureFlagsEdx)
 
+    /// Corresponds to leaf eax for [EAX=0000_000Dh, ECX=1h](https://sandpile.org/x86/cpuid.htm#level_0000_000Dh).
+    enum class ExtendedStateFlagsEax {
+        XsaveOpt = (1 << 0),
+    };
+
+    DI_DEFINE_ENUM_BITWISE_OPERATIONS(ExtendedStateFlagsEax)
+
     struct Result {
         u32 eax;
         u32 ebx;
@@ -94,7 +105,10 @@ ProcessorInfo detect_processor_info() {
 
     auto supports_avx = !!(cpuid::FamilyFlagsEcx(family_and_flags_result.ecx) & cpuid::FamilyFlagsEcx::Avx);
     auto supports_xsave = !!(cpuid::FamilyFlagsEcx(family_and_flags_result.ecx) & cpuid::FamilyFlagsEcx::Xsave);
+    auto supports_tsc_deadline =
+        !!(cpuid::FamilyFlagsEcx(family_and_flags_result.ecx) & cpuid::FamilyFlagsEcx::TscDeadline);
     auto supports_x2apic = !!(cpuid::FamilyFlagsEcx(family_and_flags_result.ecx) & cpuid::FamilyFlagsEcx::X2Apic);
+    auto supports_pcid = !!(cpuid::FamilyFlagsEcx(family_and_flags_result.ecx) & cpuid::FamilyFlagsEcx::Pcid);
     auto supports_sse4_2 = !!(cpuid::FamilyFlagsEcx(family_and_flags_result.ecx) & cpuid::FamilyFlagsEcx::Sse4_2);
     auto supports_sse4_1 = !!(cpuid::FamilyFlagsEcx(family_and_flags_result.ecx) & cpuid::FamilyFlagsEcx::Sse4_1);
     auto supports_ssse3 = !!(cpuid::FamilyFlagsEcx(family_and_flags_result.ecx) & cpuid::FamilyFlagsEcx::Ssse3);
@@ -111,6 +125,8 @@ ProcessorInfo detect_processor_info() {
     auto supports_fs_gs_base = !!(cpuid::FeatureFlagsEbx(feature_flags_result.ebx) & cpuid::FeatureFlagsEbx::FsGsBase);
     auto supports_smep = !!(cpuid::FeatureFlagsEbx(feature_flags_result.ebx) & cpuid::FeatureFlagsEbx::Smep);
     auto supports_smap = !!(cpuid::FeatureFlagsEbx(feature_flags_result.ebx) & cpuid::FeatureFlagsEbx::Smap);
+    auto supports_invpcid = !!(cpuid::FeatureFlagsEbx(feature_flags_result.ebx) & cpuid::FeatureFlagsEbx::Invpcid);
+    auto supports_erms = !!(cpuid::FeatureFlagsEbx(feature_flags_result.ebx) & cpuid::FeatureFlagsEbx::Erms);
     auto supports_avx2 = !!(cpuid::FeatureFlagsEbx(feature_flags_result.ebx) & cpuid::FeatureFlagsEbx::Avx2);
     auto supports_avx512 =
         !!(cpuid::FeatureFlagsEbx(feature_flags_result.ebx) & cpuid::FeatureFlagsEbx::Avx512Foundations);
@@ -121,6 +137,7 @@ ProcessorInfo detect_processor_info() {
 
     auto valid_xcr0 = 0_u64;
     auto fpu_max_size = 512_u32;
+    auto supports_xsaveopt = false;
 
     // If the processor supports xsave, then the FPU size is dynamic. Otherwise, it is 512 bytes.
     if (supports_xsave) {
@@ -139,6 +156,12 @@ ProcessorInfo detect_processor_info() {
         }
     }
 
+    if (supports_xsave) {
+        auto extended_state_flags_result = cpuid::query(cpuid::Function::GetExtendedState, 1);
+        supports_xsaveopt = !!(cpuid::ExtendedStateFlagsEax(extended_state_flags_result.eax) &
+                               cpuid::ExtendedStateFlagsEax::XsaveOpt);
+    }
+
     auto features = ProcessorFeatures::None;
     if (supports_smep) {
         features |= ProcessorFeatures::Smep;
@@ -161,9 +184,15 @@ ProcessorInfo detect_processor_info() {
     if (supports_xsave) {
         features |= ProcessorFeatures::Xsave;
     }
+    if (supports_xsaveopt) {
+        features |= ProcessorFeatures::XsaveOpt;
+    }
     if (supports_x2apic) {
         features |= ProcessorFeatures::X2Apic;
     }
+    if (supports_tsc_deadline) {
+        features |= ProcessorFeatures::TscDeadline;
+    }
     if (supports_sse4_2) {
         features |= ProcessorFeatures::Sse4_2;
     }
@@ -196,6 +225,15 @@ ProcessorInfo detect_processor_info() {
     if (supports_gib_pages) {
         features |= ProcessorFeatures::GibPages;
     }
+    if (supports_pcid) {
+        features |= ProcessorFeatures::Pcid;
+    }
+    if (supports_invpcid) {
+        features |= ProcessorFeatures::Invpcid;
+    }
+    if (supports_erms) {
+        features |= ProcessorFeatures::Erms;
+    }
 
     return { features, fpu_max_size, valid_xcr0, processor_vendor_string };
 }
@@ -235,6 +273,9 @@ void ProcessorInfo::print_to_console() {
     if (!!(features & ProcessorFeatures::Xsave)) {
         println("Detected feature: {}"_sv, "xsave"_sv);
     }
+    if (!!(features & ProcessorFeatures::XsaveOpt)) {
+        println("Detected feature: {}"_sv, "xsaveopt"_sv);
+    }
     if (!!(features & ProcessorFeatures::Avx)) {
         println("Detected feature: {}"_sv, "avx"_sv);
     }
@@ -253,8 +294,20 @@ void ProcessorInfo::print_to_console() {
     if (!!(features & ProcessorFeatures::Apic)) {
         println("Detected feature: {}"_sv, "apic"_sv);
     }
+    if (!!(features & ProcessorFeatures::TscDeadline)) {
+        println("Detected feature: {}"_sv, "tsc_deadline"_sv);
+    }
     if (!!(features & ProcessorFeatures::GibPages)) {
         println("Detected feature: {}"_sv, "gibpages"_sv);
     }
+    if (!!(features & ProcessorFeatures::Pcid)) {
+        println("Detected feature: {}"_sv, "pcid"_sv);
+    }
+    if (!!(features & ProcessorFeatures::Invpcid)) {
+        println("Detected feature: {}"_sv, "invpcid"_sv);
+    }
+    if (!!(features & ProcessorFeatures::Erms)) {
+        println("Detected feature: {}"_sv, "erms"_sv);
+    }
 }
 }
@@ -0,0 +1,137 @@
+#include <iris/arch/x86/amd64/msr.h>
+#include <iris/arch/x86/amd64/system_call.h>
+#include <iris/core/global_state.h>
+#include <iris/core/interrupt_disabler.h>
+#include <iris/uapi/syscall.h>
+
+namespace iris::x86::amd64 {
+constexpr auto kernel_code_selector = 5_u64 * 8;
+constexpr auto user_data_selector = 7_u64 * 8 + 3;
+constexpr auto user_code_selector = 8_u64 * 8 + 3;
+
+// sysretq loads the user data selector from this base + 8, and the user code selector from this base + 16.
+constexpr auto sysret_selector_base = user_data_selector - 8;
+
+// The trap, interrupt enable, direction and alignment check flags are cleared on entry.
+constexpr auto system_call_flag_mask = (1_u64 << 8) | (1_u64 << 9) | (1_u64 << 10) | (1_u64 << 18);
+
+// The offsets of the members of arch::ProcessorEntryState from the GS base.
+constexpr auto kernel_stack_offset = arch::processor_entry_state_offset;
+constexpr auto user_stack_offset = arch::processor_entry_state_offset + sizeof(uptr);
+
+// sysretq faults in kernel mode when returning to a non-canonical address, so such returns must use iretq instead.
+constexpr auto max_user_address = 0x0000'8000'0000'0000_u64;
+
+// Returns whether the task can return to userspace using sysretq.
+extern "C" bool system_call_handler(arch::TaskState& task_state) {
+    ASSERT(interrupts_disabled());
+
+    // SAFETY: this is safe since interrupts are disabled.
+    auto& current_task = current_processor_unsafe().scheduler().current_task();
+
+    raw_enable_interrupts();
+    auto result = do_syscall(current_task, task_state);
+    task_state.set_syscall_return(result);
+    raw_disable_interrupts();
+
+    arch::load_userspace_thread_pointer(current_task.userspace_thread_pointer(), task_state);
+
+    // sysretq always returns with the selectors set up in the STAR MSR, and takes the instruction pointer and flags
+    // from %rcx and %r11. The system call may have changed the task state in a way it can't represent.
+    return task_state.cs == user_code_selector && task_state.ss == user_data_selector &&
+           task_state.rip < max_user_address;
+}
+
+// The syscall instruction saves the return address in %rcx and the flags in %r11, and leaves the stack pointer alone.
+// The entry point switches to the kernel stack, and builds the same frame as an interrupt, so that the system call
+// handler sees a regular task state. System calls normally return using sysretq, which is much cheaper than iretq.
+[[gnu::naked]] static void system_call_entry() {
+    asm volatile("swapgs\n"
+                 "movq %%rsp, %%gs:%c0\n"
+                 "movq %%gs:%c1, %%rsp\n"
+
+                 "pushq %2\n"
+                 "pushq %%gs:%c0\n"
+                 "pushq %%r11\n"
+                 "pushq %3\n"
+                 "pushq %%rcx\n"
+
+                 "push %%rax\n"
+                 "push %%rbx\n"
+                 "push %%rcx\n"
+                 "push %%rdx\n"
+                 "push %%rsi\n"
+                 "push %%rdi\n"
+                 "push %%rbp\n"
+                 "push %%r8\n"
+                 "push %%r9\n"
+                 "push %%r10\n"
+                 "push %%r11\n"
+                 "push %%r12\n"
+                 "push %%r13\n"
+                 "push %%r14\n"
+                 "push %%r15\n"
+
+                 "mov %%rsp, %%rdi\n"
+                 "callq system_call_handler\n"
+                 "test %%al, %%al\n"
+                 "jz 1f\n"
+
+                 // %rcx and %r11 are loaded with the instruction pointer and flags instead of being restored.
+                 "pop %%r15\n"
+                 "pop %%r14\n"
+                 "pop %%r13\n"
+                 "pop %%r12\n"
+                 "add $8, %%rsp\n"
+                 "pop %%r10\n"
+                 "pop %%r9\n"
+                 "pop %%r8\n"
+                 "pop %%rbp\n"
+                 "pop %%rdi\n"
+                 "pop %%rsi\n"
+                 "pop %%rdx\n"
+                 "add $8, %%rsp\n"
+                 "pop %%rbx\n"
+                 "pop %%rax\n"
+
+                 "movq (%%rsp), %%rcx\n"
+                 "movq 16(%%rsp), %%r11\n"
+                 "movq 24(%%rsp), %%rsp\n"
+                 "sysretq\n"
+
+                 "1:\n"
+                 "pop %%r15\n"
+                 "pop %%r14\n"
+                 "pop %%r13\n"
+                 "pop %%r12\n"
+                 "pop %%r11\n"
+                 "pop %%r10\n"
+                 "pop %%r9\n"
+                 "pop %%r8\n"
+                 "pop %%rbp\n"
+                 "pop %%rdi\n"
+                 "pop %%rsi\n"
+                 "pop %%rdx\n"
+                 "pop %%rcx\n"
+                 "pop %%rbx\n"
+                 "pop %%rax\n"
+
+                 "iretq\n"
+                 :
+                 : "i"(user_stack_offset), "i"(kernel_stack_offset), "i"(user_data_selector),
+                   "i"(user_code_selector));
+}
+
+void init_system_calls() {
+    // SAFETY: This is safe since this function is only called by starting up a processor.
+    auto& processor = current_processor_unsafe();
+    ASSERT_EQ(di::to_uintptr(static_cast<arch::ProcessorEntryState*>(&processor)) - di::to_uintptr(&processor),
+              arch::processor_entry_state_offset);
+
+    // Set EFER.SCE, which enables the syscall and sysret instructions.
+    write_msr(ModelSpecificRegister::Efer, read_msr(ModelSpecificRegister::Efer) | 1);
+    write_msr(ModelSpecificRegister::Star, (sysret_selector_base << 48) | (kernel_code_selector << 32));
+    write_msr(ModelSpecificRegister::LStar, di::to_uintptr(&system_call_entry));
+    write_msr(ModelSpecificRegister::SfMask, system_call_flag_mask);
+}
+}
@@ -7,7 +7,9 @@
 namespace iris::arch {
 void load_kernel_stack(mm::VirtualAddress base) {
     // SAFETY: This function must be called with interrupts disabled.
-    current_processor_unsafe().arch_processor().tss().rsp[0] = base.raw_value();
+    auto& processor = current_processor_unsafe();
+    processor.arch_processor().tss().rsp[0] = base.raw_value();
+    processor.kernel_stack = base.raw_value();
 }
 }
 
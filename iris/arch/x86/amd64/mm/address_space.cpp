@@ -40,21 +40,29 @@ AddressSpace::~AddressSpace() {
     ASSERT(this != &kernel_address_space);
 
     // Load the kernel address space, to ensure we don't run in the current
-    // address space as it is being destroyed.
+    // address space as it is being destroyed. No task references this address space anymore, so being preempted
+    // afterwards never loads it again.
     with_preemption_disabled([&] {
         kernel_address_space.load();
+    });
 
-        // Unmap all regions in this address space.
-        auto& locked = get_assuming_no_concurrent_accesses();
-        auto end = locked.m_regions.end();
-        for (auto it = locked.m_regions.begin(); it != end;) {
-            auto& region = *it++;
-            *locked.destroy_region(region.base(), region.length());
-        }
+    // Other processors may still be switching away from this address space. Wait until none of them have it loaded,
+    // which also means unmapping the regions below does not need to send any TLB shootdowns.
+    while (is_active()) {
+        di::cpu_relax();
+    }
 
-        // Unmap the page table.
-        deallocate_page_frame(architecture_page_table_base());
-    });
+    // Unmap all regions in this address space. This runs with preemption enabled, since dropping the backing objects
+    // can release inodes, which may need to sleep.
+    auto& locked = get_assuming_no_concurrent_accesses();
+    auto end = locked.m_regions.end();
+    for (auto it = locked.m_regions.begin(); it != end;) {
+        auto& region = *it++;
+        *locked.destroy_region(region.base(), region.length());
+    }
+
+    // Unmap the page table.
+    deallocate_page_frame(architecture_page_table_base());
 }
 
 Expected<void> LockedAddressSpace::destroy_region(VirtualAddress base, usize length) {
@@ -71,8 +79,8 @@ Expected<void> LockedAddressSpace::destroy_region(VirtualAddress base, usize len
         auto pml4_offset = decomposed.get<page_structure::Pml4Offset>();
         auto& pml4 = TRY(map_physical_address(this->base().architecture_page_table_base(), 0x1000))
                          .typed<page_structure::PageStructureTable>();
+        // NOTE: Userspace regions are populated lazily, so it is normal for pages to not be present.
         if (!pml4[pml4_offset].get<page_structure::Present>()) {
-            println("WARNING: trying to unmap non-present page (PML4)"_sv);
             continue;
         }
 
@@ -81,7 +89,6 @@ Expected<void> LockedAddressSpace::destroy_region(VirtualAddress base, usize len
         auto& pdp =
             TRY(map_physical_address(PhysicalAddress(pdp_page), 0x1000)).typed<page_structure::PageStructureTable>();
         if (!pdp[pdp_offset].get<page_structure::Present>()) {
-            println("WARNING: trying to unmap non-present page (PDP)"_sv);
             continue;
         }
 
@@ -90,57 +97,174 @@ Expected<void> LockedAddressSpace::destroy_region(VirtualAddress base, usize len
         auto& pd = TRY(map_physical_address(PhysicalAddress(pd_page.raw_value()), 0x1000))
                        .typed<page_structure::PageStructureTable>();
         if (!pd[pd_offset].get<page_structure::Present>()) {
-            println("WARNING: trying to unmap non-present page (PD)"_sv);
             continue;
         }
 
+        // Make sure to cleanup the page structure tables once they are empty.
+        auto release_empty_pd = [&] {
+            auto& pd_structure = page_structure_page(pd_page);
+            if (!pd_structure.children.empty() || pd_structure.large_page_count > 0) {
+                return;
+            }
+
+            auto& pdp_structure = page_structure_page(pdp_page);
+            pdp[pdp_offset] = page_structure::StructureEntry(page_structure::Present(false));
+            pdp_structure.children.erase(pd_structure);
+            queue_page_frame_free(pd_page);
+
+            if (pdp_structure.children.empty()) {
+                auto& pml4_structure = page_structure_page(this->base().architecture_page_table_base());
+
+                pml4[pml4_offset] = page_structure::StructureEntry(page_structure::Present(false));
+                pml4_structure.children.erase(pdp_structure);
+                queue_page_frame_free(pdp_page);
+            }
+        };
+
+        if (pd[pd_offset].get<page_structure::HugePage>()) {
+            auto large_page = VirtualAddress(di::align_down(page.raw_value(), large_page_size));
+            if (large_page < base || large_page + large_page_size > base + length) {
+                // Only part of the large page is being unmapped, so unmap its pages individually.
+                TRY(split_large_page(page));
+            } else {
+                auto physical_address = PhysicalAddress(pd[pd_offset].get<page_structure::PhysicalAddress>() << 12);
+                for (auto i : di::range(large_page_size / 4096)) {
+                    queue_page_drop(physical_address + i * 4096);
+                }
+                pd[pd_offset] = page_structure::StructureEntry(page_structure::Present(false));
+                page_structure_page(pd_page).large_page_count--;
+                this->base().m_resident_pages.fetch_sub(large_page_size / 4096, di::MemoryOrder::Relaxed);
+                this->base().m_mapped_2mib_pages.fetch_sub(1, di::MemoryOrder::Relaxed);
+
+                release_empty_pd();
+                page = large_page + (large_page_size - 4096);
+                continue;
+            }
+        }
+
         auto pt_page = PhysicalAddress(pd[pd_offset].get<page_structure::PhysicalAddress>() << 12);
         auto pt_offset = decomposed.get<page_structure::PtOffset>();
         auto& pt = TRY(map_physical_address(PhysicalAddress(pt_page.raw_value()), 0x1000))
                        .typed<page_structure::PageStructureTable>();
         if (!pt[pt_offset].get<page_structure::Present>()) {
-            println("WARNING: trying to unmap non-present page (PT)"_sv);
             continue;
         }
 
         auto physical_address = PhysicalAddress(pt[pt_offset].get<page_structure::PhysicalAddress>() << 12);
-        drop_page(physical_address);
+        queue_page_drop(physical_address);
         pt[pt_offset] = page_structure::StructureEntry(page_structure::Present(false));
         this->base().m_resident_pages.fetch_sub(1, di::MemoryOrder::Relaxed);
+        this->base().m_mapped_4kib_pages.fetch_sub(1, di::MemoryOrder::Relaxed);
 
-        // Make sure to cleanup the page structure tables if they are now empty.
         auto& pt_structure = page_structure_page(pt_page);
         if (--pt_structure.mapped_page_count == 0) {
             auto& pd_structure = page_structure_page(pd_page);
 
             pd[pd_offset] = page_structure::StructureEntry(page_structure::Present(false));
             pd_structure.children.erase(pt_structure);
-            deallocate_page_frame(pt_page);
+            queue_page_frame_free(pt_page);
 
-            if (pd_structure.children.empty()) {
-                auto& pdp_structure = page_structure_page(pdp_page);
+            release_empty_pd();
+        }
+    }
 
-                pdp[pdp_offset] = page_structure::StructureEntry(page_structure::Present(false));
-                pdp_structure.children.erase(pd_structure);
-                deallocate_page_frame(pd_page);
+    // Other processors may still access the unmapped pages and page tables through stale translations, so they are only
+    // freed after the shootdown.
+    flush_tlb_global(base, length);
+    return {};
+}
 
-                if (pdp_structure.children.empty()) {
-                    auto& pml4_structure = page_structure_page(this->base().architecture_page_table_base());
+Expected<void> LockedAddressSpace::split_large_page(VirtualAddress location) {
+    auto decomposed = decompose_virtual_address(location);
+    auto& pml4 = TRY(map_physical_address(base().architecture_page_table_base(), 0x1000))
+                     .typed<page_structure::PageStructureTable>();
+    auto pml4_entry = pml4[decomposed.get<page_structure::Pml4Offset>()];
+    ASSERT(pml4_entry.get<page_structure::Present>());
 
-                    pml4[pml4_offset] = page_structure::StructureEntry(page_structure::Present(false));
-                    pml4_structure.children.erase(pdp_structure);
-                    deallocate_page_frame(pdp_page);
-                }
-            }
-        }
+    auto& pdp = TRY(map_physical_address(PhysicalAddress(pml4_entry.get<page_structure::PhysicalAddress>() << 12),
+                                         0x1000))
+                    .typed<page_structure::PageStructureTable>();
+    auto pdp_entry = pdp[decomposed.get<page_structure::PdpOffset>()];
+    ASSERT(pdp_entry.get<page_structure::Present>());
+    ASSERT(!pdp_entry.get<page_structure::HugePage>());
+
+    auto pd_page = PhysicalAddress(pdp_entry.get<page_structure::PhysicalAddress>() << 12);
+    auto& pd = TRY(map_physical_address(pd_page, 0x1000)).typed<page_structure::PageStructureTable>();
+    auto& pd_entry = pd[decomposed.get<page_structure::PdOffset>()];
+    ASSERT(pd_entry.get<page_structure::Present>());
+    ASSERT(pd_entry.get<page_structure::HugePage>());
+
+    // The new page table maps the same pages with the same permissions, so the page reference counts do not change.
+    auto pt_page = TRY(allocate_page_frame());
+    auto& pt = TRY(map_physical_address(pt_page, 0x1000)).typed<page_structure::PageStructureTable>();
+    auto first_page = pd_entry.get<page_structure::PhysicalAddress>();
+    for (auto [i, entry] : di::enumerate(pt)) {
+        entry = page_structure::StructureEntry(
+            page_structure::PhysicalAddress(first_page + i), page_structure::Present(true),
+            page_structure::Writable(pd_entry.get<page_structure::Writable>()),
+            page_structure::User(pd_entry.get<page_structure::User>()),
+            page_structure::NotExecutable(pd_entry.get<page_structure::NotExecutable>()));
     }
 
-    flush_tlb_global(base, length);
+    auto& pt_structure = init_as_page_structure_leaf(pt_page);
+    pt_structure.mapped_page_count = pt.size();
+    auto& pd_structure = page_structure_page(pd_page);
+    pd_structure.children.push_back(pt_structure);
+    pd_structure.large_page_count--;
+
+    pd_entry = page_structure::StructureEntry(page_structure::PhysicalAddress(pt_page.raw_value() >> 12),
+                                              page_structure::Present(true), page_structure::Writable(true),
+                                              page_structure::User(pd_entry.get<page_structure::User>()));
+    base().m_structure_pages.fetch_add(1, di::MemoryOrder::Relaxed);
+    base().m_mapped_2mib_pages.fetch_sub(1, di::MemoryOrder::Relaxed);
+    base().m_mapped_4kib_pages.fetch_add(pt.size(), di::MemoryOrder::Relaxed);
+
+    // Translations for the large page are not invalidated by flushing any one of its pages.
+    queue_tlb_flush(VirtualAddress(di::align_down(location.raw_value(), large_page_size)), large_page_size);
     return {};
 }
 
 void AddressSpace::load() {
-    load_cr3(m_architecture_page_table_base.raw_value());
+    auto& global_state = global_state_in_boot();
+    if (!global_state.current_processor_available) {
+        load_cr3(m_architecture_page_table_base.raw_value());
+        return;
+    }
+
+    // SAFETY: Preemption is disabled by the caller.
+    auto& processor = current_processor_unsafe();
+    auto* previous = processor.active_address_space();
+    if (previous == this) {
+        // TLB shootdowns keep the processor's cached translations up to date while the address space is loaded.
+        return;
+    }
+
+    if (previous) {
+        previous->mark_inactive(processor.id());
+    }
+    mark_active(processor.id());
+    processor.set_active_address_space(this);
+
+    auto cr3 = m_architecture_page_table_base.raw_value();
+    if (global_state.processor_info.has_pcid()) {
+        // Setting bit 63 of cr3 preserves the translations cached under the new PCID.
+        constexpr auto preserve_translations = 1_u64 << 63;
+
+        if (m_kernel) {
+            // The kernel address space always uses PCID 0. Its translations are never stale, since changes to kernel
+            // mappings are invalidated in every context.
+            cr3 |= preserve_translations;
+        } else {
+            // NOTE: The generation must be read after marking this processor as active. Otherwise, a concurrent
+            //       flush could skip this processor while it still uses the old generation.
+            auto [pcid, stale] = processor.arch_processor().assign_pcid(m_id, tlb_generation());
+            cr3 |= pcid;
+            if (!stale) {
+                cr3 |= preserve_translations;
+            }
+        }
+    }
+    load_cr3(cr3);
 }
 
 Expected<void> LockedAddressSpace::map_physical_page_early(VirtualAddress location, PhysicalAddress physical_address,
@@ -194,6 +318,7 @@ Expected<void> LockedAddressSpace::map_physical_page_early(VirtualAddress locati
                                                    page_structure::Present(true), page_structure::Writable(writable),
                                                    page_structure::NotExecutable(not_executable));
     base().m_resident_pages.fetch_add(1, di::MemoryOrder::Relaxed);
+    base().m_mapped_4kib_pages.fetch_add(1, di::MemoryOrder::Relaxed);
 
     flush_tlb_global(location);
 
@@ -258,6 +383,8 @@ Expected<void> LockedAddressSpace::map_physical_page(VirtualAddress location, Ph
         auto pt_page = PhysicalAddress(pd[pd_offset].get<page_structure::PhysicalAddress>() << 12);
         auto& pt_structure = init_as_page_structure_leaf(pt_page);
         pd_structure.children.push_back(pt_structure);
+    } else if (pd[pd_offset].get<page_structure::HugePage>()) {
+        TRY(split_large_page(location));
     }
 
     auto pt_page = PhysicalAddress(pd[pd_offset].get<page_structure::PhysicalAddress>() << 12);
@@ -266,22 +393,245 @@ Expected<void> LockedAddressSpace::map_physical_page(VirtualAddress location, Ph
     auto pt_offset = decomposed.get<page_structure::PtOffset>();
     auto& pt = TRY(map_physical_address(PhysicalAddress(pt_page.raw_value()), 0x1000))
                    .typed<page_structure::PageStructureTable>();
-    if (pt[pt_offset].get<page_structure::Present>()) {
-        println("WARNING: virtual address {} is already marked as present."_sv, location);
-    }
+    auto const old_entry = pt[pt_offset];
     pt[pt_offset] = page_structure::StructureEntry(
         page_structure::PhysicalAddress(physical_address.raw_value() >> 12), page_structure::Present(true),
         page_structure::Writable(writable), page_structure::User(user), page_structure::NotExecutable(not_executable));
-    base().m_resident_pages.fetch_add(1, di::MemoryOrder::Relaxed);
-    pt_structure.mapped_page_count++;
-
     bump_page(physical_address);
 
+    // The processor never caches translations for non-present pages, so there is nothing to invalidate unless the page
+    // was already mapped. This avoids a TLB shootdown on every demand fault.
+    if (!old_entry.get<page_structure::Present>()) {
+        base().m_resident_pages.fetch_add(1, di::MemoryOrder::Relaxed);
+        base().m_mapped_4kib_pages.fetch_add(1, di::MemoryOrder::Relaxed);
+        pt_structure.mapped_page_count++;
+        return {};
+    }
+
+    // Replacing an existing mapping (for instance, when breaking copy-on-write sharing) releases the old page. This
+    // must happen after the shootdown, since other processors may still be accessing the page through a stale mapping.
     flush_tlb_global(location);
+    drop_page(PhysicalAddress(old_entry.get<page_structure::PhysicalAddress>() << 12));
+
+    return {};
+}
+
+Expected<void> LockedAddressSpace::map_physical_large_page_early(VirtualAddress location,
+                                                                 PhysicalAddress physical_address, RegionFlags flags) {
+    ASSERT(location.raw_value() % large_page_size == 0);
+    ASSERT(physical_address.raw_value() % large_page_size == 0);
+
+    auto const writable = !!(flags & RegionFlags::Writable);
+    auto const not_executable = !(flags & RegionFlags::Executable);
+
+    auto decomposed = decompose_virtual_address(location);
+    auto pml4_offset = decomposed.get<page_structure::Pml4Offset>();
+    auto& pml4 = TRY(map_physical_address(base().architecture_page_table_base(), 0x1000))
+                     .typed<page_structure::PageStructureTable>();
+    if (!pml4[pml4_offset].get<page_structure::Present>()) {
+        pml4[pml4_offset] = page_structure::StructureEntry(
+            page_structure::PhysicalAddress(TRY(allocate_page_frame()).raw_value() >> 12),
+            page_structure::Present(true), page_structure::Writable(true));
+        base().m_structure_pages.fetch_add(1, di::MemoryOrder::Relaxed);
+    }
+
+    auto pdp_offset = decomposed.get<page_structure::PdpOffset>();
+    auto& pdp = TRY(map_physical_address(
+                        PhysicalAddress(pml4[pml4_offset].get<page_structure::PhysicalAddress>() << 12), 0x1000))
+                    .typed<page_structure::PageStructureTable>();
+    if (!pdp[pdp_offset].get<page_structure::Present>()) {
+        pdp[pdp_offset] = page_structure::StructureEntry(
+            page_structure::PhysicalAddress(TRY(allocate_page_frame()).raw_value() >> 12),
+            page_structure::Present(true), page_structure::Writable(true));
+        base().m_structure_pages.fetch_add(1, di::MemoryOrder::Relaxed);
+    }
+
+    auto pd_offset = decomposed.get<page_structure::PdOffset>();
+    auto& pd =
+        TRY(map_physical_address(PhysicalAddress(pdp[pdp_offset].get<page_structure::PhysicalAddress>() << 12), 0x1000))
+            .typed<page_structure::PageStructureTable>();
+    if (pd[pd_offset].get<page_structure::Present>()) {
+        println("WARNING: virtual address {} is already marked as present."_sv, location);
+    }
+    pd[pd_offset] = page_structure::StructureEntry(page_structure::PhysicalAddress(physical_address.raw_value() >> 12),
+                                                   page_structure::Present(true), page_structure::Writable(writable),
+                                                   page_structure::NotExecutable(not_executable),
+                                                   page_structure::HugePage(true));
+    base().m_resident_pages.fetch_add(large_page_size / 4096, di::MemoryOrder::Relaxed);
+    base().m_mapped_2mib_pages.fetch_add(1, di::MemoryOrder::Relaxed);
+
+    flush_tlb_global(location, large_page_size);
 
     return {};
 }
 
+Expected<void> LockedAddressSpace::map_physical_large_page(VirtualAddress location, PhysicalAddress physical_address,
+                                                           RegionFlags flags) {
+    ASSERT(location.raw_value() % large_page_size == 0);
+    ASSERT(physical_address.raw_value() % large_page_size == 0);
+
+    auto const writable = !!(flags & RegionFlags::Writable);
+    auto const not_executable = !(flags & RegionFlags::Executable);
+    auto const user = !!(flags & RegionFlags::User);
+
+    auto decomposed = decompose_virtual_address(location);
+    auto pml4_offset = decomposed.get<page_structure::Pml4Offset>();
+    auto& pml4 = TRY(map_physical_address(base().architecture_page_table_base(), 0x1000))
+                     .typed<page_structure::PageStructureTable>();
+    auto& pml4_structure = page_structure_page(base().architecture_page_table_base());
+    if (!pml4[pml4_offset].get<page_structure::Present>()) {
+        pml4[pml4_offset] = page_structure::StructureEntry(
+            page_structure::PhysicalAddress(TRY(allocate_page_frame()).raw_value() >> 12),
+            page_structure::Present(true), page_structure::Writable(true), page_structure::User(user));
+        base().m_structure_pages.fetch_add(1, di::MemoryOrder::Relaxed);
+
+        auto pdp_page = PhysicalAddress(pml4[pml4_offset].get<page_structure::PhysicalAddress>() << 12);
+        auto& pdp_structure = init_as_page_structure_parent(pdp_page);
+        pml4_structure.children.push_back(pdp_structure);
+    }
+
+    auto pdp_page = PhysicalAddress(pml4[pml4_offset].get<page_structure::PhysicalAddress>() << 12);
+    auto& pdp_structure = page_structure_page(pdp_page);
+
+    auto pdp_offset = decomposed.get<page_structure::PdpOffset>();
+    auto& pdp = TRY(map_physical_address(pdp_page, 0x1000)).typed<page_structure::PageStructureTable>();
+    if (!pdp[pdp_offset].get<page_structure::Present>()) {
+        pdp[pdp_offset] = page_structure::StructureEntry(
+            page_structure::PhysicalAddress(TRY(allocate_page_frame()).raw_value() >> 12),
+            page_structure::Present(true), page_structure::Writable(true), page_structure::User(user));
+        base().m_structure_pages.fetch_add(1, di::MemoryOrder::Relaxed);
+
+        auto pd_page = PhysicalAddress(pdp[pdp_offset].get<page_structure::PhysicalAddress>() << 12);
+        auto& pd_structure = init_as_page_structure_parent(pd_page);
+        pdp_structure.children.push_back(pd_structure);
+    }
+
+    auto pd_page = PhysicalAddress(pdp[pdp_offset].get<page_structure::PhysicalAddress>() << 12);
+    auto& pd_structure = page_structure_page(pd_page);
+
+    auto pd_offset = decomposed.get<page_structure::PdOffset>();
+    auto& pd = TRY(map_physical_address(pd_page, 0x1000)).typed<page_structure::PageStructureTable>();
+    if (pd[pd_offset].get<page_structure::Present>()) {
+        return di::Unexpected(Error::AddressInUse);
+    }
+
+    pd[pd_offset] = page_structure::StructureEntry(
+        page_structure::PhysicalAddress(physical_address.raw_value() >> 12), page_structure::Present(true),
+        page_structure::Writable(writable), page_structure::User(user), page_structure::NotExecutable(not_executable),
+        page_structure::HugePage(true));
+    for (auto i : di::range(large_page_size / 4096)) {
+        bump_page(physical_address + i * 4096);
+    }
+    pd_structure.large_page_count++;
+
+    // Like in map_physical_page(), there is nothing to invalidate since the entry was not present.
+    base().m_resident_pages.fetch_add(large_page_size / 4096, di::MemoryOrder::Relaxed);
+    base().m_mapped_2mib_pages.fetch_add(1, di::MemoryOrder::Relaxed);
+    return {};
+}
+
+bool LockedAddressSpace::is_large_page_unmapped(VirtualAddress location) {
+    auto decomposed = decompose_virtual_address(location);
+    auto& pml4 = (*map_physical_address(base().architecture_page_table_base(), 0x1000))
+                     .typed<page_structure::PageStructureTable>();
+    auto pml4_entry = pml4[decomposed.get<page_structure::Pml4Offset>()];
+    if (!pml4_entry.get<page_structure::Present>()) {
+        return true;
+    }
+
+    auto pdp_page = PhysicalAddress(pml4_entry.get<page_structure::PhysicalAddress>() << 12);
+    auto& pdp = (*map_physical_address(pdp_page, 0x1000)).typed<page_structure::PageStructureTable>();
+    auto pdp_entry = pdp[decomposed.get<page_structure::PdpOffset>()];
+    if (!pdp_entry.get<page_structure::Present>()) {
+        return true;
+    }
+    if (pdp_entry.get<page_structure::HugePage>()) {
+        return false;
+    }
+
+    auto pd_page = PhysicalAddress(pdp_entry.get<page_structure::PhysicalAddress>() << 12);
+    auto& pd = (*map_physical_address(pd_page, 0x1000)).typed<page_structure::PageStructureTable>();
+    return !pd[decomposed.get<page_structure::PdOffset>()].get<page_structure::Present>();
+}
+
+di::Optional<PhysicalAddress> LockedAddressSpace::translate(VirtualAddress location) {
+    auto decomposed = decompose_virtual_address(location);
+    auto pml4_offset = decomposed.get<page_structure::Pml4Offset>();
+    auto& pml4 = (*map_physical_address(base().architecture_page_table_base(), 0x1000))
+                     .typed<page_structure::PageStructureTable>();
+    if (!pml4[pml4_offset].get<page_structure::Present>()) {
+        return di::nullopt;
+    }
+
+    auto pdp_page = PhysicalAddress(pml4[pml4_offset].get<page_structure::PhysicalAddress>() << 12);
+    auto pdp_offset = decomposed.get<page_structure::PdpOffset>();
+    auto& pdp = (*map_physical_address(pdp_page, 0x1000)).typed<page_structure::PageStructureTable>();
+    if (!pdp[pdp_offset].get<page_structure::Present>()) {
+        return di::nullopt;
+    }
+    if (pdp[pdp_offset].get<page_structure::HugePage>()) {
+        auto offset = location.raw_value() % (1024 * 1024 * 1024) / 4096 * 4096;
+        return PhysicalAddress(pdp[pdp_offset].get<page_structure::PhysicalAddress>() << 12) + offset;
+    }
+
+    auto pd_page = PhysicalAddress(pdp[pdp_offset].get<page_structure::PhysicalAddress>() << 12);
+    auto pd_offset = decomposed.get<page_structure::PdOffset>();
+    auto& pd = (*map_physical_address(pd_page, 0x1000)).typed<page_structure::PageStructureTable>();
+    if (!pd[pd_offset].get<page_structure::Present>()) {
+        return di::nullopt;
+    }
+    if (pd[pd_offset].get<page_structure::HugePage>()) {
+        auto offset = location.raw_value() % (2 * 1024 * 1024) / 4096 * 4096;
+        return PhysicalAddress(pd[pd_offset].get<page_structure::PhysicalAddress>() << 12) + offset;
+    }
+
+    auto pt_page = PhysicalAddress(pd[pd_offset].get<page_structure::PhysicalAddress>() << 12);
+    auto pt_offset = decomposed.get<page_structure::PtOffset>();
+    auto& pt = (*map_physical_address(pt_page, 0x1000)).typed<page_structure::PageStructureTable>();
+    if (!pt[pt_offset].get<page_structure::Present>()) {
+        return di::nullopt;
+    }
+    return PhysicalAddress(pt[pt_offset].get<page_structure::PhysicalAddress>() << 12);
+}
+
+Expected<void> LockedAddressSpace::write_protect(VirtualAddress base, usize page_aligned_length) {
+    auto& pml4 = TRY(map_physical_address(this->base().architecture_page_table_base(), 0x1000))
+                     .typed<page_structure::PageStructureTable>();
+    for (auto page = base; page < base + page_aligned_length; page += 4096zu) {
+        auto decomposed = decompose_virtual_address(page);
+        auto pml4_offset = decomposed.get<page_structure::Pml4Offset>();
+        if (!pml4[pml4_offset].get<page_structure::Present>()) {
+            continue;
+        }
+
+        auto pdp_page = PhysicalAddress(pml4[pml4_offset].get<page_structure::PhysicalAddress>() << 12);
+        auto pdp_offset = decomposed.get<page_structure::PdpOffset>();
+        auto& pdp = TRY(map_physical_address(pdp_page, 0x1000)).typed<page_structure::PageStructureTable>();
+        if (!pdp[pdp_offset].get<page_structure::Present>()) {
+            continue;
+        }
+
+        auto pd_page = PhysicalAddress(pdp[pdp_offset].get<page_structure::PhysicalAddress>() << 12);
+        auto pd_offset = decomposed.get<page_structure::PdOffset>();
+        auto& pd = TRY(map_physical_address(pd_page, 0x1000)).typed<page_structure::PageStructureTable>();
+        if (!pd[pd_offset].get<page_structure::Present>()) {
+            continue;
+        }
+        if (pd[pd_offset].get<page_structure::HugePage>()) {
+            pd[pd_offset].set<page_structure::Writable>(false);
+            continue;
+        }
+
+        auto pt_page = PhysicalAddress(pd[pd_offset].get<page_structure::PhysicalAddress>() << 12);
+        auto pt_offset = decomposed.get<page_structure::PtOffset>();
+        auto& pt = TRY(map_physical_address(pt_page, 0x1000)).typed<page_structure::PageStructureTable>();
+        pt[pt_offset].set<page_structure::Writable>(false);
+    }
+
+    queue_tlb_flush(base, page_aligned_length);
+    return {};
+}
+
 Expected<void> LockedAddressSpace::create_low_identity_mapping(VirtualAddress base, usize page_aligned_length) {
     for (auto address : di::iota(base, base + isize(page_aligned_length)) | di::stride(4096)) {
         auto physical_address = PhysicalAddress(address.raw_value());
@@ -331,6 +681,7 @@ Expected<void> LockedAddressSpace::remove_low_identity_mapping(VirtualAddress ba
 
         pt[pt_offset] = page_structure::StructureEntry(page_structure::Present(false));
         this->base().m_resident_pages.fetch_sub(1, di::MemoryOrder::Relaxed);
+        this->base().m_mapped_4kib_pages.fetch_sub(1, di::MemoryOrder::Relaxed);
 
         // Make sure to cleanup the page structure tables if they are now empty.
         auto& pt_structure = page_structure_page(pt_page);
@@ -339,21 +690,21 @@ Expected<void> LockedAddressSpace::remove_low_identity_mapping(VirtualAddress ba
 
             pd[pd_offset] = page_structure::StructureEntry(page_structure::Present(false));
             pd_structure.children.erase(pt_structure);
-            deallocate_page_frame(pt_page);
+            queue_page_frame_free(pt_page);
 
             if (pd_structure.children.empty()) {
                 auto& pdp_structure = page_structure_page(pdp_page);
 
                 pdp[pdp_offset] = page_structure::StructureEntry(page_structure::Present(false));
                 pdp_structure.children.erase(pd_structure);
-                deallocate_page_frame(pd_page);
+                queue_page_frame_free(pd_page);
 
                 if (pdp_structure.children.empty()) {
                     auto& pml4_structure = page_structure_page(this->base().architecture_page_table_base());
 
                     pml4[pml4_offset] = page_structure::StructureEntry(page_structure::Present(false));
                     pml4_structure.children.erase(pdp_structure);
-                    deallocate_page_frame(pdp_page);
+                    queue_page_frame_free(pdp_page);
                 }
             }
         }
@@ -395,7 +746,7 @@ Expected<void> LockedAddressSpace::setup_physical_memory_map(PhysicalAddress sta
             pdp[pdp_offset] = page_structure::StructureEntry(
                 page_structure::PhysicalAddress(phys_address.raw_value() >> 12), page_structure::Present(true),
                 page_structure::Writable(true), page_structure::HugePage(true));
-            base().m_structure_pages.fetch_add(1, di::MemoryOrder::Relaxed);
+            base().m_mapped_1gib_pages.fetch_add(1, di::MemoryOrder::Relaxed);
             phys_address += 1zu * 1024 * 1024 * 1024;
             continue;
         }
@@ -415,7 +766,7 @@ Expected<void> LockedAddressSpace::setup_physical_memory_map(PhysicalAddress sta
         pd[pd_offset] = page_structure::StructureEntry(page_structure::PhysicalAddress(phys_address.raw_value() >> 12),
                                                        page_structure::Present(true), page_structure::Writable(true),
                                                        page_structure::HugePage(true));
-        base().m_structure_pages.fetch_add(1, di::MemoryOrder::Relaxed);
+        base().m_mapped_2mib_pages.fetch_add(1, di::MemoryOrder::Relaxed);
         phys_address += 2zu * 1024 * 1024;
     }
 
@@ -425,10 +776,22 @@ Expected<void> LockedAddressSpace::setup_physical_memory_map(PhysicalAddress sta
 Expected<void> LockedAddressSpace::setup_kernel_region(PhysicalAddress kernel_physical_start,
                                                        VirtualAddress kernel_virtual_start,
                                                        VirtualAddress kernel_virtual_end, RegionFlags flags) {
-    for (auto offset = 0_u64; kernel_virtual_start + offset < kernel_virtual_end; offset += 4096) {
+    for (auto offset = 0_u64; kernel_virtual_start + offset < kernel_virtual_end;) {
         auto physical_address = kernel_physical_start + offset;
         auto virtual_address = kernel_virtual_start + offset;
+
+        // Use large pages whenever both addresses are suitably aligned. This is mostly relevant for the physical page
+        // structures, which are large and come from a naturally aligned block of physical memory.
+        if (virtual_address.raw_value() % large_page_size == 0 &&
+            physical_address.raw_value() % large_page_size == 0 &&
+            virtual_address + large_page_size <= kernel_virtual_end) {
+            TRY(map_physical_large_page_early(virtual_address, physical_address, flags));
+            offset += large_page_size;
+            continue;
+        }
+
         TRY(map_physical_page_early(virtual_address, physical_address, flags));
+        offset += 4096;
     }
     return {};
 }
@@ -443,13 +806,13 @@ Expected<void> LockedAddressSpace::bootstrap_kernel_page_tracking() {
     auto& pml4 = TRY(map_physical_address(base().architecture_page_table_base(), 0x1000))
                      .typed<page_structure::PageStructureTable>();
 
-    // The initial kernel mappings have 6 regions.
+    // The initial kernel mappings have 5 regions.
     // 1. The physical memory direct map
     // 2. The physical page structures
     // 3. The kernel code
     // 4. The kernel read-only data
     // 5. The kernel read-write data
-    // 6. The kernel heap (initially empty)
+    // NOTE: the kernel heap is allocated out of the physical memory direct map, so it does not need its own region.
 
     auto backing_object_index = 0;
     auto region_index = 0;
@@ -558,6 +921,19 @@ Expected<void> LockedAddressSpace::bootstrap_kernel_page_tracking() {
             auto& pd = TRY(map_physical_address(pd_page, 0x1000)).typed<page_structure::PageStructureTable>();
             auto pd_entry = pd[pd_offset];
             ASSERT(pd_entry.get<page_structure::Present>());
+            if (pd_entry.get<page_structure::HugePage>()) {
+                // Large pages have no page table, so the individual pages are tracked directly.
+                if (pt_offset == 0) {
+                    pd_structure.large_page_count++;
+                }
+
+                auto backing_page =
+                    PhysicalAddress(pd_entry.get<page_structure::PhysicalAddress>() << 12) + pt_offset * 4096;
+                TRY(backing_object.get_assuming_no_concurrent_accesses().add_page(backing_page, page_index));
+                bump_page(backing_page);
+                continue;
+            }
+
             auto pt_page = PhysicalAddress(pd_entry.get<page_structure::PhysicalAddress>() << 12);
             auto& pt_structure = [&] -> PageStructurePhysicalPage& {
                 auto it = di::find_if(pd_structure.children, [&](auto&& child) {
@@ -575,7 +951,7 @@ Expected<void> LockedAddressSpace::bootstrap_kernel_page_tracking() {
 
             auto& pt = TRY(map_physical_address(pt_page, 0x1000)).typed<page_structure::PageStructureTable>();
             auto backing_page = PhysicalAddress(pt[pt_offset].get<page_structure::PhysicalAddress>() << 12);
-            backing_object.get_assuming_no_concurrent_accesses().add_page(backing_page, page_index);
+            TRY(backing_object.get_assuming_no_concurrent_accesses().add_page(backing_page, page_index));
             bump_page(backing_page);
         }
 
@@ -594,23 +970,68 @@ Expected<void> LockedAddressSpace::bootstrap_kernel_page_tracking() {
     TRY(handle_kernel_region(rodata_segment_start, rodata_segment_end, RegionFlags::Readable));
     TRY(handle_kernel_region(data_segment_start, data_segment_end, RegionFlags::Readable | RegionFlags::Writable));
 
-    TRY(handle_kernel_region(global_state.heap_start, global_state.heap_start,
-                             RegionFlags::Readable | RegionFlags::Writable));
-
     return {};
 }
 
-void LockedAddressSpace::flush_tlb_global(VirtualAddress base, usize byte_length) {
-    // SAFETY: We are protected by the address space lock.
+void LockedAddressSpace::queue_page_drop(PhysicalAddress address) {
+    auto& page = backed_page(address);
+    if (page.reference_count.fetch_sub(1, di::MemoryOrder::AcquireRelease) == 1) {
+        queue_page_frame_free(address);
+    }
+}
+
+void LockedAddressSpace::queue_page_frame_free(PhysicalAddress address) {
+    auto& page = physical_page(address);
+    di::construct_at(&page.as_unmapped_page);
+    m_pending_page_frees.push_back(page.as_unmapped_page);
+}
+
+void LockedAddressSpace::flush_tlb() {
+    shoot_down_tlb();
+
+    while (auto page = m_pending_page_frees.pop_front()) {
+        deallocate_page_frame(physical_address(*page));
+    }
+}
+
+void LockedAddressSpace::shoot_down_tlb() {
+    if (m_pending_tlb_flush.empty()) {
+        return;
+    }
+    auto batch = m_pending_tlb_flush;
+    m_pending_tlb_flush.clear();
+
+    // The address space lock does not prevent preemption, so disable it while deciding which processors to flush.
+    auto preemption_guard = PreemptionDisabler {};
+
+    // SAFETY: This is safe since preemption is disabled.
     auto& current_processor = current_processor_unsafe();
+    auto const& global_state = iris::global_state();
+    auto& address_space = base();
 
-    current_processor.flush_tlb_local(base, byte_length);
+    if (address_space.is_kernel()) {
+        batch.set_kernel();
+        current_processor.flush_tlb_local(batch);
+        if (global_state.all_aps_booted.load(di::MemoryOrder::Relaxed)) {
+            current_processor.broadcast_tlb_flush(batch);
+        }
+        return;
+    }
+
+    // Advance the generation before checking which processors have the address space loaded. Any processor which loads
+    // it afterwards is guaranteed to see the new generation, and so will flush its stale translations itself.
+    address_space.m_tlb_generation.fetch_add(1, di::MemoryOrder::SequentialConsistency);
+
+    if (address_space.is_active_on(current_processor.id())) {
+        current_processor.flush_tlb_local(batch);
+    }
 
-    if (global_state().all_aps_booted.load(di::MemoryOrder::Relaxed)) {
-        current_processor.broadcast_ipi([&](IpiMessage& message) {
-            message.tlb_flush_base = base;
-            message.tlb_flush_size = byte_length;
-        });
+    if (global_state.all_aps_booted.load(di::MemoryOrder::Relaxed)) {
+        current_processor.send_tlb_flush(
+            [&](Processor& processor) {
+                return address_space.is_active_on(processor.id());
+            },
+            batch);
     }
 }
 
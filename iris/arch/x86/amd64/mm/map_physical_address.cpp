@@ -28,4 +28,8 @@ Expected<PhysicalAddressMapping> map_physical_address(PhysicalAddress address, u
     auto virtual_address = reinterpret_cast<di::Byte*>(base + address.raw_value());
     return PhysicalAddressMapping({ virtual_address, byte_size });
 }
+
+PhysicalAddress physical_address_of_mapping(void const* pointer) {
+    return PhysicalAddress(di::to_uintptr(pointer) - hhdm_request.response->offset);
+}
 }
@@ -0,0 +1,69 @@
+#include <iris/arch/x86/amd64/page_fault.h>
+#include <iris/arch/x86/amd64/system_instructions.h>
+#include <iris/core/global_state.h>
+#include <iris/core/interrupt_disabler.h>
+#include <iris/core/print.h>
+#include <iris/core/userspace_access.h>
+#include <iris/hw/irq.h>
+#include <iris/mm/address_space.h>
+
+namespace iris {
+static mm::PageFaultFlags decode_error_code(int error_code) {
+    auto flags = mm::PageFaultFlags::None;
+    if (error_code & (1 << 0)) {
+        flags |= mm::PageFaultFlags::Present;
+    }
+    if (error_code & (1 << 1)) {
+        flags |= mm::PageFaultFlags::Write;
+    }
+    if (error_code & (1 << 2)) {
+        flags |= mm::PageFaultFlags::User;
+    }
+    if (error_code & (1 << 4)) {
+        flags |= mm::PageFaultFlags::InstructionFetch;
+    }
+    return flags;
+}
+
+static IrqStatus handle_page_fault(IrqContext& context) {
+    auto instruction_pointer = mm::VirtualAddress(context.task_state.rip);
+    auto address = mm::VirtualAddress(x86::amd64::read_cr2());
+    auto flags = decode_error_code(context.error_code);
+
+    // Kernel regions are always fully populated, so only userspace addresses can be resolved on demand. This includes
+    // faults from the kernel itself, when it accesses userspace memory. Resolving the fault may require sleeping (to
+    // acquire the address space lock, or to read the page in), so this is only possible if the faulting code could
+    // have been switched away from. Otherwise, kernel accesses fail as if the address was invalid.
+    // SAFETY: interrupts are disabled.
+    auto* task = current_processor_unsafe().scheduler().current_task_null_if_during_boot();
+    auto const interrupts_were_enabled = !!(context.task_state.rflags & arch::interrupt_enable_flag);
+    if (validate_user_region(address, 1, 1) && task && interrupts_were_enabled && !task->preemption_disabled()) {
+        raw_enable_interrupts();
+        auto result = task->address_space().handle_page_fault(address, flags);
+        raw_disable_interrupts();
+
+        if (result) {
+            return IrqStatus::Handled;
+        }
+    }
+
+    if (instruction_pointer == kernel_userspace_copy_instruction) {
+        context.task_state.set_instruction_pointer(kernel_userspace_copy_return.raw_value());
+        context.task_state.rax = di::to_underlying(Error::BadAddress);
+        return IrqStatus::Handled;
+    }
+
+    println("ERROR: Unexpected page fault: ip={}, address={}, error_code={:#x}"_sv, instruction_pointer, address,
+            context.error_code);
+    ASSERT(false);
+    return IrqStatus::Handled;
+}
+}
+
+namespace iris::x86::amd64 {
+void init_page_fault_handler() {
+    // NOTE: page faults are handled without holding the IRQ handler lock, since resolving them can require waiting for
+    // other processors, which may themselves be trying to handle an IRQ.
+    register_unlocked_exception_handler(GlobalIrqNumber(14), handle_page_fault);
+}
+}
@@ -0,0 +1,71 @@
+#include <iris/core/global_state.h>
+#include <iris/core/print.h>
+#include <iris/mm/map_physical_address.h>
+#include <iris/mm/page_operations.h>
+
+namespace iris::mm {
+static void clear_page_rep_stosq(byte* page) {
+    auto count = 4096zu / sizeof(u64);
+    asm volatile("rep stosq" : "+D"(page), "+c"(count) : "a"(0_u64) : "memory");
+}
+
+static void clear_page_rep_stosb(byte* page) {
+    auto count = 4096zu;
+    asm volatile("rep stosb" : "+D"(page), "+c"(count) : "a"(0_u64) : "memory");
+}
+
+static void copy_page_rep_movsq(byte* destination, byte const* source) {
+    auto count = 4096zu / sizeof(u64);
+    asm volatile("rep movsq" : "+D"(destination), "+S"(source), "+c"(count) : : "memory");
+}
+
+static void copy_page_rep_movsb(byte* destination, byte const* source) {
+    auto count = 4096zu;
+    asm volatile("rep movsb" : "+D"(destination), "+S"(source), "+c"(count) : : "memory");
+}
+
+// These are only written to while booting the first processor, so they can be read without synchronization.
+static auto clear_page_impl = &clear_page_rep_stosq;
+static auto copy_page_impl = &copy_page_rep_movsq;
+
+void init_page_operations() {
+    // With ERMS, the byte variants are the fastest way to clear or copy memory. Otherwise, moving 8 bytes at a time is
+    // faster.
+    if (global_state().processor_info.has_erms()) {
+        clear_page_impl = &clear_page_rep_stosb;
+        copy_page_impl = &copy_page_rep_movsb;
+        println("Using rep stosb and rep movsb for page operations."_sv);
+    }
+}
+
+void clear_page(PhysicalAddress page) {
+    clear_page_impl(&(*map_physical_address(page, 4096)).typed<byte>());
+}
+
+void clear_page_non_temporal(PhysicalAddress page) {
+    // movnti is part of SSE2, which every x86_64 processor supports. It only uses general purpose registers, so it does
+    // not touch any FPU state.
+    auto* data = &(*map_physical_address(page, 4096)).typed<byte>();
+    for (auto* line = data; line < data + 4096; line += 64) {
+        asm volatile("movnti %1, 0(%0)\n"
+                     "movnti %1, 8(%0)\n"
+                     "movnti %1, 16(%0)\n"
+                     "movnti %1, 24(%0)\n"
+                     "movnti %1, 32(%0)\n"
+                     "movnti %1, 40(%0)\n"
+                     "movnti %1, 48(%0)\n"
+                     "movnti %1, 56(%0)\n"
+                     :
+                     : "r"(line), "r"(0_u64)
+                     : "memory");
+    }
+
+    // Non-temporal stores are weakly ordered, so make sure they are visible before the page is handed out.
+    asm volatile("sfence" ::: "memory");
+}
+
+void copy_page(PhysicalAddress destination, PhysicalAddress source) {
+    copy_page_impl(&(*map_physical_address(destination, 4096)).typed<byte>(),
+                   &(*map_physical_address(source, 4096)).typed<byte const>());
+}
+}
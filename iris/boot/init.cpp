@@ -78,7 +78,6 @@ void iris_main() {
 
     auto& global_state = global_state_in_boot();
     global_state.heap_start = iris::mm::VirtualAddress(di::align_up(iris::mm::kernel_end.raw_value(), 4096));
-    global_state.heap_end = global_state.heap_start;
 
     auto memory_map = di::Span { memmap_request.response->entries, memmap_request.response->entry_count };
 
@@ -87,6 +86,21 @@ void iris_main() {
                                                     return mm::PhysicalAddress(entry->base) + entry->length;
                                                 }));
 
+    // The page frame allocator needs a byte of metadata for every physical page. Place it in the first usable memory
+    // region which is large enough, skipping the low memory which is reserved below.
+    auto const low_memory_end = mm::PhysicalAddress(16 * 16 * 2 * 4096);
+    auto const metadata_size = mm::page_frame_allocator_metadata_size(global_state.max_physical_address);
+    auto const* metadata_entry = di::find_if(memory_map, [&](auto* entry) {
+        auto base = di::max(mm::PhysicalAddress(di::align_up(entry->base, 4096)), low_memory_end);
+        return entry->type == LIMINE_MEMMAP_USABLE &&
+               base + metadata_size <= mm::PhysicalAddress(entry->base) + entry->length;
+    });
+    ASSERT(metadata_entry != memory_map.end());
+    auto const metadata_base =
+        di::max(mm::PhysicalAddress(di::align_up((*metadata_entry)->base, 4096)), low_memory_end);
+    iris::println("Placing page frame allocator metadata at {} ({} bytes)."_sv, metadata_base, metadata_size);
+    iris::mm::init_page_frame_allocator(global_state.max_physical_address, metadata_base);
+
     for (auto* memory_map_entry : memory_map) {
         iris::println("Memory map entry: type: {}, base: {:#018x}, length: {:#018x}"_sv, memory_map_entry->type,
                       memory_map_entry->base, memory_map_entry->length);
@@ -99,7 +113,7 @@ void iris_main() {
         }
     }
 
-    iris::mm::reserve_page_frames(iris::mm::PhysicalAddress(0), 16 * 16 * 2);
+    iris::mm::reserve_page_frames(iris::mm::PhysicalAddress(0), low_memory_end.raw_value() / 4096);
 
     ASSERT_GT(module_request.response->module_count, 0u);
     auto initrd_module = *module_request.response->modules[0];
@@ -0,0 +1,26 @@
+#include <iris/core/clock.h>
+#include <iris/core/global_state.h>
+
+namespace iris {
+di::Nanoseconds monotonic_time() {
+    auto const& global_state = iris::global_state();
+    auto cycles_per_ms = global_state.cycle_counter_cycles_per_ms;
+    if (cycles_per_ms == 0) {
+        return global_state.boot_processor.scheduler().ticks() * di::Nanoseconds(scheduler_tick_interval);
+    }
+
+    // Split the conversion, so that the intermediate result does not overflow.
+    auto cycles = arch::read_cycle_counter() - global_state.boot_cycle_counter;
+    auto whole_ms = cycles / cycles_per_ms;
+    auto remainder_ns = (cycles % cycles_per_ms) * 1'000'000 / cycles_per_ms;
+    return di::Nanoseconds(i64(whole_ms * 1'000'000 + remainder_ns));
+}
+
+di::Nanoseconds deadline_after(di::Nanoseconds duration) {
+    auto now = monotonic_time();
+    if (duration.count() > di::NumericLimits<i64>::max - now.count()) {
+        return di::Nanoseconds(di::NumericLimits<i64>::max);
+    }
+    return now + duration;
+}
+}
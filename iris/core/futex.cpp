@@ -0,0 +1,106 @@
+#include <iris/core/futex.h>
+#include <iris/core/global_state.h>
+#include <iris/core/userspace_ptr.h>
+#include <iris/mm/map_physical_address.h>
+
+namespace iris {
+// Futexes are keyed by physical address, so that tasks which map the same memory at different addresses share a futex.
+// Copy-on-write sharing is broken before computing the key, since otherwise a waiter could key on the shared page while
+// the waker's store moves it onto a private copy.
+static Expected<mm::PhysicalAddress> futex_key(mm::AddressSpace& address_space, u32 const* address) {
+    if (di::to_uintptr(address) % alignof(u32) != 0) {
+        return di::Unexpected(Error::InvalidArgument);
+    }
+
+    // Reading the futex word faults in its page if needed, and validates the address.
+    auto pointer = TRY(di::create<UserspacePtr<u32 const>>(address));
+    TRY(pointer.read());
+
+    auto page_offset = di::to_uintptr(address) % 4096;
+    auto page_address = mm::VirtualAddress(di::to_uintptr(address) - page_offset);
+    for (;;) {
+        // Usually the page is already mapped and writable, and can be keyed without touching the page tables.
+        auto page = address_space.with_lock([&](mm::LockedAddressSpace& locked) {
+            return locked.translate_for_write(page_address);
+        });
+        if (page) {
+            return *page + page_offset;
+        }
+
+        // Otherwise, the page is either missing or still shared, and a write fault maps in the page which writes to the
+        // futex word will actually land in.
+        TRY(address_space.fault_in_page(page_address, mm::PageFaultFlags::Present | mm::PageFaultFlags::Write |
+                                                          mm::PageFaultFlags::User));
+    }
+}
+
+static FutexBucket& bucket_for(mm::PhysicalAddress key) {
+    auto hash = (key.raw_value() / alignof(u32)) * 0x9E3779B97F4A7C15_u64;
+    return global_state().futex_buckets[usize(hash >> 32) % futex_bucket_count];
+}
+
+Expected<void> futex_wait(mm::AddressSpace& address_space, u32 const* address, u32 expected_value,
+                          di::Optional<di::Nanoseconds> deadline) {
+    auto key = TRY(futex_key(address_space, address));
+    auto& bucket = bucket_for(key);
+
+    // The futex word is read through the physical memory map, since the bucket's lock is held while reading it.
+    auto mapping = TRY(mm::map_physical_address(key, sizeof(u32)));
+    auto& word = mapping.typed<u32>();
+
+    // Queue the waiter before releasing the bucket's lock, so that a waker which stores to the futex word after it was
+    // read here finds the waiter.
+    auto waiter = FutexWaiter {};
+    waiter.key = key;
+    auto value_changed = bucket.waiters.with_lock([&](di::IntrusiveList<FutexWaiter>& waiters) {
+        if (di::AtomicRef(word).load(di::MemoryOrder::SequentialConsistency) != expected_value) {
+            return true;
+        }
+        waiters.push_back(waiter);
+        return false;
+    });
+    if (value_changed) {
+        return di::Unexpected(Error::ResourceUnavailableTryAgain);
+    }
+
+    auto predicate = [&] {
+        return waiter.woken;
+    };
+    auto result = deadline ? waiter.wait_queue.wait_until(*deadline, predicate) : waiter.wait_queue.wait(predicate);
+
+    // A wake which raced with the timeout still counts, since the waker has already counted this task. Taking the lock
+    // also ensures the waker is done with the waiter before it goes out of scope.
+    auto woken = bucket.waiters.with_lock([&](di::IntrusiveList<FutexWaiter>& waiters) {
+        if (!waiter.woken) {
+            waiters.erase(decltype(waiters.begin())(waiter));
+        }
+        return waiter.woken;
+    });
+    if (woken) {
+        return {};
+    }
+    return result;
+}
+
+Expected<u32> futex_wake(mm::AddressSpace& address_space, u32 const* address, u32 count) {
+    auto key = TRY(futex_key(address_space, address));
+    auto& bucket = bucket_for(key);
+
+    return bucket.waiters.with_lock([&](di::IntrusiveList<FutexWaiter>& waiters) {
+        auto woken = 0_u32;
+        for (auto it = waiters.begin(); it != waiters.end() && woken < count;) {
+            if (it->key != key) {
+                ++it;
+                continue;
+            }
+            auto& waiter = *it;
+            it = waiters.erase(it);
+            waiter.wait_queue.notify_one([&] {
+                waiter.woken = true;
+            });
+            woken++;
+        }
+        return woken;
+    });
+}
+}
@@ -0,0 +1,56 @@
+#include <iris/core/ipi_inbox.h>
+#include <iris/core/task.h>
+
+namespace iris {
+bool IpiInbox::post_task_to_schedule(Task& task) {
+    auto* head = m_tasks_to_schedule.load(di::MemoryOrder::Relaxed);
+    do {
+        task.set_next_in_ipi_inbox(head);
+    } while (!m_tasks_to_schedule.compare_exchange_weak(head, &task, di::MemoryOrder::Release,
+                                                        di::MemoryOrder::Relaxed));
+    return mark_interrupt_pending();
+}
+
+bool IpiInbox::post_tlb_flush(u32 sender_processor_id) {
+    ASSERT_LT(sender_processor_id, max_processors);
+    m_tlb_flush_senders[sender_processor_id / 64].fetch_or(1_u64 << (sender_processor_id % 64),
+                                                           di::MemoryOrder::Release);
+    return mark_interrupt_pending();
+}
+
+bool IpiInbox::post_page_frame_cache_drain(u32 sender_processor_id) {
+    ASSERT_LT(sender_processor_id, max_processors);
+    m_page_frame_cache_drain_senders[sender_processor_id / 64].fetch_or(1_u64 << (sender_processor_id % 64),
+                                                                        di::MemoryOrder::Release);
+    return mark_interrupt_pending();
+}
+
+bool IpiInbox::mark_interrupt_pending() {
+    // The exchange also publishes the message to the owner, which acquires this flag before taking messages.
+    return !m_interrupt_pending.exchange(true, di::MemoryOrder::AcquireRelease);
+}
+
+IpiInbox::Messages IpiInbox::take() {
+    // Clear the flag before taking messages, so that a message posted concurrently is either taken now, or raises
+    // another interrupt.
+    m_interrupt_pending.exchange(false, di::MemoryOrder::AcquireRelease);
+
+    auto result = Messages {};
+    for (auto [senders, pending] : di::zip(result.tlb_flush_senders, m_tlb_flush_senders)) {
+        senders = pending.exchange(0, di::MemoryOrder::Acquire);
+    }
+    for (auto [senders, pending] : di::zip(result.page_frame_cache_drain_senders, m_page_frame_cache_drain_senders)) {
+        senders = pending.exchange(0, di::MemoryOrder::Acquire);
+    }
+
+    // Tasks are pushed onto the front of the list, so reverse it to schedule them in the order they were posted.
+    auto* task = m_tasks_to_schedule.exchange(nullptr, di::MemoryOrder::Acquire);
+    while (task) {
+        auto* next = task->next_in_ipi_inbox();
+        task->set_next_in_ipi_inbox(result.tasks_to_schedule);
+        result.tasks_to_schedule = task;
+        task = next;
+    }
+    return result;
+}
+}
@@ -0,0 +1,82 @@
+#include <iris/core/global_state.h>
+#include <iris/core/interrupt_disabler.h>
+#include <iris/core/mutex.h>
+#include <iris/core/task.h>
+
+namespace iris {
+static Task* current_task_null_if_during_boot() {
+    return with_interrupts_disabled([] {
+        // SAFETY: This is safe since interrupts are disabled.
+        return current_processor_unsafe().scheduler().current_task_null_if_during_boot();
+    });
+}
+
+void Mutex::lock() {
+    // Contending tasks may have to sleep until the owner runs again, which is impossible when they cannot be switched
+    // away from. During boot, there is nothing else which could hold the lock.
+    auto* task = current_task_null_if_during_boot();
+    ASSERT(!task || !interrupts_disabled());
+    ASSERT(!task || !task->preemption_disabled());
+
+    if (try_lock()) {
+        return;
+    }
+
+    for (;;) {
+        // Spin while the owner is running, since it will likely release the lock soon.
+        for (;;) {
+            if (!m_state.load(di::MemoryOrder::Relaxed)) {
+                if (try_lock()) {
+                    return;
+                }
+                continue;
+            }
+            if (task && !owner_running()) {
+                break;
+            }
+            di::cpu_relax();
+        }
+
+        // Registering as a waiter before trying to acquire the lock ensures that the owner either notices the waiter
+        // when unlocking, or unlocks before the attempt.
+        m_waiter_count.fetch_add(1, di::MemoryOrder::SequentialConsistency);
+        auto result = m_wait_queue.wait([&] {
+            return try_lock();
+        });
+        m_waiter_count.fetch_sub(1, di::MemoryOrder::Relaxed);
+        if (result) {
+            return;
+        }
+    }
+}
+
+bool Mutex::owner_running() const {
+    // The owner may have already released the lock and exited, so it is only compared against the task running on the
+    // processor it acquired the lock on, and never dereferenced. Processors are never destroyed. If the owner has since
+    // migrated, it is treated as not running, which only means waiters go to sleep earlier than necessary.
+    auto* owner = m_owner.load(di::MemoryOrder::Relaxed);
+    auto* processor = m_owner_processor.load(di::MemoryOrder::Relaxed);
+    return owner && processor && processor->scheduler().running_task() == owner;
+}
+
+bool Mutex::try_lock() {
+    if (m_state.exchange(true, di::MemoryOrder::SequentialConsistency)) {
+        return false;
+    }
+    with_interrupts_disabled([&] {
+        // SAFETY: This is safe since interrupts are disabled.
+        auto& processor = current_processor_unsafe();
+        m_owner.store(processor.scheduler().current_task_null_if_during_boot(), di::MemoryOrder::Relaxed);
+        m_owner_processor.store(&processor, di::MemoryOrder::Relaxed);
+    });
+    return true;
+}
+
+void Mutex::unlock() {
+    m_owner.store(nullptr, di::MemoryOrder::Relaxed);
+    m_state.store(false, di::MemoryOrder::SequentialConsistency);
+    if (m_waiter_count.load(di::MemoryOrder::SequentialConsistency) > 0) {
+        m_wait_queue.notify_one([] {});
+    }
+}
+}
@@ -0,0 +1,115 @@
+#include <iris/core/global_state.h>
+#include <iris/core/queued_spinlock.h>
+
+namespace iris {
+struct QueuedSpinlock::Node {
+    di::sync::Atomic<Node*> next { nullptr };
+    di::sync::Atomic<bool> waiting { true };
+};
+
+#ifdef IRIS_LOCK_STATISTICS
+static void record_acquisition(LockStatistics& statistics, bool contended, u64 spin_iterations) {
+    statistics.acquisitions.fetch_add(1, di::MemoryOrder::Relaxed);
+    if (contended) {
+        statistics.contended_acquisitions.fetch_add(1, di::MemoryOrder::Relaxed);
+        statistics.spin_iterations.fetch_add(spin_iterations, di::MemoryOrder::Relaxed);
+    }
+    statistics.acquired_at = arch::read_cycle_counter();
+}
+
+static void record_release(LockStatistics& statistics) {
+    auto hold_cycles = arch::read_cycle_counter() - statistics.acquired_at;
+    statistics.total_hold_cycles.fetch_add(hold_cycles, di::MemoryOrder::Relaxed);
+
+    auto max_hold_cycles = statistics.max_hold_cycles.load(di::MemoryOrder::Relaxed);
+    while (hold_cycles > max_hold_cycles &&
+           !statistics.max_hold_cycles.compare_exchange_weak(max_hold_cycles, hold_cycles, di::MemoryOrder::Relaxed)) {}
+}
+#endif
+
+void QueuedSpinlock::lock() {
+    auto interrupts_were_disabled = raw_disable_interrupts_and_save_previous_state();
+
+    // Take the lock directly when no one is queued for it, which keeps the uncontended case to a single atomic.
+    auto contended = false;
+    auto spin_iterations = 0_u64;
+    if (m_tail.load(di::MemoryOrder::Relaxed) || m_locked.exchange(true, di::MemoryOrder::Acquire)) {
+        contended = true;
+        spin_iterations = wait_in_queue();
+    }
+
+    m_interrupts_were_disabled = interrupts_were_disabled;
+#ifdef IRIS_LOCK_STATISTICS
+    record_acquisition(m_statistics, contended, spin_iterations);
+#else
+    (void) contended;
+    (void) spin_iterations;
+#endif
+}
+
+u64 QueuedSpinlock::wait_in_queue() {
+    auto node = Node {};
+    auto spin_iterations = 0_u64;
+
+    auto* previous = m_tail.exchange(&node, di::MemoryOrder::AcquireRelease);
+    if (previous) {
+        previous->next.store(&node, di::MemoryOrder::Release);
+        while (node.waiting.load(di::MemoryOrder::Acquire)) {
+            di::cpu_relax();
+            spin_iterations++;
+        }
+    }
+
+    // Only the head of the queue polls the lock itself.
+    while (m_locked.exchange(true, di::MemoryOrder::Acquire)) {
+        while (m_locked.load(di::MemoryOrder::Relaxed)) {
+            di::cpu_relax();
+            spin_iterations++;
+        }
+    }
+
+    // Make the next waiter the head of the queue. If there is none, the queue is emptied, unless a new waiter is in the
+    // middle of linking itself to this node.
+    auto* next = node.next.load(di::MemoryOrder::Acquire);
+    if (!next) {
+        auto* expected = &node;
+        if (m_tail.compare_exchange_strong(expected, nullptr, di::MemoryOrder::AcquireRelease,
+                                           di::MemoryOrder::Acquire)) {
+            return spin_iterations;
+        }
+        while (!(next = node.next.load(di::MemoryOrder::Acquire))) {
+            di::cpu_relax();
+        }
+    }
+    next->waiting.store(false, di::MemoryOrder::Release);
+    return spin_iterations;
+}
+
+bool QueuedSpinlock::try_lock() {
+    auto interrupts_were_disabled = raw_disable_interrupts_and_save_previous_state();
+    if (m_tail.load(di::MemoryOrder::Relaxed) || m_locked.exchange(true, di::MemoryOrder::Acquire)) {
+        if (!interrupts_were_disabled) {
+            raw_enable_interrupts();
+        }
+        return false;
+    }
+
+    m_interrupts_were_disabled = interrupts_were_disabled;
+#ifdef IRIS_LOCK_STATISTICS
+    record_acquisition(m_statistics, false, 0);
+#endif
+    return true;
+}
+
+void QueuedSpinlock::unlock() {
+#ifdef IRIS_LOCK_STATISTICS
+    record_release(m_statistics);
+#endif
+
+    auto interrupts_were_disabled = m_interrupts_were_disabled;
+    m_locked.store(false, di::MemoryOrder::Release);
+    if (!interrupts_were_disabled) {
+        raw_enable_interrupts();
+    }
+}
+}
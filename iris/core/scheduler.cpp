@@ -1,20 +1,277 @@
+#include <iris/core/clock.h>
 #include <iris/core/global_state.h>
 #include <iris/core/interrupt_disabler.h>
 #include <iris/core/print.h>
 #include <iris/core/scheduler.h>
 #include <iris/hw/irq.h>
 #include <iris/hw/timer.h>
+#include <iris/mm/page_frame_allocator.h>
 
 namespace iris {
 void Scheduler::schedule_task(Task& task) {
     task.set_runnable();
-    m_run_queue.push(task);
+    enqueue_task(task);
+
+    // The current task may have been running alone, without a timer.
+    update_timer(false);
 }
 
-static void do_idle() {
-    // x86_64 specific. Enables IRQs and then halt.
+void Scheduler::insert_task(RunQueue& queue, Task& task) {
+    if (task.scheduling_class() == SchedulingClass::RealTimeFifo) {
+        queue.real_time_tasks.push_back(task);
+    } else {
+        queue.fair_tasks.insert(task);
+    }
+    m_queued_task_count.fetch_add(1, di::MemoryOrder::Relaxed);
+}
+
+void Scheduler::enqueue_task(Task& task) {
+    m_run_queue.with_lock([&](RunQueue& queue) {
+        // Tasks which slept for a long time get a small amount of credit, so that they run soon after waking up.
+        // Without a limit, they would monopolize the processor until they caught up with every other task.
+        auto sleeper_credit = di::Nanoseconds(scheduler_sleeper_credit).count();
+        task.set_vruntime(di::max(task.vruntime() + queue.min_vruntime, queue.min_vruntime - sleeper_credit));
+        insert_task(queue, task);
+    });
+}
+
+void Scheduler::requeue_task(Task& task) {
+    m_run_queue.with_lock([&](RunQueue& queue) {
+        insert_task(queue, task);
+    });
+}
+
+void Scheduler::detach_task(Task& task) {
+    m_run_queue.with_lock([&](RunQueue& queue) {
+        update_min_vruntime(queue, &task);
+        task.set_vruntime(task.vruntime() - queue.min_vruntime);
+    });
+}
+
+void Scheduler::update_min_vruntime(RunQueue& queue, Task* running_task) {
+    auto min_vruntime = di::Optional<i64> {};
+    if (auto leftmost = queue.fair_tasks.front()) {
+        min_vruntime = leftmost->vruntime();
+    }
+    if (running_task && running_task != m_idle_task.get() &&
+        running_task->scheduling_class() == SchedulingClass::Fair) {
+        min_vruntime = di::min(min_vruntime.value_or(running_task->vruntime()), running_task->vruntime());
+    }
+    if (min_vruntime) {
+        queue.min_vruntime = di::max(queue.min_vruntime, *min_vruntime);
+    }
+}
+
+Task* Scheduler::pop_task() {
+    return m_run_queue.with_lock([&](RunQueue& queue) -> Task* {
+        // Real-time tasks always run before fair tasks, and fair tasks run in order of their virtual runtime.
+        auto* task = static_cast<Task*>(nullptr);
+        if (auto real_time_task = queue.real_time_tasks.pop_front()) {
+            task = di::addressof(*real_time_task);
+        } else if (auto fair_task = queue.fair_tasks.front()) {
+            task = di::addressof(*fair_task);
+            queue.fair_tasks.erase(decltype(queue.fair_tasks.begin())(*task));
+        } else {
+            return nullptr;
+        }
+        m_queued_task_count.fetch_sub(1, di::MemoryOrder::Relaxed);
+        update_min_vruntime(queue, task);
+        return task;
+    });
+}
+
+Task* Scheduler::take_task_for_migration() {
+    return m_run_queue.with_lock([&](RunQueue& queue) -> Task* {
+        auto take = [&](Task& task) {
+            m_queued_task_count.fetch_sub(1, di::MemoryOrder::Relaxed);
+            task.set_vruntime(task.vruntime() - queue.min_vruntime);
+            return di::addressof(task);
+        };
+
+        // Prefer the task which would otherwise run last, since it is the least likely to be cache hot.
+        for (auto it = queue.fair_tasks.end(); it != queue.fair_tasks.begin();) {
+            --it;
+            auto& task = *it;
+            if (!task.on_processor()) {
+                queue.fair_tasks.erase(it);
+                return take(task);
+            }
+        }
+        for (auto it = queue.real_time_tasks.end(); it != queue.real_time_tasks.begin();) {
+            --it;
+            auto& task = *it;
+            if (!task.on_processor()) {
+                queue.real_time_tasks.erase(it);
+                return take(task);
+            }
+        }
+        return nullptr;
+    });
+}
+
+#ifdef IRIS_UNIT_TESTS
+static auto round_robin_placement = di::Atomic<bool> { false };
+static auto next_round_robin_processor = di::Atomic<u32> { 0 };
+
+void test::set_task_placement(TaskPlacement placement) {
+    round_robin_placement.store(placement == TaskPlacement::RoundRobin, di::MemoryOrder::Relaxed);
+}
+#endif
+
+// The processor map is only complete once every processor has booted, and there is nothing to steal before then.
+static bool other_processors_available() {
+#ifdef IRIS_UNIT_TESTS
+    if (round_robin_placement.load(di::MemoryOrder::Relaxed)) {
+        return false;
+    }
+#endif
+    return global_state().all_aps_booted.load(di::MemoryOrder::Acquire);
+}
+
+Task* Scheduler::steal_task() {
+    if (!other_processors_available()) {
+        return nullptr;
+    }
+
+    for (auto [_, processor] : global_state().processor_map) {
+        auto& victim = processor->scheduler();
+        if (&victim == this || victim.queued_task_count() == 0) {
+            continue;
+        }
+        if (auto* task = victim.take_task_for_migration()) {
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void Scheduler::balance_load() {
+    if (!other_processors_available()) {
+        return;
+    }
+
+    auto* least_loaded = static_cast<Processor*>(nullptr);
+    for (auto [_, processor] : global_state().processor_map) {
+        auto& scheduler = processor->scheduler();
+        if (&scheduler != this && (!least_loaded || scheduler.load() < least_loaded->scheduler().load())) {
+            least_loaded = processor;
+        }
+    }
+
+    // Only move a task when doing so makes the load more even, to avoid bouncing tasks back and forth.
+    if (!least_loaded || load() <= least_loaded->scheduler().load() + 1) {
+        return;
+    }
+    if (auto* task = take_task_for_migration()) {
+        // SAFETY: This is safe since interrupts are disabled.
+        current_processor_unsafe().send_task_to_schedule(least_loaded->id(), *task);
+    }
+}
+
+void Scheduler::update_timer(bool new_timeslice) {
+    // Periodic timers fire regardless of whether there is anything to do.
+    if (!m_tickless) {
+        return;
+    }
+
+    // The timer must fire for the next kernel timer, and at the end of the current timeslice if other tasks are
+    // waiting. A task running on its own never needs to be preempted, and the idle task yields as soon as work arrives.
+    auto now = monotonic_time();
+    auto deadline = m_timer_wheel.next_event();
+    if (m_current_task && m_current_task != m_idle_task.get() && queued_task_count() > 0) {
+        if (new_timeslice || !m_timeslice_end || *m_timeslice_end <= now) {
+            auto timeslice = di::max(di::Nanoseconds(scheduler_target_latency) / load(),
+                                     di::Nanoseconds(scheduler_min_timeslice));
+            m_timeslice_end = now + timeslice;
+        }
+        deadline = di::min(deadline.value_or(*m_timeslice_end), *m_timeslice_end);
+    } else {
+        m_timeslice_end = di::nullopt;
+    }
+
+    if (!deadline) {
+        if (m_timer_armed) {
+            (void) timer_stop(scheduler_timer_unlocked());
+            m_timer_armed = false;
+        }
+        return;
+    }
+    if (m_timer_armed && m_timer_deadline == *deadline) {
+        return;
+    }
+
+    // Tickless scheduling requires a per-CPU timer, so this only programs the current processor's timer, and does not
+    // need to serialize with the other processors.
+    auto duration = di::max(*deadline - now, di::Nanoseconds(0));
+    (void) timer_restart_single_shot(scheduler_timer_unlocked(), duration);
+    m_timer_armed = true;
+    m_timer_deadline = *deadline;
+}
+
+void Scheduler::add_timer(KernelTimer& timer, di::Nanoseconds deadline) {
+    m_timer_wheel.add(timer, deadline);
+    update_timer(false);
+}
+
+void Scheduler::tick() {
+    // A single-shot timer is disarmed once it fires.
+    m_timer_armed = false;
+    m_ticks.fetch_add(1, di::MemoryOrder::Relaxed);
+}
+
+void Scheduler::account_current_task() {
+    auto now = monotonic_time();
+    auto& task = *m_current_task;
+    auto elapsed = di::max((now - task.run_start()).count(), 0_i64);
+    task.set_run_start(now);
+
+    // Real-time tasks are not scheduled by virtual runtime, so there is nothing to charge them.
+    if (&task == m_idle_task.get() || task.scheduling_class() != SchedulingClass::Fair) {
+        return;
+    }
+    task.set_vruntime(task.vruntime() + i64(elapsed * nice_0_weight / nice_to_weight(task.nice())));
+}
+
+bool Scheduler::should_preempt_current_task() {
+    auto& task = *m_current_task;
+    if (&task == m_idle_task.get()) {
+        return true;
+    }
+    if (task.scheduling_class() == SchedulingClass::RealTimeFifo) {
+        return false;
+    }
+
+    // Keep running the current task until some other task has received less processor time than it.
+    account_current_task();
+    return m_run_queue.with_lock([&](RunQueue& queue) {
+        update_min_vruntime(queue, &task);
+        if (!queue.real_time_tasks.empty()) {
+            return true;
+        }
+        auto leftmost = queue.fair_tasks.front();
+        return leftmost && leftmost->vruntime() < task.vruntime();
+    });
+}
 
+static void do_idle() {
+    // SAFETY: The idle task never migrates between processors.
+    auto& scheduler = current_processor_unsafe().scheduler();
     for (;;) {
+        // Use idle time to zero pages ahead of time, so that page allocations can skip zeroing. Interrupts are enabled
+        // while doing so, so that tasks can be woken up by interrupts.
+        raw_enable_interrupts();
+        while (scheduler.queued_task_count() == 0 && mm::refill_zeroed_page_pool()) {}
+        raw_disable_interrupts();
+
+        // The scheduler timer is stopped while idle, so the idle task must give up the processor by itself once a task
+        // is woken up on this processor.
+        if (scheduler.queued_task_count() != 0) {
+            scheduler.yield();
+            continue;
+        }
+
+        // x86_64 specific. Enables IRQs and then halt. Since interrupts are only enabled after the next instruction,
+        // no wake up can be missed between checking the run queue and halting.
         asm volatile("sti\n"
                      "hlt\n"
                      "cli\n");
@@ -30,93 +287,147 @@ void Scheduler::setup_idle_task() {
     m_idle_task = *create_kernel_task(global_state().task_namespace, do_idle);
 }
 
+void Scheduler::handle_timer_interrupt(IrqContext& context) {
+    tick();
+    m_timer_wheel.expire(monotonic_time());
+    balance_load();
+
+    if (!should_preempt_current_task()) {
+        update_timer(false);
+        return;
+    }
+
+    // If preemption is disabled, do not reshcedule the currently running task but let it know
+    // that it should yield whenever it finally re-enables preemption.
+    auto& current_task = this->current_task();
+    if (current_task.preemption_disabled()) {
+        current_task.set_should_be_preempted();
+        update_timer(false);
+        return;
+    }
+
+    // Manually unlock the IRQ list before jumping away.
+    global_state().irq_handlers.get_lock().unlock();
+    save_state_and_run_next(&context.task_state);
+}
+
 void Scheduler::start_on_ap() {
-    // Setup timer interrupt.
-    auto& scheduler_timer = iris::scheduler_timer();
-    *timer_set_interval(*scheduler_timer.lock(), 5_ms, [](IrqContext& context) {
+    // Setup timer interrupt. Timers which can be programmed separately on each processor only fire when there is more
+    // than one task to run. Otherwise, fall back to a fixed tick.
+    auto handler = [](IrqContext& context) {
         // SAFETY: This is safe since interrupts are disabled.
-        auto& scheduler = current_processor_unsafe().scheduler();
-
-        // If preemption is disabled, do not reshcedule the currently running task but let it know
-        // that it should yield whenever it finally re-enables preemption.
-        auto& current_task = scheduler.current_task();
-        if (current_task.preemption_disabled()) {
-            current_task.set_should_be_preempted();
-            return;
+        current_processor_unsafe().scheduler().handle_timer_interrupt(context);
+    };
+    {
+        auto timer = scheduler_timer().lock();
+        auto capabilities = timer_capabilities(*timer);
+        m_tickless = !!(capabilities & TimerCapabilities::SingleShot) && !!(capabilities & TimerCapabilities::PerCpu);
+        if (m_tickless) {
+            *timer_set_single_shot(*timer, TimerResolution(scheduler_min_timeslice), handler);
+            m_timer_armed = true;
+        } else {
+            *timer_set_interval(*timer, scheduler_tick_interval, handler);
         }
-
-        // Manually unlock the IRQ list before jumping away.
-        global_state().irq_handlers.get_lock().unlock();
-        scheduler.save_state_and_run_next(&context.task_state);
-    });
+    }
 
     // SAFETY: This is safe since interrupts are disabled.
     current_processor_unsafe().mark_as_online();
-    run_next();
+    run_next(nullptr);
 }
 
 [[gnu::naked]] void Scheduler::yield() {
-    // To yield a task, we must first save its current state, so that it can be resumed later. Instead of setting %rip
-    // based on the current instruction pointer, set %rip to the function return address, so that the task will resume
-    // where it left off. Once the task state is saved, simply call Scheduler::save_state_and_run_next() which performs
-    // the context switch to the next task. In the current implementation, the task state is pushed onto the stack,
-    // which is then passed to a c++ function. It would be more efficent to save the relevant registers directly into
-    // the current task pointer, but this would be even more complicated. Additionally, only registers which are not
-    // preserved by the SYS-V ABI need to be saved. Also, when the task is resumed, interrupts will be enabled.
-    asm volatile("popq %rax\n"
-                 "movq %rsp, %rdx\n"
-
-                 "pushq $0x00\n"
-                 "pushq %rdx\n"
+    // To yield a task, we must first save its current state, so that it can be resumed later. Since yield() is called
+    // like any other function, only the registers which the SYS-V ABI requires a function to preserve need to be saved.
+    // These are pushed onto the stack, below the return address, along with the flags, so that the task resumes with
+    // interrupts in the same state. The resulting stack pointer is then passed to
+    // Scheduler::save_kernel_context_and_run_next(), which performs the context switch to the next task. When the task
+    // is resumed, arch::switch_to_kernel_context() pops the registers and returns to the caller.
+    asm volatile("pushq %rbp\n"
+                 "pushq %rbx\n"
+                 "pushq %r12\n"
+                 "pushq %r13\n"
+                 "pushq %r14\n"
+                 "pushq %r15\n"
                  "pushfq\n"
-                 "pushq $0x28\n"
-                 "pushq %rax\n"
-
-                 "push %rax\n"
-                 "push %rbx\n"
-                 "push %rcx\n"
-                 "push %rdx\n"
-                 "push %rsi\n"
-                 "push %rdi\n"
-                 "push %rbp\n"
-                 "push %r8\n"
-                 "push %r9\n"
-                 "push %r10\n"
-                 "push %r11\n"
-                 "push %r12\n"
-                 "push %r13\n"
-                 "push %r14\n"
-                 "push %r15\n"
 
                  "mov %rsp, %rsi\n"
                  "subq $8, %rsp\n"
-                 "jmp _ZN4iris9Scheduler23save_state_and_run_nextEPNS_4arch9TaskStateE\n");
+                 "jmp _ZN4iris9Scheduler32save_kernel_context_and_run_nextEm\n");
 }
 
-void Scheduler::run_next() {
-    // If there is nothing to run, execute the idle task.
-    auto& next = m_run_queue.pop().value_or(*m_idle_task);
-    m_current_task = di::addressof(next);
-    next.context_switch_to();
+void Scheduler::run_next(Task* outgoing_task) {
+    m_running_task.store(nullptr, di::MemoryOrder::Relaxed);
+
+    // This processor is still running on the outgoing task's stack, but it has finished switching away from the task
+    // before it, which can now safely run on other processors.
+    if (m_previous_task && m_previous_task != outgoing_task) {
+        m_previous_task->set_on_processor(false);
+    }
+    m_previous_task = outgoing_task;
+
+    // If there is nothing to run, try to take work from other processors before executing the idle task.
+    auto* next = pop_task();
+    if (!next) {
+        if (auto* task = steal_task()) {
+            enqueue_task(*task);
+            next = pop_task();
+        }
+    }
+    if (!next) {
+        next = m_idle_task.get();
+    }
+
+    m_running_idle_task.store(next == m_idle_task.get(), di::MemoryOrder::Relaxed);
+    next->set_run_start(monotonic_time());
+    next->set_on_processor(true);
+    // SAFETY: This is safe since interrupts are disabled.
+    next->set_last_processor_id(current_processor_unsafe().id());
+
+    m_current_task = next;
+    m_running_task.store(next, di::MemoryOrder::Relaxed);
+    update_timer(true);
+    next->context_switch_to();
 }
 
 void Scheduler::save_state_and_run_next(arch::TaskState* task_state) {
     raw_disable_interrupts();
 
-    // Ensure that we never put the idle task into the run queue, or waiting tasks.
-    if (m_current_task != m_idle_task.get() && !m_current_task->waiting()) {
-        m_run_queue.push(*m_current_task);
-    }
-
     m_current_task->set_task_state(*task_state);
+    switch_away_from_current_task();
+}
 
+void Scheduler::save_kernel_context_and_run_next(uptr stack_pointer) {
+    raw_disable_interrupts();
+
+    m_current_task->set_kernel_context(stack_pointer);
+    switch_away_from_current_task();
+}
+
+void Scheduler::switch_away_from_current_task() {
     // If this task has FPU state, save it.
     m_current_task->fpu_state().save();
 
-    run_next();
+    // Ensure that we never put the idle task into the run queue, or waiting tasks. The task state must be saved before
+    // this point, since other processors may take tasks from the run queue. Waiting tasks keep their virtual runtime
+    // relative to this scheduler, since they may be woken up on a different one.
+    if (m_current_task != m_idle_task.get()) {
+        account_current_task();
+        if (!m_current_task->waiting()) {
+            requeue_task(*m_current_task);
+        } else {
+            detach_task(*m_current_task);
+        }
+    }
+
+    run_next(m_current_task);
 }
 
 void Scheduler::exit_current_task() {
+    // The task is about to be destroyed, so make sure it is not referenced after switching away.
+    if (m_previous_task == m_current_task) {
+        m_previous_task = nullptr;
+    }
+
     // Unregister the task from its task namespace.
     m_current_task->task_namespace().lock()->unregister_task(*m_current_task);
 
@@ -139,7 +450,7 @@ void Scheduler::exit_current_task() {
 
     // NOTE: by not pushing the current task into the run queue, it will
     //       not get scheduled again.
-    run_next();
+    run_next(nullptr);
 }
 
 mm::AddressSpace& Scheduler::current_address_space() {
@@ -161,6 +472,57 @@ Expected<void> Scheduler::block_current_task(di::FunctionRef<void()> before_yiel
     return {};
 }
 
+// Scans every processor, but this is cheap since the load of each processor is read without taking any locks.
+static u32 least_loaded_processor_id(Processor& current_processor) {
+    auto result = current_processor.id();
+    auto min_load = current_processor.scheduler().load();
+    for (auto [id, processor] : global_state().processor_map) {
+        auto load = processor->scheduler().load();
+        if (load < min_load) {
+            result = id;
+            min_load = load;
+        }
+    }
+    return result;
+}
+
+#ifdef IRIS_UNIT_TESTS
+static u32 round_robin_processor_id() {
+    auto const& processor_map = global_state().processor_map;
+    auto index = next_round_robin_processor.fetch_add(1, di::MemoryOrder::Relaxed) % processor_map.size();
+    for (auto [id, _] : processor_map) {
+        if (index-- == 0) {
+            return id;
+        }
+    }
+    di::unreachable();
+}
+#endif
+
+static u32 select_processor_for(Task& task, Processor& current_processor) {
+    // A task which its last processor may still be switching away from can only run on that processor. This also
+    // covers tasks which are woken up before they have finished blocking.
+    auto last_processor_id = task.last_processor_id();
+    if (last_processor_id && task.on_processor()) {
+        return *last_processor_id;
+    }
+
+#ifdef IRIS_UNIT_TESTS
+    if (round_robin_placement.load(di::MemoryOrder::Relaxed)) {
+        return round_robin_processor_id();
+    }
+#endif
+    if (!last_processor_id) {
+        return least_loaded_processor_id(current_processor);
+    }
+
+    auto last_processor = global_state().processor_map.at(*last_processor_id);
+    if (last_processor && (*last_processor)->scheduler().load() <= current_processor.scheduler().load()) {
+        return *last_processor_id;
+    }
+    return current_processor.id();
+}
+
 void schedule_task(Task& task) {
     auto local_schedule = [&] {
         with_interrupts_disabled([&] {
@@ -177,16 +539,34 @@ void schedule_task(Task& task) {
     }
 
     auto current_processor = iris::current_processor();
-    auto next_processor_id = global_state.next_processor_to_schedule_on.fetch_add(1, di::MemoryOrder::Relaxed);
-    next_processor_id %= global_state.alernate_processors.size() + 1;
-
+    auto next_processor_id = select_processor_for(task, *current_processor);
     if (current_processor->id() == next_processor_id) {
         local_schedule();
         return;
     }
 
-    current_processor->send_ipi(next_processor_id, [&](IpiMessage& message) {
-        message.task_to_schedule = &task;
+    current_processor->send_task_to_schedule(next_processor_id, task);
+}
+
+Expected<void> sleep_until(di::Nanoseconds deadline) {
+    auto disabler = InterruptDisabler {};
+    if (monotonic_time() >= deadline) {
+        return {};
+    }
+
+    // The timer can only fire once this processor has switched away from the task, since it runs on this processor.
+    // SAFETY: This is safe since interrupts are disabled.
+    auto& scheduler = current_processor_unsafe().scheduler();
+    auto& task = scheduler.current_task();
+    auto timer = KernelTimer([&task] {
+        schedule_task(task);
+    });
+    return scheduler.block_current_task([&] {
+        scheduler.add_timer(timer, deadline);
     });
 }
+
+Expected<void> sleep_for(di::Nanoseconds duration) {
+    return sleep_until(deadline_after(duration));
+}
 }
@@ -106,26 +106,31 @@ Expected<void> load_executable(Task& task, di::PathView path) {
     auto* elf_header = raw_data.typed_pointer_unchecked<ElfHeader>(0);
     ASSERT_EQ(sizeof(ProgramHeader), elf_header->program_entry_size);
 
-    auto address_space = task.address_space().lock();
-    TRY(with_preemption_disabled([&] -> Expected<void> {
+    // NOTE: the address space must not be locked while writing to it, since the writes will fault in the pages.
+    // Resolving those faults can sleep, so preemption must stay enabled while writing. Instead, the current task
+    // temporarily uses the new address space, which makes context switches reload it and page faults resolve in it.
+    auto& address_space = task.address_space();
+    auto* current_task = with_preemption_disabled([&] {
         // SAFETY: Preemption is disabled.
-        auto& current_scheduler = current_processor_unsafe().scheduler();
-        auto* current_task = current_scheduler.current_task_null_if_during_boot();
-        auto current_address_space = current_task ? current_task->address_space().arc_from_this()
-                                                  : global_state_in_boot().kernel_address_space.arc_from_this();
-
-        if (current_task) {
-            current_task->set_address_space(task.address_space().arc_from_this());
-        }
+        return current_processor_unsafe().scheduler().current_task_null_if_during_boot();
+    });
+    auto current_address_space = current_task ? current_task->address_space().arc_from_this()
+                                              : global_state_in_boot().kernel_address_space.arc_from_this();
 
-        auto guard = di::ScopeExit([&] {
+    auto switch_address_space = [&](mm::AddressSpace& target) {
+        with_preemption_disabled([&] {
             if (current_task) {
-                current_task->set_address_space(current_address_space);
+                current_task->set_address_space(target.arc_from_this());
             }
-            current_address_space->load();
+            target.load();
         });
+    };
 
-        address_space->base().load();
+    switch_address_space(address_space);
+    TRY(([&] -> Expected<void> {
+        auto guard = di::ScopeExit([&] {
+            switch_address_space(*current_address_space);
+        });
 
         auto program_headers = raw_data.typed_span_unchecked<ProgramHeader>(elf_header->program_table_off,
                                                                             elf_header->program_entry_count);
@@ -143,7 +148,7 @@ Expected<void> load_executable(Task& task, di::PathView path) {
             auto region = di::make_box<mm::Region>(mm::VirtualAddress(aligned_start), aligned_end - aligned_start,
                                                    mm::RegionFlags::User | mm::RegionFlags::Readable |
                                                        mm::RegionFlags::Executable | mm::RegionFlags::Writable);
-            (void) address_space->allocate_region_at(di::move(region_object), *di::move(region));
+            (void) address_space.lock()->allocate_region_at(di::move(region_object), *di::move(region));
 
             auto data = di::Span { reinterpret_cast<di::Byte*>(program_header.virtual_addr.value()),
                                    program_header.memory_size };
@@ -212,7 +217,7 @@ Expected<void> load_executable(Task& task, di::PathView path) {
         }
 
         return {};
-    }));
+    }()));
 
     task.set_instruction_pointer(mm::VirtualAddress(elf_header->entry));
     return {};
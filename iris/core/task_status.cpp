@@ -13,4 +13,10 @@ Expected<void> TaskStatus::wait_until_exited() {
         return m_exited;
     });
 }
+
+Expected<void> TaskStatus::wait_until_exited(di::Nanoseconds deadline) {
+    return m_wait_queue.wait_until(deadline, [&] {
+        return m_exited;
+    });
+}
 }
@@ -0,0 +1,167 @@
+#include <di/assert/prelude.h>
+#include <di/bit/operation/prelude.h>
+#include <di/container/algorithm/prelude.h>
+#include <di/container/view/prelude.h>
+#include <di/util/prelude.h>
+#include <iris/core/timer_wheel.h>
+
+namespace iris {
+// Deadlines are rounded up, so that timers never run early.
+static u64 deadline_to_tick(di::Nanoseconds deadline) {
+    auto nanoseconds = u64(di::max(deadline.count(), 0_i64));
+    auto resolution = u64(TimerWheel::resolution.count());
+    return (nanoseconds + resolution - 1) / resolution;
+}
+
+bool KernelTimer::cancel() {
+    auto* wheel = m_wheel.load(di::MemoryOrder::Acquire);
+    if (!wheel) {
+        return false;
+    }
+
+    auto removed = wheel->m_state.with_lock([&](TimerWheel::State& state) {
+        if (!m_queued) {
+            return false;
+        }
+        TimerWheel::remove(state, *this);
+        m_wheel.store(nullptr, di::MemoryOrder::Relaxed);
+        return true;
+    });
+    if (removed) {
+        return true;
+    }
+
+    // The timer has expired, and its callback is about to run on the processor which owns the wheel.
+    while (m_wheel.load(di::MemoryOrder::Acquire)) {
+        di::cpu_relax();
+    }
+    return false;
+}
+
+void TimerWheel::insert(State& state, KernelTimer& timer) {
+    auto tick = di::max(deadline_to_tick(timer.m_deadline), state.current_tick);
+    auto delta = tick - state.current_tick;
+
+    // Deadlines beyond the range of the wheel are placed in the furthest slot, and placed again once it is reached.
+    auto max_delta = (1_u64 << (bits_per_level * level_count)) - 1;
+    if (delta > max_delta) {
+        tick = state.current_tick + max_delta;
+        delta = max_delta;
+    }
+
+    auto level = 0zu;
+    while (delta >= (1_u64 << (bits_per_level * (level + 1)))) {
+        level++;
+    }
+
+    auto slot = usize(tick >> (bits_per_level * level)) % slots_per_level;
+    state.slots[level][slot].push_back(timer);
+    state.occupied[level] |= 1_u64 << slot;
+    state.pending_count++;
+
+    timer.m_slot = level * slots_per_level + slot;
+    timer.m_queued = true;
+}
+
+void TimerWheel::remove(State& state, KernelTimer& timer) {
+    auto level = timer.m_slot / slots_per_level;
+    auto slot = timer.m_slot % slots_per_level;
+    auto& list = state.slots[level][slot];
+    list.erase(decltype(list.begin())(timer));
+    if (list.empty()) {
+        state.occupied[level] &= ~(1_u64 << slot);
+    }
+    state.pending_count--;
+
+    timer.m_queued = false;
+}
+
+di::Optional<u64> TimerWheel::next_event_tick(State const& state) {
+    auto result = di::Optional<u64> {};
+    for (auto level : di::range(level_count)) {
+        auto occupied = state.occupied[level];
+        if (!occupied) {
+            continue;
+        }
+
+        // Slots of this level are processed at multiples of the slot size. Find the first of those at or after the
+        // current tick, and then the first non-empty slot starting from it.
+        auto shift = bits_per_level * level;
+        auto first = (state.current_tick + (1_u64 << shift) - 1) >> shift;
+        auto index = first + u64(di::countr_zero(di::rotr(occupied, int(first % slots_per_level))));
+        auto tick = index << shift;
+        result = di::min(result.value_or(tick), tick);
+    }
+    return result;
+}
+
+void TimerWheel::add(KernelTimer& timer, di::Nanoseconds deadline) {
+    m_state.with_lock([&](State& state) {
+        ASSERT(!timer.m_queued);
+        timer.m_deadline = deadline;
+        timer.m_wheel.store(this, di::MemoryOrder::Relaxed);
+        insert(state, timer);
+    });
+}
+
+void TimerWheel::expire(di::Nanoseconds now) {
+    auto now_tick = u64(di::max(now.count(), 0_i64)) / u64(resolution.count());
+
+    auto expired = di::IntrusiveList<KernelTimer> {};
+    m_state.with_lock([&](State& state) {
+        while (state.current_tick <= now_tick) {
+            // Skip over ticks where there is nothing to do.
+            auto tick = next_event_tick(state);
+            if (!tick || *tick > now_tick) {
+                state.current_tick = now_tick + 1;
+                break;
+            }
+            state.current_tick = *tick;
+
+            // Move timers from upper levels whose slot starts now to lower levels.
+            for (auto level = level_count - 1; level > 0; level--) {
+                auto shift = bits_per_level * level;
+                if (*tick & ((1_u64 << shift) - 1)) {
+                    continue;
+                }
+
+                auto slot = usize(*tick >> shift) % slots_per_level;
+                auto timers = di::IntrusiveList<KernelTimer> {};
+                timers.splice(timers.end(), state.slots[level][slot]);
+                state.occupied[level] &= ~(1_u64 << slot);
+                while (auto timer = timers.pop_front()) {
+                    state.pending_count--;
+                    insert(state, *timer);
+                }
+            }
+
+            auto slot = usize(*tick) % slots_per_level;
+            auto& list = state.slots[0][slot];
+            state.occupied[0] &= ~(1_u64 << slot);
+            while (auto timer = list.pop_front()) {
+                state.pending_count--;
+                timer->m_queued = false;
+                expired.push_back(*timer);
+            }
+            state.current_tick = *tick + 1;
+        }
+    });
+
+    // Callbacks run without the wheel locked, so that they can arm other timers.
+    while (auto timer = expired.pop_front()) {
+        auto& kernel_timer = *timer;
+        kernel_timer.m_callback();
+
+        // Once the timer is detached from the wheel, its owner is free to destroy it.
+        kernel_timer.m_wheel.store(nullptr, di::MemoryOrder::Release);
+    }
+}
+
+di::Optional<di::Nanoseconds> TimerWheel::next_event() const {
+    return m_state.with_lock([](State const& state) {
+        return next_event_tick(state) % [](u64 tick) {
+            return di::Nanoseconds(i64(tick)) * resolution.count();
+        };
+    });
+}
+}
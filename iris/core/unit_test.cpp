@@ -1,5 +1,7 @@
 #include <iris/core/global_state.h>
 #include <iris/core/print.h>
+#include <iris/core/scheduler.h>
+#include <iris/core/task.h>
 #include <iris/hw/power.h>
 
 namespace iris::test {
@@ -25,6 +27,28 @@ static void call_unit_test_case_init_functions() {
     }
 }
 
+di::Vector<di::Arc<Task>> create_kernel_tasks(usize count, void (*entry)()) {
+    auto tasks = di::Vector<di::Arc<Task>> {};
+    for (auto i = 0zu; i < count; i++) {
+        ASSERT(tasks.push_back(*create_kernel_task(global_state().task_namespace, entry)));
+    }
+    return tasks;
+}
+
+void run_tasks_to_completion(di::Span<di::Arc<Task> const> tasks) {
+    for (auto& task : tasks) {
+        schedule_task(*task);
+    }
+    for (auto& task : tasks) {
+        ASSERT(task->task_status()->wait_until_exited());
+    }
+}
+
+void run_kernel_tasks(usize count, void (*entry)()) {
+    auto tasks = create_kernel_tasks(count, entry);
+    run_tasks_to_completion(tasks.span());
+}
+
 void TestManager::run_tests() {
     call_unit_test_case_init_functions();
 
@@ -7,7 +7,8 @@ namespace iris {
 void WaitQueue::notify_one(di::FunctionRef<void()> action) {
     m_queue.with_lock([&](auto& queue) {
         action();
-        if (auto entry = queue.pop()) {
+        if (auto entry = queue.pop_front()) {
+            entry->queued = false;
             entry->notify();
         }
     });
@@ -16,13 +17,22 @@ void WaitQueue::notify_one(di::FunctionRef<void()> action) {
 void WaitQueue::notify_all(di::FunctionRef<void()> action) {
     m_queue.with_lock([&](auto& queue) {
         action();
-        while (auto entry = queue.pop()) {
+        while (auto entry = queue.pop_front()) {
+            entry->queued = false;
             entry->notify();
         }
     });
 }
 
 Expected<void> WaitQueue::wait(di::FunctionRef<bool()> predicate) {
+    return do_wait(di::nullopt, predicate);
+}
+
+Expected<void> WaitQueue::wait_until(di::Nanoseconds deadline, di::FunctionRef<bool()> predicate) {
+    return do_wait(deadline, predicate);
+}
+
+Expected<void> WaitQueue::do_wait(di::Optional<di::Nanoseconds> deadline, di::FunctionRef<bool()> predicate) {
     auto& lock = m_queue.get_lock();
     for (;;) {
         // Acquire the queue's lock.
@@ -37,15 +47,35 @@ Expected<void> WaitQueue::wait(di::FunctionRef<bool()> predicate) {
             lock.unlock();
             return {};
         }
+        if (deadline && monotonic_time() >= *deadline) {
+            lock.unlock();
+            return di::Unexpected(Error::TimedOut);
+        }
 
         // Setup a wait queue entry which will unblock this task.
         auto entry = WaitQueueEntry { [&] {
             schedule_task(current_task);
         } };
-        m_queue.get_assuming_no_concurrent_accesses().push(entry);
+        entry.queued = true;
+        m_queue.get_assuming_no_concurrent_accesses().push_back(entry);
+
+        // If the deadline passes first, the timer removes the entry and unblocks the task itself. It is declared after
+        // the entry, so that it is cancelled before the entry is destroyed.
+        auto timer = KernelTimer([this, &entry] {
+            m_queue.with_lock([&](auto& queue) {
+                if (entry.queued) {
+                    queue.erase(decltype(queue.begin())(entry));
+                    entry.queued = false;
+                    entry.notify();
+                }
+            });
+        });
 
         // Now, we must block the current task.
         TRY(scheduler.block_current_task([&] {
+            if (deadline) {
+                scheduler.add_timer(timer, *deadline);
+            }
             lock.unlock();
         }));
     }
@@ -0,0 +1,141 @@
+#include <di/container/hash/prelude.h>
+#include <di/util/prelude.h>
+#include <di/vocab/pointer/prelude.h>
+#include <iris/fs/dentry_cache.h>
+#include <iris/fs/tnode.h>
+
+namespace iris {
+static u64 hash_key(TNode const& parent, di::TransparentStringView name) {
+    auto hasher = di::DefaultHasher {};
+    di::hash_write(hasher, di::to_uintptr(&parent));
+    di::hash_write(hasher, name);
+    return hasher.finish() * 0x9E3779B97F4A7C15_u64;
+}
+
+static usize bucket_index(u64 hash) {
+    return usize(hash >> 32) % dentry_cache_bucket_count;
+}
+
+// Entries are destroyed without the cache locked, since dropping the last reference to a TNode frees it.
+static void destroy_entries(di::IntrusiveList<DentryCacheEntry, DentryCacheLruTag>& entries) {
+    while (auto entry = entries.pop_front()) {
+        (void) di::Box<DentryCacheEntry>(&*entry);
+    }
+}
+
+DentryCache::~DentryCache() {
+    auto entries = di::IntrusiveList<DentryCacheEntry, DentryCacheLruTag> {};
+    m_state.with_lock([&](State& state) {
+        while (auto entry = state.lru.front()) {
+            remove(state, *entry);
+            entries.push_back(*entry);
+        }
+    });
+    destroy_entries(entries);
+}
+
+DentryCacheEntry* DentryCache::find(State& state, u64 hash, TNode const& parent, di::TransparentStringView name) {
+    for (auto& entry : state.buckets[bucket_index(hash)]) {
+        if (entry.hash == hash && entry.parent.get() == &parent && entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void DentryCache::remove(State& state, DentryCacheEntry& entry) {
+    auto& bucket = state.buckets[bucket_index(entry.hash)];
+    bucket.erase(decltype(bucket.begin())(entry));
+    state.lru.erase(decltype(state.lru.begin())(entry));
+    state.size--;
+}
+
+di::Optional<di::Arc<TNode>> DentryCache::lookup(TNode const& parent, di::TransparentStringView name,
+                                                 u64 generation) {
+    auto hash = hash_key(parent, name);
+    auto result = m_state.with_lock([&](State& state) -> di::Optional<di::Arc<TNode>> {
+        auto* entry = find(state, hash, parent, name);
+        if (!entry || (!entry->node && entry->generation != generation)) {
+            return di::nullopt;
+        }
+
+        // Move the entry to the back of the LRU list.
+        state.lru.erase(decltype(state.lru.begin())(*entry));
+        state.lru.push_back(*entry);
+        return entry->node;
+    });
+
+    if (!result) {
+        m_statistics.misses.fetch_add(1, di::MemoryOrder::Relaxed);
+    } else if (!*result) {
+        m_statistics.negative_hits.fetch_add(1, di::MemoryOrder::Relaxed);
+    } else {
+        m_statistics.hits.fetch_add(1, di::MemoryOrder::Relaxed);
+    }
+    return result;
+}
+
+void DentryCache::insert(di::Arc<TNode> parent, di::TransparentStringView name, di::Arc<TNode> node) {
+    do_insert(di::move(parent), name, di::move(node), 0);
+}
+
+void DentryCache::insert_negative(di::Arc<TNode> parent, di::TransparentStringView name, u64 generation) {
+    do_insert(di::move(parent), name, nullptr, generation);
+}
+
+void DentryCache::do_insert(di::Arc<TNode> parent, di::TransparentStringView name, di::Arc<TNode> node,
+                            u64 generation) {
+    auto owned_name = name.to_owned();
+    if (!owned_name) {
+        return;
+    }
+    auto new_entry = di::make_box<DentryCacheEntry>();
+    if (!new_entry) {
+        return;
+    }
+
+    auto hash = hash_key(*parent, name);
+    (*new_entry)->parent = di::move(parent);
+    (*new_entry)->name = di::move(*owned_name);
+    (*new_entry)->node = di::move(node);
+    (*new_entry)->generation = generation;
+    (*new_entry)->hash = hash;
+
+    auto removed = di::IntrusiveList<DentryCacheEntry, DentryCacheLruTag> {};
+    m_state.with_lock([&](State& state) {
+        if (auto* existing = find(state, hash, *(*new_entry)->parent, name)) {
+            // A lookup which failed before a concurrent creation must not hide the created node.
+            if (existing->node && !(*new_entry)->node) {
+                return;
+            }
+            remove(state, *existing);
+            removed.push_back(*existing);
+        }
+
+        while (state.size >= m_capacity && !state.lru.empty()) {
+            auto& victim = *state.lru.front();
+            remove(state, victim);
+            removed.push_back(victim);
+            m_statistics.evictions.fetch_add(1, di::MemoryOrder::Relaxed);
+        }
+
+        auto& entry = *new_entry->release();
+        state.buckets[bucket_index(hash)].push_back(entry);
+        state.lru.push_back(entry);
+        state.size++;
+    });
+    destroy_entries(removed);
+}
+
+void DentryCache::invalidate(TNode const& parent, di::TransparentStringView name) {
+    auto hash = hash_key(parent, name);
+    auto removed = di::IntrusiveList<DentryCacheEntry, DentryCacheLruTag> {};
+    m_state.with_lock([&](State& state) {
+        if (auto* entry = find(state, hash, parent, name)) {
+            remove(state, *entry);
+            removed.push_back(*entry);
+        }
+    });
+    destroy_entries(removed);
+}
+}
@@ -55,7 +55,12 @@ struct InitrdInodeImpl {
         virtual_address -= global_state().virtual_to_physical_offset.raw_value();
         auto physical_address = mm::PhysicalAddress(virtual_address);
 
-        object.lock()->add_page(physical_address, page_number);
+        // Concurrent reads of the same page may race to add it.
+        auto locked = object.lock();
+        if (auto page = locked->lookup_page(page_number)) {
+            return *page;
+        }
+        TRY(locked->add_page(physical_address, page_number));
         return physical_address;
     }
 
@@ -7,10 +7,17 @@
 #include <iris/fs/inode.h>
 #include <iris/fs/tnode.h>
 #include <iris/mm/map_physical_address.h>
+#include <iris/mm/page_frame_allocator.h>
 #include <iris/mm/physical_address.h>
 #include <iris/uapi/metadata.h>
 
 namespace iris {
+// The most pages looked up in the page cache at once when reading or writing a file.
+constexpr auto file_io_batch_page_count = 16zu;
+
+// File offsets are signed in userspace, so no byte of a file can lie past the largest signed offset.
+constexpr auto max_file_offset = u64(di::NumericLimits<i64>::max);
+
 InodeFile::InodeFile(di::Arc<TNode> tnode) : m_tnode(di::move(tnode)) {}
 
 di::AnySenderOf<mm::PhysicalAddress> tag_invoke(di::Tag<inode_read>, Inode& self, mm::BackingObject& backing_object,
@@ -29,103 +36,205 @@ di::AnySenderOf<di::Arc<TNode>> tag_invoke(di::Tag<inode_lookup>, Inode& self, d
 }
 
 di::AnySenderOf<Metadata> tag_invoke(di::Tag<inode_metadata>, Inode& self) {
-    return inode_metadata(self.m_impl);
+    auto metadata = co_await inode_metadata(self.m_impl);
+
+    // Only fill in an unknown size, since a concurrent truncate may have already stored a newer one.
+    auto expected = Inode::unknown_size;
+    self.m_cached_size.compare_exchange_strong(expected, metadata.size, di::MemoryOrder::Release,
+                                               di::MemoryOrder::Relaxed);
+    co_return metadata;
 }
 
 di::AnySenderOf<di::Arc<TNode>> tag_invoke(di::Tag<inode_create_node>, Inode& self, di::Arc<TNode> parent,
                                            di::TransparentStringView name, MetadataType type) {
-    return inode_create_node(self.m_impl, di::move(parent), name, type);
+    auto node = co_await inode_create_node(self.m_impl, di::move(parent), name, type);
+    self.m_directory_generation.fetch_add(1, di::MemoryOrder::Release);
+    co_return node;
 }
 
 di::AnySenderOf<> tag_invoke(di::Tag<inode_truncate>, Inode& self, u64 size) {
-    return inode_truncate(self.m_impl, size);
+    co_await inode_truncate(self.m_impl, size);
+    self.m_cached_size.store(size, di::MemoryOrder::Release);
+    co_return {};
 }
 
 di::AnySenderOf<di::Span<byte const>> tag_invoke(di::Tag<inode_hack_raw_data>, Inode& self) {
     return inode_hack_raw_data(self.m_impl);
 }
 
-di::AnySenderOf<usize> tag_invoke(di::Tag<read_file>, InodeFile& self, UserspaceBuffer<byte> buffer) {
-    auto& inode = *self.m_tnode->inode();
-    auto metadata = co_await inode_metadata(inode);
-    auto size = metadata.size;
-    if (self.m_offset >= size) {
-        co_return 0;
+// Add a page which is completely overwritten by the first page of @p buffer, without reading in its old contents. The
+// page is filled in before it is published, so a failed copy never exposes a page which was neither read in from the
+// inode nor written. Returns false without copying anything if the page was added concurrently.
+static Expected<bool> add_page_for_overwrite(mm::BackingObject& backing_object, u64 page_number,
+                                             UserspaceBuffer<byte const> buffer) {
+    auto page = TRY(mm::allocate_page_frame());
+    auto guard = di::ScopeExit([&] {
+        mm::deallocate_page_frame(page);
+    });
+
+    {
+        auto mapping = TRY(mm::map_physical_address(page, 4096));
+        TRY(buffer.copy_to({ &mapping.typed<byte>(), 4096 }));
     }
 
-    auto to_read = di::min(size - self.m_offset, buffer.size());
-    auto page_begin = di::align_down(self.m_offset, 4096);
-    auto page_end = di::align_up(self.m_offset + to_read, 4096);
+    auto added = false;
+    TRY(backing_object.with_lock([&](mm::LockedBackingObject& object) -> Expected<void> {
+        if (object.lookup_page(page_number)) {
+            return {};
+        }
+        TRY(object.add_page(page, page_number));
+        added = true;
+        return {};
+    }));
+    if (added) {
+        guard.release();
+    }
+    return added;
+}
+
+// The length of the run of physically contiguous pages at the start of @p pages.
+static usize contiguous_page_count(di::Span<mm::PhysicalAddress const> pages) {
+    auto count = 1zu;
+    while (count < pages.size() && pages[count] == pages[0] + count * 4096) {
+        count++;
+    }
+    return count;
+}
 
+static di::AnySenderOf<usize> read_inode_at(Inode& inode, u64 offset, UserspaceBuffer<byte> buffer) {
+    if (offset > max_file_offset) {
+        co_return di::Unexpected(Error::InvalidArgument);
+    }
+
+    auto size = inode.cached_size();
+    if (!size) {
+        size = (co_await inode_metadata(inode)).size;
+    }
+    if (offset >= *size) {
+        co_return 0;
+    }
+
+    auto to_read = di::min(*size - offset, buffer.size());
     auto& backing_object = inode.backing_object();
+    auto pages = di::Array<mm::PhysicalAddress, file_io_batch_page_count> {};
     auto nread = 0_u64;
-    for (auto offset : di::range(page_begin, page_end) | di::stride(4096)) {
-        auto physical_address = backing_object.lock()->lookup_page(offset / 4096);
-        if (!physical_address) {
-            physical_address = co_await inode_read(inode, backing_object, offset / 4096);
-        }
-        ASSERT(physical_address);
+    while (nread < to_read) {
+        auto page_number = offset / 4096;
+        auto page_count = di::min(di::align_up(offset + to_read - nread, 4096) / 4096 - page_number,
+                                  file_io_batch_page_count);
 
-        auto page_offset = offset % 4096;
-        auto to_read = di::min(4096 - page_offset, buffer.size() - nread);
+        // Look up as many of the pages as possible at once, and only read in a missing page when there is none.
+        auto found = backing_object.lookup_pages_without_locking(page_number, { pages.data(), page_count });
+        if (found == 0) {
+            pages[0] = co_await inode_read(inode, backing_object, page_number);
+            found = 1;
+        }
 
-        auto page = co_await mm::map_physical_address(*physical_address, 4096);
-        auto page_data = di::Span { &page.typed<byte const>() + page_offset, to_read };
+        for (auto i = 0zu; i < found && nread < to_read;) {
+            auto run = contiguous_page_count({ pages.data() + i, found - i });
+            auto page_offset = offset % 4096;
+            auto amount = di::min(run * 4096 - page_offset, to_read - nread);
 
-        co_await buffer.write(*page_data.subspan(page_offset, to_read));
-        buffer.advance(to_read);
+            auto mapping = co_await mm::map_physical_address(pages[i], run * 4096);
+            co_await buffer.write({ &mapping.typed<byte const>() + page_offset, amount });
+            buffer.advance(amount);
 
-        nread += to_read;
-        self.m_offset += to_read;
+            nread += amount;
+            offset += amount;
+            i += run;
+        }
     }
     co_return nread;
 }
 
+di::AnySenderOf<usize> tag_invoke(di::Tag<read_file>, InodeFile& self, UserspaceBuffer<byte> buffer) {
+    auto nread = co_await read_inode_at(*self.m_tnode->inode(), self.m_offset, buffer);
+    self.m_offset += nread;
+    co_return nread;
+}
+
+di::AnySenderOf<usize> tag_invoke(di::Tag<read_file_at>, InodeFile& self, UserspaceBuffer<byte> buffer, u64 offset) {
+    return read_inode_at(*self.m_tnode->inode(), offset, buffer);
+}
+
 di::AnySenderOf<usize> tag_invoke(di::Tag<read_directory>, InodeFile& self, UserspaceBuffer<byte> buffer) {
     auto& inode = *self.m_tnode->inode();
     return inode_read_directory(inode, inode.backing_object(), self.m_offset, buffer);
 }
 
-di::AnySenderOf<usize> tag_invoke(di::Tag<write_file>, InodeFile& self, UserspaceBuffer<byte const> buffer) {
-    auto& inode = *self.m_tnode->inode();
-    auto metadata = co_await inode_metadata(inode);
-    auto size = metadata.size;
+static di::AnySenderOf<usize> write_inode_at(Inode& inode, u64 offset, UserspaceBuffer<byte const> buffer) {
+    // Checking the end of the write up front also ensures the offset cannot wrap around part of the way through.
+    auto to_write = buffer.size();
+    if (offset > max_file_offset) {
+        co_return di::Unexpected(Error::InvalidArgument);
+    }
+    if (to_write > max_file_offset - offset) {
+        co_return di::Unexpected(Error::FileTooLarge);
+    }
 
-    auto page_begin = di::align_down(self.m_offset, 4096);
-    auto page_end = di::align_up(self.m_offset + buffer.size(), 4096);
+    auto size = inode.cached_size();
+    if (!size) {
+        size = (co_await inode_metadata(inode)).size;
+    }
 
     auto& backing_object = inode.backing_object();
+    auto pages = di::Array<mm::PhysicalAddress, file_io_batch_page_count> {};
     auto nwritten = 0_u64;
-    for (auto offset : di::range(page_begin, page_end) | di::stride(4096)) {
-        // FIXME: this implementation is suboptimal in the case where we are writing an entire page, since it
-        // unconditionaly reads the page from disk. This can be skipped, but requires a more complex VFS interface.
-        // Also, the code assumes that we can read past the end of the inode. Although we make sure to update the size
-        // at the end of this function, this is probably sketchy for real file systems.
-        auto physical_address = backing_object.lock()->lookup_page(offset / 4096);
-        if (!physical_address) {
-            physical_address = co_await inode_read(inode, backing_object, offset / 4096);
-        }
-        ASSERT(physical_address);
-
+    while (nwritten < to_write) {
+        auto page_number = offset / 4096;
         auto page_offset = offset % 4096;
-        auto to_write = di::min(4096 - page_offset, buffer.size() - nwritten);
+        auto page_count = di::min(di::align_up(offset + to_write - nwritten, 4096) / 4096 - page_number,
+                                  file_io_batch_page_count);
+
+        auto found = backing_object.lookup_pages_without_locking(page_number, { pages.data(), page_count });
+        if (found == 0 && page_offset == 0 && to_write - nwritten >= 4096) {
+            // If the page was added concurrently, just look it up again and write to it like any other page.
+            if (co_await add_page_for_overwrite(backing_object, page_number, buffer)) {
+                buffer.advance(4096);
+                nwritten += 4096;
+                offset += 4096;
+            }
+            continue;
+        }
+        if (found == 0) {
+            // FIXME: the code assumes that we can read past the end of the inode. Although we make sure to update the
+            // size at the end of this function, this is probably sketchy for real file systems.
+            pages[0] = co_await inode_read(inode, backing_object, page_number);
+            found = 1;
+        }
 
-        auto page = co_await mm::map_physical_address(*physical_address, 4096);
-        auto page_data = di::Span { &page.typed<byte>() + page_offset, to_write };
+        for (auto i = 0zu; i < found && nwritten < to_write;) {
+            auto run = contiguous_page_count({ pages.data() + i, found - i });
+            page_offset = offset % 4096;
+            auto amount = di::min(run * 4096 - page_offset, to_write - nwritten);
 
-        co_await buffer.copy_to(*page_data.subspan(page_offset, to_write));
-        buffer.advance(to_write);
+            auto mapping = co_await mm::map_physical_address(pages[i], run * 4096);
+            co_await buffer.copy_to({ &mapping.typed<byte>() + page_offset, amount });
+            buffer.advance(amount);
 
-        nwritten += to_write;
-        self.m_offset += to_write;
+            nwritten += amount;
+            offset += amount;
+            i += run;
+        }
     }
 
-    if (self.m_offset > size) {
-        co_await inode_truncate(inode, self.m_offset);
+    if (offset > *size) {
+        co_await inode_truncate(inode, offset);
     }
     co_return nwritten;
 }
 
+di::AnySenderOf<usize> tag_invoke(di::Tag<write_file>, InodeFile& self, UserspaceBuffer<byte const> buffer) {
+    auto nwritten = co_await write_inode_at(*self.m_tnode->inode(), self.m_offset, buffer);
+    self.m_offset += nwritten;
+    co_return nwritten;
+}
+
+di::AnySenderOf<usize> tag_invoke(di::Tag<write_file_at>, InodeFile& self, UserspaceBuffer<byte const> buffer,
+                                  u64 offset) {
+    return write_inode_at(*self.m_tnode->inode(), offset, buffer);
+}
+
 di::AnySenderOf<Metadata> tag_invoke(di::Tag<file_metadata>, InodeFile& self) {
     auto& inode = *self.m_tnode->inode();
     return inode_metadata(inode);
@@ -158,4 +267,9 @@ di::AnySenderOf<di::Span<byte const>> tag_invoke(di::Tag<file_hack_raw_data>, In
     auto& inode = *self.m_tnode->inode();
     return inode_hack_raw_data(inode);
 }
+
+di::AnySenderOf<di::Arc<mm::BackingObject>> tag_invoke(di::Tag<file_backing_object>, InodeFile& self) {
+    auto& inode = *self.m_tnode->inode();
+    return inode.backing_object().arc_from_this();
+}
 }
@@ -9,6 +9,56 @@
 #include <iris/uapi/metadata.h>
 
 namespace iris {
+// Mount crossings are cached under the empty name, which never appears as a path component.
+constexpr auto mount_root_name = ""_tsv;
+
+static di::AnySenderOf<di::Arc<TNode>> lookup_uncached(di::Arc<TNode> parent, di::TransparentStringView name) {
+    // The generation is read before asking the file system, so that a name created concurrently makes a negative
+    // result stale.
+    auto generation = parent->inode()->directory_generation();
+    auto result = co_await di::execution::into_result(inode_lookup(*parent->inode(), parent, name));
+    if (result) {
+        global_state().dentry_cache.insert(di::move(parent), name, *result);
+    } else if (result == di::Unexpected(Error::NoSuchFileOrDirectory)) {
+        global_state().dentry_cache.insert_negative(di::move(parent), name, generation);
+    }
+    co_return co_await di::move(result);
+}
+
+// Look up a single path component, consulting the dentry cache before the file system.
+static di::AnySenderOf<di::Arc<TNode>> lookup_component(di::Arc<TNode> const& parent, di::TransparentStringView name) {
+    auto cached = global_state().dentry_cache.lookup(*parent, name, parent->inode()->directory_generation());
+    if (!cached) {
+        return lookup_uncached(parent, name);
+    }
+    if (!*cached) {
+        return di::Unexpected(Error::NoSuchFileOrDirectory);
+    }
+    return di::move(*cached);
+}
+
+static di::AnySenderOf<di::Arc<TNode>> create_component(di::Arc<TNode> parent, di::TransparentStringView name,
+                                                        MetadataType type) {
+    auto node = co_await inode_create_node(*parent->inode(), parent, name, type);
+
+    // This replaces the negative entry left by the failed lookup.
+    global_state().dentry_cache.insert(di::move(parent), name, node);
+    co_return node;
+}
+
+// The TNode for the root of a mounted file system is cached, so that lookups below it can hit the dentry cache.
+static Expected<di::Arc<TNode>> mount_root(di::Arc<TNode> mount_point, Mount& mount) {
+    auto& dentry_cache = global_state().dentry_cache;
+    if (auto cached = dentry_cache.lookup(*mount_point, mount_root_name, 0); cached && *cached) {
+        return di::move(*cached);
+    }
+
+    auto name = TRY(mount_point->name().to_owned());
+    auto root = TRY(di::make_arc<TNode>(mount_point, mount.super_block().root_inode(), di::move(name)));
+    dentry_cache.insert(di::move(mount_point), mount_root_name, root);
+    return root;
+}
+
 di::AnySenderOf<di::Arc<TNode>> lookup_path(di::Arc<TNode> root, di::Arc<TNode> relative_to, di::PathView path,
                                             PathLookupFlags flags) {
     auto parent = path.is_absolute() ? di::move(root) : di::move(relative_to);
@@ -33,26 +83,21 @@ di::AnySenderOf<di::Arc<TNode>> lookup_path(di::Arc<TNode> root, di::Arc<TNode>
             continue;
         }
 
-        auto inode = parent->inode();
-
-        auto result = co_await di::execution::into_result(inode_lookup(*inode, parent, component));
+        auto result = co_await di::execution::into_result(lookup_component(parent, component));
         if (result == di::Unexpected(Error::NoSuchFileOrDirectory) && !!(flags & PathLookupFlags::Create)) {
             // Now try to create the file, but only if this is the last component in the path.
             if (di::next(it) != path.end()) {
                 co_return di::Unexpected(Error::NoSuchFileOrDirectory);
             }
 
-            co_return co_await inode_create_node(*inode, parent, component, MetadataType::Regular);
+            co_return co_await create_component(di::move(parent), component, MetadataType::Regular);
         }
 
         parent = co_await di::move(result);
 
         // See if there is an existing mount.
-        inode = parent->inode();
-        if (auto mount = inode->mount(); mount) {
-            auto parent_inode = mount->super_block().root_inode();
-            parent =
-                co_await di::make_arc<TNode>(di::move(parent), di::move(parent_inode), co_await component.to_owned());
+        if (auto mount = parent->inode()->mount(); mount) {
+            parent = co_await mount_root(di::move(parent), *mount);
             continue;
         }
     }
@@ -69,12 +114,12 @@ di::AnySenderOf<void> create_node(di::Arc<TNode> root, di::Arc<TNode> relative_t
     auto parent = co_await lookup_path(di::move(root), di::move(relative_to), *parent_path);
     auto component = *path.back();
 
-    auto result = co_await di::execution::into_result(inode_lookup(*parent->inode(), parent, component));
+    auto result = co_await di::execution::into_result(lookup_component(parent, component));
     if (result.has_value()) {
         co_return di::Unexpected(Error::FileExists);
     }
 
-    co_await inode_create_node(*parent->inode(), parent, component, type);
+    co_await create_component(di::move(parent), component, type);
     co_return {};
 }
 
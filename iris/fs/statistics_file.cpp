@@ -0,0 +1,180 @@
+#include <di/container/string/prelude.h>
+#include <di/format/prelude.h>
+#include <iris/core/global_state.h>
+#include <iris/fs/statistics_file.h>
+#include <iris/mm/heap.h>
+#include <iris/mm/memory_statistics.h>
+#include <iris/mm/page_frame_allocator.h>
+
+namespace iris {
+static Expected<void> format_heap_statistics(di::String& output) {
+    auto statistics = mm::heap_statistics();
+
+    auto total_bytes = statistics.large_allocation_pages * 4096;
+    auto total_pages = statistics.large_allocation_pages;
+    for (auto const& size_class : statistics.size_classes) {
+        auto bytes = size_class.object_size * size_class.allocated_objects;
+        TRY(output.append(TRY_UNERASE_ERROR(di::present("heap.size_class.{}: objects={} bytes={} slab_pages={}\n"_sv,
+                                                        size_class.object_size, size_class.allocated_objects, bytes,
+                                                        size_class.slab_pages))));
+        total_bytes += bytes;
+        total_pages += size_class.slab_pages;
+    }
+    TRY(output.append(TRY_UNERASE_ERROR(di::present("heap.large: allocations={} pages={}\n"_sv,
+                                                    statistics.large_allocations,
+                                                    statistics.large_allocation_pages))));
+    TRY(output.append(
+        TRY_UNERASE_ERROR(di::present("heap.total: bytes={} pages={}\n"_sv, total_bytes, total_pages))));
+    return {};
+}
+
+static Expected<void> format_memory_statistics(di::String& output) {
+    auto statistics = mm::memory_statistics();
+
+    auto const& physical = statistics.physical;
+    TRY(output.append(TRY_UNERASE_ERROR(
+        di::present("memory.physical: total_pages={} used_pages={} free_pages={} cached_pages={} zeroed_pages={}\n"_sv,
+                    physical.total_pages, physical.used_pages(), physical.free_pages, physical.cached_pages,
+                    physical.zeroed_pages))));
+
+    auto const& kernel_address_space = global_state().kernel_address_space;
+    TRY(output.append(TRY_UNERASE_ERROR(di::present(
+        "memory.kernel: resident_pages={} structure_pages={} mapped_4kib_pages={} mapped_2mib_pages={} "
+        "mapped_1gib_pages={}\n"_sv,
+        kernel_address_space.resident_pages(), kernel_address_space.structure_pages(),
+        kernel_address_space.mapped_4kib_pages(), kernel_address_space.mapped_2mib_pages(),
+        kernel_address_space.mapped_1gib_pages()))));
+
+    TRY(output.append(TRY_UNERASE_ERROR(di::present(
+        "memory.events: page_faults={} large_page_faults={} copy_on_write_faults={} copy_on_write_reuses={} "
+        "zeroed_page_pool_hits={} zeroed_page_pool_misses={}\n"_sv,
+        statistics.event_count(mm::MemoryEvent::PageFault), statistics.event_count(mm::MemoryEvent::LargePageFault),
+        statistics.event_count(mm::MemoryEvent::CopyOnWriteFault),
+        statistics.event_count(mm::MemoryEvent::CopyOnWriteReuse),
+        statistics.event_count(mm::MemoryEvent::ZeroedPagePoolHit),
+        statistics.event_count(mm::MemoryEvent::ZeroedPagePoolMiss)))));
+    return {};
+}
+
+struct TaskMemoryStatistics {
+    TaskId id;
+    u64 address_space_id { 0 };
+    u64 resident_pages { 0 };
+    u64 structure_pages { 0 };
+    u64 page_faults { 0 };
+};
+
+static Expected<void> format_task_statistics(di::String& output) {
+    // Take a snapshot while holding the task namespace lock, but format the output afterwards.
+    auto tasks = di::Vector<TaskMemoryStatistics> {};
+    TRY(global_state().task_namespace.with_lock([&](LockedTaskNamespace& task_namespace) -> Expected<void> {
+        for (auto const& [id, task] : task_namespace.tasks()) {
+            auto& address_space = task->address_space();
+            TRY(tasks.push_back({
+                .id = id,
+                .address_space_id = address_space.id(),
+                .resident_pages = address_space.resident_pages(),
+                .structure_pages = address_space.structure_pages(),
+                .page_faults = address_space.page_faults(),
+            }));
+        }
+        return {};
+    }));
+
+    for (auto const& task : tasks) {
+        TRY(output.append(TRY_UNERASE_ERROR(
+            di::present("task.{}: address_space={} resident_pages={} structure_pages={} page_faults={}\n"_sv,
+                        task.id, task.address_space_id, task.resident_pages, task.structure_pages,
+                        task.page_faults))));
+    }
+    return {};
+}
+
+#ifdef IRIS_LOCK_STATISTICS
+static Expected<void> format_lock_statistics(di::String& output, di::StringView name,
+                                             LockStatistics const& statistics) {
+    TRY(output.append(TRY_UNERASE_ERROR(di::present(
+        "lock.{}: acquisitions={} contended={} spin_iterations={} total_hold_cycles={} max_hold_cycles={}\n"_sv, name,
+        statistics.acquisitions.load(di::MemoryOrder::Relaxed),
+        statistics.contended_acquisitions.load(di::MemoryOrder::Relaxed),
+        statistics.spin_iterations.load(di::MemoryOrder::Relaxed),
+        statistics.total_hold_cycles.load(di::MemoryOrder::Relaxed),
+        statistics.max_hold_cycles.load(di::MemoryOrder::Relaxed)))));
+    return {};
+}
+#endif
+
+static Expected<void> format_lock_statistics(di::String& output) {
+#ifdef IRIS_LOCK_STATISTICS
+    auto const& global_state = iris::global_state();
+    TRY(format_lock_statistics(output, "debug_output"_sv, global_state.debug_output_lock.statistics()));
+    TRY(format_lock_statistics(output, "irq_handlers"_sv, global_state.irq_handlers.get_lock().statistics()));
+    TRY(format_lock_statistics(output, "page_frame_allocator"_sv, mm::page_frame_allocator_lock_statistics()));
+#else
+    TRY(output.append("lock.statistics: disabled\n"_sv));
+#endif
+    return {};
+}
+
+Expected<di::String> format_statistics(StatisticsKind kind) {
+    auto result = di::String {};
+    switch (kind) {
+        case StatisticsKind::Heap:
+            TRY(format_heap_statistics(result));
+            return result;
+        case StatisticsKind::Memory:
+            TRY(format_memory_statistics(result));
+            return result;
+        case StatisticsKind::Tasks:
+            TRY(format_task_statistics(result));
+            return result;
+        case StatisticsKind::Locks:
+            TRY(format_lock_statistics(result));
+            return result;
+    }
+    return di::Unexpected(Error::InvalidArgument);
+}
+
+di::AnySenderOf<usize> tag_invoke(di::Tag<read_file>, StatisticsFile& self, UserspaceBuffer<byte> buffer) {
+    // The lock disables interrupts, so neither formatting the report nor writing to userspace (which can fault) may
+    // happen while holding it. The report is never modified once stored, so it can be read without the lock.
+    auto contents = [&] -> di::String const* {
+        auto guard = di::ScopedLock(self.m_lock);
+        return self.m_contents ? &*self.m_contents : nullptr;
+    }();
+    if (!contents) {
+        auto report = TRY(format_statistics(self.m_kind));
+
+        auto guard = di::ScopedLock(self.m_lock);
+        if (!self.m_contents) {
+            self.m_contents = di::move(report);
+        }
+        contents = &*self.m_contents;
+    }
+
+    // Claim the range to read before copying it out, so that concurrent reads never return the same data.
+    auto data = di::as_bytes(contents->span());
+    auto offset = 0zu;
+    auto amount = 0zu;
+    {
+        auto guard = di::ScopedLock(self.m_lock);
+        offset = di::min(self.m_offset, data.size());
+        amount = di::min(data.size() - offset, buffer.size());
+        self.m_offset = offset + amount;
+    }
+    if (amount == 0) {
+        return 0;
+    }
+
+    auto result = buffer.write(*data.subspan(offset, amount));
+    if (!result) {
+        // Nothing was read, so give the range back unless another read has claimed data after it.
+        auto guard = di::ScopedLock(self.m_lock);
+        if (self.m_offset == offset + amount) {
+            self.m_offset = offset;
+        }
+        return di::Unexpected(di::move(result).error());
+    }
+    return *result;
+}
+}
@@ -1,3 +1,4 @@
+#include <di/container/hash/node/prelude.h>
 #include <di/container/string/prelude.h>
 #include <di/container/tree/prelude.h>
 #include <di/execution/algorithm/sync_wait.h>
@@ -6,6 +7,7 @@
 #include <di/vocab/pointer/prelude.h>
 #include <iris/core/error.h>
 #include <iris/core/global_state.h>
+#include <iris/core/interruptible_spinlock.h>
 #include <iris/fs/inode.h>
 #include <iris/fs/path.h>
 #include <iris/fs/tmpfs.h>
@@ -17,65 +19,94 @@
 #include <iris/uapi/metadata.h>
 
 namespace iris {
+/// @brief The entries of a tmpfs directory.
+struct TmpfsDirectory {
+    /// Entries in the order they were created. Entries are never removed, so an entry's index is a stable offset for
+    /// read_directory(), even while other entries are being created.
+    di::Vector<di::Tuple<di::TransparentString, di::Arc<Inode>>> entries;
+
+    /// Maps the name of each entry to its index in entries.
+    di::NodeHashMap<di::TransparentString, usize> index;
+};
+
 struct TmpfsInodeImpl {
     Metadata metadata;
-    di::Vector<di::Tuple<di::TransparentString, di::Arc<Inode>>> inodes;
+
+    /// Only allocated for directories. Creating an entry allocates while holding the lock, so interrupts stay enabled.
+    di::Box<di::Synchronized<TmpfsDirectory, InterruptibleSpinlock>> directory;
+
+    static Expected<di::Arc<Inode>> create_inode(MetadataType type) {
+        auto directory = di::Box<di::Synchronized<TmpfsDirectory, InterruptibleSpinlock>> {};
+        if (type == MetadataType::Directory) {
+            directory = TRY(di::make_box<di::Synchronized<TmpfsDirectory, InterruptibleSpinlock>>());
+        }
+        return di::make_arc<Inode>(
+            TRY(InodeImpl::create(TmpfsInodeImpl(Metadata { .type = type, .size = 0 }, di::move(directory)))));
+    }
 
     friend di::AnySenderOf<mm::PhysicalAddress> tag_invoke(di::Tag<inode_read>, TmpfsInodeImpl&,
                                                            mm::BackingObject& backing_object, u64 page_number) {
         // NOTE: if we're getting here, it means that the page is not present in the backing object. Since this is the
         // tmpfs, just allocate a new (zero-filled) page and add it to the backing object.
-        auto page = TRY(mm::allocate_page_frame());
-        backing_object.lock()->add_page(page, page_number);
-        return page;
+        return TRY(backing_object.lock()->add_zeroed_page(page_number));
     }
 
     friend di::AnySenderOf<usize> tag_invoke(di::Tag<inode_read_directory>, TmpfsInodeImpl& self, mm::BackingObject&,
                                              u64& offset, UserspaceBuffer<byte> buffer) {
-        auto const* it = self.inodes.iterator(offset);
-        if (it == self.inodes.end()) {
-            co_return 0;
+        if (!self.directory) {
+            co_return di::Unexpected(Error::NotADirectory);
         }
 
-        auto const& entry = *it;
-
-        auto child_metadata = co_await inode_metadata(*di::get<1>(entry));
-        auto const& name = di::get<0>(entry);
-        auto name_length = name.size();
-
         auto storage = di::Array<byte, sizeof(DirectoryRecord) + 256> {};
-        auto effective_size = sizeof(DirectoryRecord) + di::align_up(name_length, 8);
         auto* dirent = reinterpret_cast<DirectoryRecord*>(storage.data());
+
+        // Copy the entry out, since the directory cannot stay locked while fetching the child's metadata.
+        auto child = self.directory->with_lock([&](TmpfsDirectory& directory) -> di::Arc<Inode> {
+            if (offset >= directory.entries.size()) {
+                return nullptr;
+            }
+
+            auto const& [name, inode] = directory.entries[offset];
+            dirent->name_length = name.size();
+            auto* name_buffer = const_cast<char*>(dirent->name().data());
+            di::copy(name, name_buffer);
+            return inode;
+        });
+        if (!child) {
+            co_return 0;
+        }
+
+        auto child_metadata = co_await inode_metadata(*child);
+
+        auto effective_size = sizeof(DirectoryRecord) + di::align_up(dirent->name_length, 8);
         dirent->inode = 0;
         dirent->offset = offset;
         dirent->type = MetadataType(child_metadata.type);
-        dirent->name_length = name_length;
         dirent->size = effective_size;
 
-        auto* name_buffer = const_cast<char*>(dirent->name().data());
-        di::copy(name, name_buffer);
-
         co_await buffer.write(di::Span { storage.data(), effective_size });
 
-        it++;
-        if (it == self.inodes.end()) {
-            offset = self.inodes.size();
-        } else {
-            offset = it - self.inodes.begin();
-        }
-
+        offset++;
         co_return effective_size;
     }
 
     friend di::AnySenderOf<di::Arc<TNode>> tag_invoke(di::Tag<inode_lookup>, TmpfsInodeImpl& self,
                                                       di::Arc<TNode> parent, di::TransparentStringView name) {
-        auto const* it = di::find_if(self.inodes, [&](auto const& entry) {
-            return di::get<0>(entry) == name;
+        if (!self.directory) {
+            return di::Unexpected(Error::NotADirectory);
+        }
+
+        auto inode = self.directory->with_lock([&](TmpfsDirectory& directory) -> di::Arc<Inode> {
+            auto index = directory.index.at(name);
+            if (!index) {
+                return nullptr;
+            }
+            return di::get<1>(directory.entries[*index]);
         });
-        if (it == self.inodes.end()) {
+        if (!inode) {
             return di::Unexpected(Error::NoSuchFileOrDirectory);
         }
-        return di::make_arc<TNode>(di::move(parent), di::get<1>(*it), TRY(name.to_owned()));
+        return di::make_arc<TNode>(di::move(parent), di::move(inode), TRY(name.to_owned()));
     }
 
     friend di::AnySenderOf<Metadata> tag_invoke(di::Tag<inode_metadata>, TmpfsInodeImpl& self) { return self.metadata; }
@@ -83,10 +114,26 @@ struct TmpfsInodeImpl {
     friend di::AnySenderOf<di::Arc<TNode>> tag_invoke(di::Tag<inode_create_node>, TmpfsInodeImpl& self,
                                                       di::Arc<TNode> const& parent, di::TransparentStringView name,
                                                       MetadataType type) {
-        auto& child = TRY(self.inodes.emplace_back(
-            TRY(name.to_owned()), TRY(di::make_arc<Inode>(TRY(
-                                      InodeImpl::create(TmpfsInodeImpl(Metadata { .type = type, .size = 0 }, {})))))));
-        return di::make_arc<TNode>(parent, di::get<1>(child), TRY(name.to_owned()));
+        if (!self.directory) {
+            return di::Unexpected(Error::NotADirectory);
+        }
+
+        auto child = TRY(create_inode(type));
+        auto entry_name = TRY(name.to_owned());
+        auto index_name = TRY(name.to_owned());
+        TRY(self.directory->with_lock([&](TmpfsDirectory& directory) -> Expected<void> {
+            if (directory.index.contains(name)) {
+                return di::Unexpected(Error::FileExists);
+            }
+
+            TRY(directory.entries.emplace_back(di::move(entry_name), child));
+            if (!directory.index.try_emplace(di::move(index_name), directory.entries.size() - 1)) {
+                directory.entries.pop_back();
+                return di::Unexpected(Error::NotEnoughMemory);
+            }
+            return {};
+        }));
+        return di::make_arc<TNode>(parent, di::move(child), TRY(name.to_owned()));
     }
 
     friend di::AnySenderOf<> tag_invoke(di::Tag<inode_truncate>, TmpfsInodeImpl& self, u64 size) {
@@ -108,8 +155,7 @@ Expected<void> init_tmpfs() {
     auto& global_state = global_state_in_boot();
     auto& initrd_root = global_state.initrd_root;
 
-    auto root_inode = TRY(di::make_arc<Inode>(
-        TRY(InodeImpl::create(TmpfsInodeImpl(Metadata { .type = MetadataType::Directory, .size = 0 }, {})))));
+    auto root_inode = TRY(TmpfsInodeImpl::create_inode(MetadataType::Directory));
     auto super_block = TRY(di::make_box<SuperBlock>(root_inode));
     auto mount = TRY(di::make_box<Mount>(di::move(super_block)));
 
@@ -34,6 +34,13 @@ Expected<void> register_exception_handler(GlobalIrqNumber irq, IrqHandler handle
     });
 }
 
+void register_unlocked_exception_handler(GlobalIrqNumber irq, IrqHandler handler) {
+    auto& handlers = global_state_in_boot().unlocked_exception_handlers;
+    ASSERT(irq.raw_value() < handlers.size());
+    ASSERT(!handlers[irq.raw_value()]);
+    handlers[irq.raw_value()] = di::move(handler);
+}
+
 void unregister_external_irq_handler(IrqLine line, usize handler_id) {
     auto irq = *irq_number_for_legacy_isa_interrupt_number(line);
 
@@ -84,6 +91,13 @@ extern "C" void generic_irq_handler(GlobalIrqNumber irq, iris::arch::TaskState&
         return;
     }
 
+    auto& unlocked_handlers = global_state().unlocked_exception_handlers;
+    if (irq.raw_value() < unlocked_handlers.size() && unlocked_handlers[irq.raw_value()]) {
+        auto status = unlocked_handlers[irq.raw_value()](context);
+        ASSERT(status == IrqStatus::Handled);
+        return;
+    }
+
     {
         auto handlers = global_state().irq_handlers.lock();
         for (auto& handler : (*handlers)[irq.raw_value()]) {
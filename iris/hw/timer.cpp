@@ -71,6 +71,10 @@ di::Synchronized<Timer>& scheduler_timer() {
     return *global_state().scheduler_timer;
 }
 
+Timer& scheduler_timer_unlocked() {
+    return global_state().scheduler_timer->get_assuming_no_concurrent_accesses();
+}
+
 di::Synchronized<Timer>& calibration_timer() {
     return *global_state().calibration_timer;
 }
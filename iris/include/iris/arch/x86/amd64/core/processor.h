@@ -2,6 +2,7 @@
 
 #include <iris/arch/x86/amd64/hw/local_apic.h>
 #include <iris/arch/x86/amd64/segment_descriptor.h>
+#include <iris/arch/x86/amd64/system_instructions.h>
 #include <iris/arch/x86/amd64/tss.h>
 #include <iris/hw/irq.h>
 
@@ -9,6 +10,32 @@ namespace iris {
 class Processor;
 
 namespace arch {
+    struct FpuState;
+
+    /// @brief The number of PCIDs each processor hands out to user address spaces.
+    ///
+    /// PCID 0 is reserved for the kernel address space.
+    constexpr inline auto pcid_slot_count = 8zu;
+
+    /// @brief Per-processor state used by the system call entry point.
+    ///
+    /// The `syscall` instruction does not switch stacks, so the entry point must find the kernel stack through the GS
+    /// segment before it can save any registers. Processor inherits from this right after its self pointer, which
+    /// places these members at a fixed offset from the GS base.
+    struct ProcessorEntryState {
+        /// The top of the current task's kernel stack.
+        uptr kernel_stack { 0 };
+        /// The userspace stack pointer, saved while switching to the kernel stack.
+        uptr user_stack { 0 };
+    };
+
+    constexpr inline auto processor_entry_state_offset = sizeof(void*);
+
+    struct PcidAssignment {
+        u16 pcid { 0 };
+        bool stale { true };
+    };
+
     class ArchProcessor {
     public:
         /// @brief Get the local APIC.
@@ -39,13 +66,51 @@ namespace arch {
         }
         void local_apic_callback(IrqContext& context) { m_local_apic_callback(context); }
 
+        /// @brief Find or assign the PCID used to load the address space with @p address_space_id.
+        ///
+        /// Each PCID remembers the TLB generation its address space had when it was last loaded. If the address space
+        /// was modified since then, or the PCID was previously used by a different address space, the translations
+        /// cached under the PCID are stale and must be flushed when loading it.
+        PcidAssignment assign_pcid(u64 address_space_id, u64 tlb_generation);
+
+        /// @brief The FPU state which was last loaded into this processor's registers.
+        ///
+        /// While the owning task is not running, the registers match its saved state, so loading it again can be
+        /// skipped.
+        FpuState const* fpu_owner() const { return m_fpu_owner.load(di::MemoryOrder::Relaxed); }
+        void set_fpu_owner(FpuState const* fpu_state) { m_fpu_owner.store(fpu_state, di::MemoryOrder::Relaxed); }
+
+        /// @brief Forget about @p fpu_state if it is the owner of this processor's FPU registers.
+        ///
+        /// This is called when the state is destroyed, which may happen on any processor, so that a new state allocated
+        /// at the same address is never mistaken for it.
+        void forget_fpu_owner(FpuState const& fpu_state) {
+            auto* expected = &fpu_state;
+            m_fpu_owner.compare_exchange_strong(expected, nullptr, di::MemoryOrder::Relaxed);
+        }
+
     private:
+        struct PcidSlot {
+            u64 address_space_id { 0 };
+            u64 tlb_generation { 0 };
+        };
+
         di::Optional<x86::amd64::LocalApic> m_local_apic;
         di::Array<iris::x86::amd64::sd::SegmentDescriptor, 11> m_gdt {};
         iris::x86::amd64::TSS m_tss {};
         uptr m_fallback_kernel_stack {};
         di::Function<void(IrqContext&)> m_local_apic_callback;
+        di::Array<PcidSlot, pcid_slot_count> m_pcid_slots {};
+        usize m_next_pcid_slot { 0 };
+        di::Atomic<FpuState const*> m_fpu_owner { nullptr };
     };
+
+    /// @brief Read a counter which increases at a constant rate, used to measure how long tasks run for.
+    ///
+    /// The unit of the counter is unspecified, so only differences between readings should be compared.
+    inline u64 read_cycle_counter() {
+        return x86::amd64::rdtsc();
+    }
 }
 
 /// @brief Get the current processor.
@@ -6,6 +6,8 @@
 #include <iris/uapi/syscall.h>
 
 namespace iris::arch {
+class ArchProcessor;
+
 // This is x86_64 specific.
 struct TaskState {
     explicit TaskState(bool userspace);
@@ -80,10 +82,17 @@ struct FpuState {
 
     /// Load this task's FPU state into the registers. This only makes sense to call when IRQs are disabled, right
     /// before performing a context switch.
+    ///
+    /// The registers are left alone if they still hold this state, which is the case when this was the last FPU state
+    /// loaded on the current processor, and it has not been loaded on any other processor since. Kernel tasks have no
+    /// FPU state, so switching to the idle task and back does not reload the FPU.
     void load();
 
     /// Save the current processor's FPU state into this task. This only makes sense to call when IRQs are disabled,
     /// when the task has just been interrupted.
+    ///
+    /// When supported, `xsaveopt` is used, which does not write state components the task did not modify since they
+    /// were loaded.
     void save();
 
     /// This is the task's FPU state. It is null for kernel-space tasks. Since it is dynamically sized, it must be
@@ -92,8 +101,17 @@ struct FpuState {
 
 private:
     Expected<byte*> allocate_fpu_state();
+
+    /// The processor which most recently loaded this state into its registers.
+    ArchProcessor* m_loaded_on { nullptr };
 };
 
+/// @brief Resume a kernel context saved by `Scheduler::yield()`.
+///
+/// The context consists of the flags and the callee-saved registers, stored on the task's stack below the return
+/// address of the call to `Scheduler::yield()`.
+[[noreturn]] void switch_to_kernel_context(uptr stack_pointer);
+
 void load_kernel_stack(mm::VirtualAddress base);
 void load_userspace_thread_pointer(uptr userspace_thread_pointer, TaskState& task_state);
 }
@@ -89,13 +89,22 @@ enum class ApicMessageType : u8 {
     External = 0b111,
 };
 
+/// @brief Local APIC Timer Mode
+///
+/// See Intel SDM; Volume 3A; Section 10.5.4.1. TSC-deadline mode is only valid when CPUID reports support for it.
+enum class ApicTimerMode : u8 {
+    OneShot = 0b00,
+    Periodic = 0b01,
+    TscDeadline = 0b10,
+};
+
 struct ApicLvtEntryVector : di::BitField<0, 8> {};
 struct ApicLvtEntryMessageType : di::BitEnum<ApicMessageType, 8, 3> {};
 struct ApicLvtEntryDeliveryStatus : di::BitFlag<12> {};
 struct ApicLvtEntryRemoteIrr : di::BitFlag<14> {};
 struct ApicLvtEntryTriggerMode : di::BitFlag<15> {};
 struct ApicLvtEntryMask : di::BitFlag<16> {};
-struct ApicLvtEntryTimerMode : di::BitFlag<17> {};
+struct ApicLvtEntryTimerMode : di::BitEnum<ApicTimerMode, 17, 2> {};
 
 /// @brief Local APIC LVT Entry
 ///
@@ -27,6 +27,11 @@ enum class ProcessorFeatures {
     Apic = (1 << 15),
     X2Apic = (1 << 16),
     GibPages = (1 << 17),
+    Pcid = (1 << 18),
+    Invpcid = (1 << 19),
+    Erms = (1 << 20),
+    TscDeadline = (1 << 21),
+    XsaveOpt = (1 << 22),
 };
 
 DI_DEFINE_ENUM_BITWISE_OPERATIONS(ProcessorFeatures)
@@ -42,10 +47,27 @@ struct ProcessorInfo {
     void print_to_console();
 
     bool has_xsave() const { return (fpu_valid_xcr0 & 0b11) == 0b11 && !!(features & ProcessorFeatures::Xsave); }
+    /// @brief Whether `xsaveopt` can be used to skip saving state components which were not modified since they were
+    /// last restored.
+    bool has_xsaveopt() const { return has_xsave() && !!(features & ProcessorFeatures::XsaveOpt); }
     bool has_fs_gs_base() const { return !!(features & ProcessorFeatures::FsGsBase); }
 
     bool has_apic() const { return !!(features & ProcessorFeatures::Apic); }
     bool has_gib_pages() const { return !!(features & ProcessorFeatures::GibPages); }
+
+    /// @brief Whether `rep movsb` and `rep stosb` are fast enough to be preferred over other string operations.
+    bool has_erms() const { return !!(features & ProcessorFeatures::Erms); }
+
+    /// @brief Whether the local APIC timer can fire at an absolute time stamp counter value.
+    bool has_tsc_deadline() const { return !!(features & ProcessorFeatures::TscDeadline); }
+
+    /// @brief Whether process-context identifiers can be used to tag TLB entries.
+    ///
+    /// PCIDs are only used when `invpcid` is also supported, since it is needed to invalidate kernel mappings in every
+    /// context at once.
+    bool has_pcid() const {
+        return !!(features & ProcessorFeatures::Pcid) && !!(features & ProcessorFeatures::Invpcid);
+    }
 };
 
 ProcessorInfo detect_processor_info();
@@ -5,6 +5,8 @@
 namespace iris::x86::amd64 {
 enum class ModelSpecificRegister : u32 {
     LocalApicBase = 0x1BU,
+    TscDeadline = 0x6E0U,
+    Efer = 0xC0000080U,
     Star = 0xC0000081U,
     LStar = 0xC0000082U,
     CStar = 0xC0000083U,
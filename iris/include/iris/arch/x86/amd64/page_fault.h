@@ -0,0 +1,9 @@
+#pragma once
+
+namespace iris::x86::amd64 {
+/// @brief Install the page fault handler.
+///
+/// Page faults resolve lazily populated userspace memory, and handle faults caused by invalid userspace accesses made
+/// by the kernel. Any other fault is fatal.
+void init_page_fault_handler();
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+namespace iris::x86::amd64 {
+/// @brief Enable the `syscall` instruction on the current processor.
+///
+/// @note This must be called once at boot for each logical processor, after loading its GDT.
+void init_system_calls();
+}
@@ -70,6 +70,32 @@ static inline void invlpg(mm::VirtualAddress address) {
     asm volatile("invlpg (%0)" : : "r"(address.raw_value()) : "memory");
 }
 
+enum class InvpcidType : u64 {
+    IndividualAddress = 0,
+    SingleContext = 1,
+    AllContextsIncludingGlobal = 2,
+    AllContexts = 3,
+};
+
+/// @brief Invalidate TLB entries tagged with process-context identifiers.
+///
+/// @warning This requires the processor to support the `invpcid` instruction.
+static inline void invpcid(InvpcidType type, u16 pcid = 0, mm::VirtualAddress address = mm::VirtualAddress(0)) {
+    struct [[gnu::packed]] {
+        u64 pcid;
+        u64 address;
+    } descriptor = { pcid, address.raw_value() };
+    asm volatile("invpcid %0, %1" : : "m"(descriptor), "r"(di::to_underlying(type)) : "memory");
+}
+
+/// @brief Read the time stamp counter.
+static inline u64 rdtsc() {
+    u32 low;
+    u32 high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return (u64(high) << 32) | low;
+}
+
 /// @brief Initalize the floating point state.
 static inline void fninit() {
     asm volatile("fninit");
@@ -91,20 +117,33 @@ static inline void fxrstor(byte* state) {
     asm volatile("fxrstor64 %0" : : "m"(*state));
 }
 
-/// @brief Load extended floating point state.
+/// @brief Save extended floating point state.
+///
+/// Every state component enabled in xcr0 is saved.
 ///
 /// @warning This requires that the CPU support has been detecetd, and that the provided state is 64 byte-aligned.
 static inline void xsave(byte* state) {
     ASSERT(reinterpret_cast<uptr>(state) % 64 == 0);
-    asm volatile("xsave %0" ::"m"(*state));
+    asm volatile("xsave %0" ::"m"(*state), "a"(u32(0xFFFF'FFFF)), "d"(u32(0xFFFF'FFFF)));
 }
 
-/// @brief Save extended floating point state.
+/// @brief Save extended floating point state, skipping unmodified state components.
+///
+/// State components which are in their initial configuration, or which were not modified since the last `xrstor` from
+/// the same address, are not written. The caller must ensure the memory at @p state was not changed since then.
+///
+/// @warning This requires that the CPU support has been detecetd, and that the provided state is 64 byte-aligned.
+static inline void xsaveopt(byte* state) {
+    ASSERT(reinterpret_cast<uptr>(state) % 64 == 0);
+    asm volatile("xsaveopt %0" ::"m"(*state), "a"(u32(0xFFFF'FFFF)), "d"(u32(0xFFFF'FFFF)));
+}
+
+/// @brief Load extended floating point state.
 ///
 /// @warning This requires that the CPU support has been detecetd, and that the provided state is 64 byte-aligned.
 static inline void xrstor(byte* state) {
     ASSERT(reinterpret_cast<uptr>(state) % 64 == 0);
-    asm volatile("xrstor %0" : : "m"(*state));
+    asm volatile("xrstor %0" : : "m"(*state), "a"(u32(0xFFFF'FFFF)), "d"(u32(0xFFFF'FFFF)));
 }
 
 /// @brief Set extended control register.
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <di/chrono/duration/prelude.h>
+
+namespace iris {
+/// @brief The time elapsed since boot, which never goes backwards.
+///
+/// This is measured by the cycle counter once its frequency has been calibrated against a reference timer, and is
+/// otherwise derived from the number of periodic scheduler ticks on the boot processor.
+di::Nanoseconds monotonic_time();
+
+/// @brief The monotonic time once @p duration has elapsed, saturating instead of overflowing for long durations.
+di::Nanoseconds deadline_after(di::Nanoseconds duration);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <di/chrono/duration/prelude.h>
+#include <di/container/intrusive/prelude.h>
+#include <di/sync/prelude.h>
+#include <iris/core/error.h>
+#include <iris/core/wait_queue.h>
+#include <iris/mm/address_space.h>
+#include <iris/mm/physical_address.h>
+
+namespace iris {
+/// @brief The number of wait queues which futex waiters are hashed into.
+constexpr inline auto futex_bucket_count = 256zu;
+
+struct FutexWaiter : di::IntrusiveListNode<> {
+    /// The physical address of the futex word, which identifies the futex regardless of where it is mapped.
+    mm::PhysicalAddress key { 0 };
+
+    /// Only set while the waiter's wait queue lock is held, by the task which removed it from its bucket.
+    bool woken { false };
+    WaitQueue wait_queue;
+};
+
+/// @brief The list of waiters for every futex whose key hashes to it.
+///
+/// Each waiter sleeps on its own wait queue, so waking a futex only wakes the tasks it removes from the list. The
+/// bucket's lock is held while waking a waiter, so a waiter must acquire it before returning.
+struct FutexBucket {
+    di::Synchronized<di::IntrusiveList<FutexWaiter>> waiters;
+};
+
+/// @brief Block the current task until the futex word at @p address is woken by futex_wake().
+///
+/// The futex word is compared with @p expected_value while holding the bucket's lock, so a wake which follows a store
+/// to the futex word cannot be missed.
+///
+/// @return Returns Error::ResourceUnavailableTryAgain if the futex word did not hold @p expected_value, and
+///         Error::TimedOut if @p deadline passed before the task was woken.
+Expected<void> futex_wait(mm::AddressSpace& address_space, u32 const* address, u32 expected_value,
+                          di::Optional<di::Nanoseconds> deadline);
+
+/// @brief Wake up to @p count tasks waiting on the futex word at @p address.
+///
+/// @return The number of tasks which were woken.
+Expected<u32> futex_wake(mm::AddressSpace& address_space, u32 const* address, u32 count);
+}
@@ -7,12 +7,13 @@
 #include <di/sync/prelude.h>
 #include <iris/core/config.h>
 #include <iris/core/error.h>
-#include <iris/core/object_pool.h>
+#include <iris/core/futex.h>
 #include <iris/core/processor.h>
 #include <iris/core/scheduler.h>
 #include <iris/core/task.h>
 #include <iris/core/task_namespace.h>
 #include <iris/core/unit_test.h>
+#include <iris/fs/dentry_cache.h>
 #include <iris/fs/inode.h>
 #include <iris/fs/mount.h>
 #include <iris/fs/super_block.h>
@@ -22,6 +23,7 @@
 #include <iris/hw/timer.h>
 #include <iris/mm/address_space.h>
 #include <iris/mm/backing_object.h>
+#include <iris/mm/heap.h>
 #include <iris/mm/physical_address.h>
 
 #include IRIS_ARCH_INCLUDE(hw/processor_info.h)
@@ -53,7 +55,12 @@ struct GlobalState {
     mutable di::LinkedList<di::Synchronized<Timer>> timers;
     mutable di::Synchronized<Timer>* scheduler_timer { nullptr };
     mutable di::Synchronized<Timer>* calibration_timer { nullptr };
+    mutable di::Array<IrqHandler, 32> unlocked_exception_handlers;
     bool current_processor_available { false };
+    /// The cycle counter's value when its frequency was calibrated, which is the start of the monotonic clock.
+    u64 boot_cycle_counter { 0 };
+    /// The frequency of the cycle counter, or 0 if it has not been calibrated.
+    u64 cycle_counter_cycles_per_ms { 0 };
     /// @}
 
     /// @name Mutable fields
@@ -62,9 +69,8 @@ struct GlobalState {
     /// `.with_lock()` to mutate or even read these fields.
     /// @{
     mutable mm::AddressSpace kernel_address_space;
-    mutable mm::VirtualAddress heap_end { 0 };
-    mutable di::Array<mm::Region, 6> inital_kernel_regions;
-    mutable di::Array<mm::BackingObject, 5> inital_kernel_backing_objects;
+    mutable di::Array<mm::Region, 5> inital_kernel_regions;
+    mutable di::Array<mm::BackingObject, 4> inital_kernel_backing_objects;
     mutable TaskNamespace task_namespace;
     mutable di::Queue<byte, di::StaticRing<byte, di::Constexpr<128zu>>> input_data_queue;
     mutable WaitQueue input_wait_queue;
@@ -74,9 +80,12 @@ struct GlobalState {
     mutable di::Synchronized<di::Array<di::StaticVector<IrqHandler, di::Constexpr<8zu>>, 256>> irq_handlers;
     mutable arch::MutableGlobalState arch_mutable_state;
     mutable di::Atomic<bool> all_aps_booted { false };
-    mutable Spinlock debug_output_lock;
-    mutable di::Synchronized<ObjectPool<IpiMessage>> ipi_message_pool;
-    mutable di::Atomic<u32> next_processor_to_schedule_on { 0 };
+    mutable QueuedSpinlock debug_output_lock;
+    mutable di::Array<di::Synchronized<mm::SlabDepot>, mm::heap_size_class_count> heap_slab_depots;
+    mutable di::Atomic<usize> heap_large_allocation_count { 0 };
+    mutable di::Atomic<usize> heap_large_allocation_page_count { 0 };
+    mutable di::Array<FutexBucket, futex_bucket_count> futex_buckets;
+    mutable DentryCache dentry_cache;
     /// @}
 };
 
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <di/sync/prelude.h>
+#include <di/vocab/array/prelude.h>
+#include <iris/mm/tlb_flush_batch.h>
+
+namespace iris {
+class Task;
+
+/// @brief A request from one processor for other processors to flush their TLB.
+///
+/// Each processor owns a single request, since it waits for every target to process its request before sending
+/// another one.
+struct TlbFlushRequest {
+    mm::TlbFlushBatch batch;
+
+    /// The number of processors which have not processed the request yet.
+    di::Atomic<u32> remaining { 0 };
+};
+
+/// @brief A lock-free inbox of messages sent to a processor by other processors.
+///
+/// Any processor can post messages, but only the owning processor takes them. Messages are stored without allocating:
+/// tasks to schedule are linked through the tasks themselves, and TLB flush and page frame cache drain requests are
+/// recorded in bitmaps of sender processor ids, since each sender has at most one outstanding request of each kind.
+///
+/// Posting a message returns whether the sender must interrupt the owning processor, which is only the case if no
+/// interrupt is already pending. Every message posted before the owner takes the contents of the inbox is handled by
+/// the same interrupt, so a burst of messages costs a single interrupt.
+class IpiInbox {
+public:
+    constexpr static auto max_processors = 256zu;
+
+    struct Messages {
+        di::Array<u64, max_processors / 64> tlb_flush_senders {};
+        di::Array<u64, max_processors / 64> page_frame_cache_drain_senders {};
+
+        /// Tasks to schedule, linked in the order they were posted.
+        Task* tasks_to_schedule { nullptr };
+    };
+
+    IpiInbox() = default;
+
+    IpiInbox(IpiInbox const&) = delete;
+    IpiInbox& operator=(IpiInbox const&) = delete;
+
+    [[nodiscard]] bool post_task_to_schedule(Task& task);
+    [[nodiscard]] bool post_tlb_flush(u32 sender_processor_id);
+    [[nodiscard]] bool post_page_frame_cache_drain(u32 sender_processor_id);
+
+    /// @brief Take every message posted so far.
+    ///
+    /// Messages posted after this point raise a new interrupt.
+    ///
+    /// @warning This must only be called by the owning processor.
+    Messages take();
+
+private:
+    bool mark_interrupt_pending();
+
+    di::Atomic<Task*> m_tasks_to_schedule { nullptr };
+    di::Array<di::Atomic<u64>, max_processors / 64> m_tlb_flush_senders {};
+    di::Array<di::Atomic<u64>, max_processors / 64> m_page_frame_cache_drain_senders {};
+    di::Atomic<bool> m_interrupt_pending { false };
+};
+}
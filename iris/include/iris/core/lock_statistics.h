@@ -0,0 +1,23 @@
+#pragma once
+
+#include <di/sync/atomic.h>
+#include <di/types/prelude.h>
+
+namespace iris {
+/// @brief Contention counters for a single lock.
+///
+/// These are only collected when the kernel is built with IRIS_LOCK_STATISTICS, since they add several atomic
+/// operations to every acquisition.
+struct LockStatistics {
+    di::sync::Atomic<u64> acquisitions { 0 };
+    /// The number of acquisitions which had to wait for another processor.
+    di::sync::Atomic<u64> contended_acquisitions { 0 };
+    /// The total number of times waiters polled the lock before acquiring it.
+    di::sync::Atomic<u64> spin_iterations { 0 };
+    di::sync::Atomic<u64> total_hold_cycles { 0 };
+    di::sync::Atomic<u64> max_hold_cycles { 0 };
+
+    /// The cycle counter value when the lock was last acquired. Only accessed by the lock's owner.
+    u64 acquired_at { 0 };
+};
+}
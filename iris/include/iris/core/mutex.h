@@ -0,0 +1,36 @@
+#pragma once
+
+#include <di/sync/atomic.h>
+#include <di/util/immovable.h>
+#include <iris/core/wait_queue.h>
+
+namespace iris {
+class Processor;
+class Task;
+
+/// @brief A lock which puts contending tasks to sleep, instead of spinning.
+///
+/// Contending tasks spin while the owner of the lock is running on another processor, since it will likely release the
+/// lock soon. Otherwise, they block until the lock is released.
+///
+/// Unlike InterruptibleSpinlock, the owner can be preempted while holding the lock, so this must not be used for data
+/// which is accessed in IRQ context. Since a contending task may need to sleep, the lock must never be acquired with
+/// interrupts or preemption disabled.
+class Mutex : di::util::Immovable {
+public:
+    Mutex() = default;
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+private:
+    bool owner_running() const;
+
+    di::sync::Atomic<bool> m_state { false };
+    di::sync::Atomic<Task*> m_owner { nullptr };
+    di::sync::Atomic<Processor*> m_owner_processor { nullptr };
+    di::sync::Atomic<u32> m_waiter_count { 0 };
+    WaitQueue m_wait_queue;
+};
+}
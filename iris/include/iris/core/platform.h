@@ -7,6 +7,7 @@
 #include <di/util/std_new.h>
 #include <di/vocab/error/prelude.h>
 #include <iris/core/error.h>
+#include <iris/core/queued_spinlock.h>
 #include <iris/core/spinlock.h>
 
 namespace di::sync {
@@ -18,7 +19,8 @@ using ThreadId = types::i32;
 
 extern ThreadId get_current_thread_id();
 
-using DefaultLock = iris::Spinlock;
+/// Locks are fair by default, since many of them are contended by every processor.
+using DefaultLock = iris::QueuedSpinlock;
 
 using DefaultAllocator = container::FallibleAllocator;
 using DefaultFallibleAllocator = container::FallibleAllocator;
@@ -40,7 +40,7 @@ namespace detail {
         }
 
     private:
-        di::ScopedLock<Spinlock> m_lock_guard;
+        di::ScopedLock<QueuedSpinlock> m_lock_guard;
     };
 }
 
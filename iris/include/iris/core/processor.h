@@ -1,22 +1,25 @@
 #pragma once
 
 #include <di/sync/prelude.h>
-#include <iris/core/object_pool.h>
+#include <iris/core/ipi_inbox.h>
 #include <iris/core/preemption.h>
 #include <iris/core/scheduler.h>
+#include <iris/mm/heap.h>
+#include <iris/mm/memory_statistics.h>
+#include <iris/mm/page_frame_allocator.h>
+#include <iris/mm/tlb_flush_batch.h>
 #include <iris/mm/virtual_address.h>
 
 #include IRIS_ARCH_INCLUDE(core/processor.h)
 
 namespace iris {
-struct IpiMessage {
-    di::Atomic<u32> times_processed { 0 };
-    mm::VirtualAddress tlb_flush_base {};
-    usize tlb_flush_size { 0 };
-    Task* task_to_schedule { nullptr };
-};
+namespace mm {
+    class AddressSpace;
+}
 
-class Processor : public di::SelfPointer<Processor> {
+class Processor
+    : public di::SelfPointer<Processor>
+    , public arch::ProcessorEntryState {
 public:
     Processor() = default;
 
@@ -24,6 +27,16 @@ public:
 
     u16 id() const { return m_id; }
     Scheduler& scheduler() { return m_scheduler; }
+    Scheduler const& scheduler() const { return m_scheduler; }
+
+    mm::HeapCache& heap_cache() { return m_heap_cache; }
+    mm::HeapCache const& heap_cache() const { return m_heap_cache; }
+
+    mm::PageFrameCache& page_frame_cache() { return m_page_frame_cache; }
+    mm::PageFrameCache const& page_frame_cache() const { return m_page_frame_cache; }
+
+    mm::MemoryCounters& memory_counters() { return m_memory_counters; }
+    mm::MemoryCounters const& memory_counters() const { return m_memory_counters; }
 
     void mark_as_initialized() { m_is_initialized.store(true, di::MemoryOrder::Release); }
     bool is_initialized() const { return m_is_initialized.load(di::MemoryOrder::Acquire); }
@@ -36,20 +49,44 @@ public:
 
     arch::ArchProcessor& arch_processor() { return m_arch_processor; }
 
-    void send_ipi(u32 target_processor_id, di::FunctionRef<void(IpiMessage&)> factory);
-    void broadcast_ipi(di::FunctionRef<void(IpiMessage&)> factory);
+    /// @brief Ask the processor with id @p target_processor_id to schedule @p task.
+    void send_task_to_schedule(u32 target_processor_id, Task& task);
+
+    /// @brief Flush @p batch on every other processor accepted by @p filter, and wait for all of them to finish.
+    void send_tlb_flush(di::FunctionRef<bool(Processor&)> filter, mm::TlbFlushBatch const& batch);
+
+    /// @brief Flush @p batch on every other processor, and wait for all of them to finish.
+    void broadcast_tlb_flush(mm::TlbFlushBatch const& batch);
+
+    /// @brief Return the cached page frames of every other processor to the buddy allocator, and wait for all of them
+    /// to finish.
+    ///
+    /// @warning This must be called with interrupts enabled, since other processors may be waiting on this one too.
+    void drain_remote_page_frame_caches();
 
     void handle_pending_ipi_messages();
 
-    void flush_tlb_local(mm::VirtualAddress base, usize byte_length);
+    void flush_tlb_local(mm::TlbFlushBatch const& batch);
     void flush_tlb_local();
 
+    /// @brief The address space currently loaded on this processor.
+    ///
+    /// @warning This must only be accessed by the owning processor with preemption disabled.
+    mm::AddressSpace* active_address_space() const { return m_active_address_space; }
+    void set_active_address_space(mm::AddressSpace* address_space) { m_active_address_space = address_space; }
+
 private:
     Scheduler m_scheduler;
+    mm::HeapCache m_heap_cache;
+    mm::PageFrameCache m_page_frame_cache;
+    mm::MemoryCounters m_memory_counters;
     di::Atomic<bool> m_is_initialized { false };
     di::Atomic<bool> m_is_booted { false };
     di::Atomic<bool> m_is_online { false };
-    di::Synchronized<di::Queue<IpiMessage*, di::StaticRing<IpiMessage*, di::Constexpr<32zu>>>> m_ipi_message_queue {};
+    IpiInbox m_ipi_inbox;
+    TlbFlushRequest m_tlb_flush_request;
+    di::Atomic<u32> m_page_frame_cache_drains_remaining { 0 };
+    mm::AddressSpace* m_active_address_space { nullptr };
     u16 m_id {};
     arch::ArchProcessor m_arch_processor;
 };
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <di/sync/atomic.h>
+#include <di/util/immovable.h>
+#include <iris/core/interrupt_disabler.h>
+#include <iris/core/lock_statistics.h>
+
+namespace iris {
+/// @brief A fair spinlock, which disables interrupts while held.
+///
+/// This is an MCS lock: processors waiting for the lock form a queue, and each spins on a flag in its own queue node
+/// instead of on the lock itself. Releasing a contended lock only touches the cache line of the next waiter, and the
+/// lock is handed out in the order it was requested. Queue nodes live on the waiter's stack, since they are only needed
+/// until the waiter reaches the head of the queue.
+class QueuedSpinlock : di::util::Immovable {
+public:
+    QueuedSpinlock() = default;
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+#ifdef IRIS_LOCK_STATISTICS
+    LockStatistics const& statistics() const { return m_statistics; }
+#endif
+
+private:
+    struct Node;
+
+    u64 wait_in_queue();
+
+    di::sync::Atomic<bool> m_locked { false };
+    di::sync::Atomic<Node*> m_tail { nullptr };
+    bool m_interrupts_were_disabled { false };
+#ifdef IRIS_LOCK_STATISTICS
+    LockStatistics m_statistics;
+#endif
+};
+}
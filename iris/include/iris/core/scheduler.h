@@ -1,8 +1,47 @@
 #pragma once
 
+#include <iris/core/clock.h>
 #include <iris/core/task.h>
+#include <iris/core/timer_wheel.h>
+#include <iris/hw/timer.h>
 
 namespace iris {
+/// @brief The period in which every runnable task on a processor should get to run at least once.
+///
+/// The scheduler timer only fires while there are tasks waiting to run, and the timeslice given to each task shrinks as
+/// more tasks compete for the processor.
+constexpr inline auto scheduler_target_latency = 20_ms;
+
+/// @brief The shortest timeslice given to a task, which bounds the rate of timer interrupts on a busy processor.
+constexpr inline auto scheduler_min_timeslice = 2_ms;
+
+/// @brief The interval of the scheduler timer, when it cannot be stopped while there is nothing to do.
+constexpr inline auto scheduler_tick_interval = 5_ms;
+
+/// @brief The most virtual runtime a fair task is credited with after sleeping, so that it runs soon after waking up.
+constexpr inline auto scheduler_sleeper_credit = 5_ms;
+
+/// @brief The weight of a fair task with a nice value of 0.
+constexpr inline auto nice_0_weight = 1024_u32;
+
+/// @brief The share of processor time a fair task receives, relative to other fair tasks.
+///
+/// Each nice level changes the weight by a factor of about 1.25, so that a task gets roughly 10% more or less processor
+/// time than a task whose nice value differs by one.
+constexpr u32 nice_to_weight(i32 nice) {
+    constexpr auto weights = di::Array {
+        88761_u32, 71755_u32, 56483_u32, 46273_u32, 36291_u32, 29154_u32, 23254_u32, 18705_u32, 14949_u32, 11916_u32,
+        9548_u32,  7620_u32,  6100_u32,  4904_u32,  3906_u32,  3121_u32,  2501_u32,  1991_u32,  1586_u32,  1277_u32,
+        1024_u32,  820_u32,   655_u32,   526_u32,   423_u32,   335_u32,   272_u32,   215_u32,   172_u32,   137_u32,
+        110_u32,   87_u32,    70_u32,    56_u32,    45_u32,    36_u32,    29_u32,    23_u32,    18_u32,    15_u32,
+    };
+    return weights[usize(di::clamp(nice, min_nice_value, max_nice_value) - min_nice_value)];
+}
+
+struct FairRunQueueCompare {
+    di::strong_ordering operator()(Task const& a, Task const& b) const { return a.vruntime() <=> b.vruntime(); }
+};
+
 class Scheduler {
 public:
     void schedule_task(Task&);
@@ -12,10 +51,18 @@ public:
     void yield();
 
     [[noreturn]] void save_state_and_run_next(arch::TaskState* state);
+    [[noreturn]] void save_kernel_context_and_run_next(uptr stack_pointer);
     [[noreturn]] void exit_current_task();
 
     Task& current_task() const { return *m_current_task; }
     Task* current_task_null_if_during_boot() const { return m_current_task; }
+
+    /// @brief The task this processor is executing right now, or null while it is switching between tasks.
+    ///
+    /// Unlike the current task, this can be read from any processor. It is set when a task is switched to, and cleared
+    /// as soon as this processor starts switching away from it, so a preempted task is never reported as running.
+    Task* running_task() const { return m_running_task.load(di::MemoryOrder::Relaxed); }
+
     mm::AddressSpace& current_address_space();
 
     /// @brief Block the currently running task on this scheduler.
@@ -28,11 +75,73 @@ public:
 
     void setup_idle_task();
 
+    /// @brief The number of tasks waiting in this scheduler's run queue.
+    u32 queued_task_count() const { return m_queued_task_count.load(di::MemoryOrder::Relaxed); }
+
+    /// @brief The number of runnable tasks on this scheduler, including the currently running task.
+    u32 load() const { return queued_task_count() + (m_running_idle_task.load(di::MemoryOrder::Relaxed) ? 0 : 1); }
+
+    /// @brief The number of timer ticks this scheduler has handled.
+    u64 ticks() const { return m_ticks.load(di::MemoryOrder::Relaxed); }
+
+    /// @brief Remove a task from the run queue, so that it can be run on a different processor.
+    ///
+    /// Tasks whose state may still be in use by this processor are never returned. The returned task's virtual runtime
+    /// is made relative to this scheduler.
+    Task* take_task_for_migration();
+
+    /// @brief Push a task to the least loaded processor, if it has noticeably less work than this one.
+    ///
+    /// Idle processors stop their timer, so work is moved by the processors which have too much of it.
+    ///
+    /// @warning This must be called by the owning processor, with interrupts disabled.
+    void balance_load();
+
+    /// @brief Handle an interrupt from the scheduler timer on this processor.
+    void handle_timer_interrupt(IrqContext&);
+
+    /// @brief Arm @p timer to run on this processor once the monotonic clock reaches @p deadline.
+    ///
+    /// @warning This must be called by the owning processor, with interrupts disabled.
+    void add_timer(KernelTimer& timer, di::Nanoseconds deadline);
+
 private:
-    [[noreturn]] void run_next();
+    struct RunQueue {
+        di::IntrusiveList<Task> real_time_tasks;
+        di::IntrusiveTreeMultiSet<Task, FairRunQueueTag, FairRunQueueCompare> fair_tasks;
+
+        /// A lower bound on the virtual runtime of every fair task on this scheduler, which never decreases.
+        i64 min_vruntime { 0 };
+    };
+
+    [[noreturn]] void run_next(Task* outgoing_task);
+    [[noreturn]] void switch_away_from_current_task();
+
+    void enqueue_task(Task&);
+    void requeue_task(Task&);
+    void detach_task(Task&);
+    Task* pop_task();
+    Task* steal_task();
+    void tick();
+
+    void update_timer(bool new_timeslice);
+    void account_current_task();
+    bool should_preempt_current_task();
+    void update_min_vruntime(RunQueue&, Task* running_task);
+    void insert_task(RunQueue&, Task&);
 
     Task* m_current_task { nullptr };
-    di::Queue<Task, di::IntrusiveList<Task>> m_run_queue;
+    Task* m_previous_task { nullptr };
+    di::Atomic<Task*> m_running_task { nullptr };
+    di::Synchronized<RunQueue> m_run_queue;
+    di::Atomic<u32> m_queued_task_count { 0 };
+    di::Atomic<bool> m_running_idle_task { true };
+    di::Atomic<u64> m_ticks { 0 };
+    TimerWheel m_timer_wheel;
+    di::Optional<di::Nanoseconds> m_timeslice_end;
+    di::Nanoseconds m_timer_deadline { 0 };
+    bool m_tickless { false };
+    bool m_timer_armed { false };
     di::Arc<Task> m_idle_task;
 };
 
@@ -40,6 +149,30 @@ private:
 ///
 /// @param task The task to schedule.
 ///
-/// @note This function internally decides which processor the task should run on.
+/// @note This function internally decides which processor the task should run on. Tasks are placed on the processor
+///       they last ran on when it is not busier than the current processor, so that their data is likely to still be
+///       cached. Tasks which have never run are placed on the least loaded processor.
 void schedule_task(Task&);
+
+#ifdef IRIS_UNIT_TESTS
+namespace test {
+/// @brief How schedule_task() places tasks on processors.
+enum class TaskPlacement {
+    /// Place tasks as described by schedule_task(), and move them between processors with work stealing and load
+    /// balancing.
+    Balanced,
+    /// Place tasks round-robin and never move them afterwards, like the scheduler did before work stealing. This only
+    /// exists in unit test builds, so that benchmarks can compare against it.
+    RoundRobin,
+};
+
+void set_task_placement(TaskPlacement placement);
+}
+#endif
+
+/// @brief Block the current task until the monotonic clock reaches @p deadline.
+Expected<void> sleep_until(di::Nanoseconds deadline);
+
+/// @brief Block the current task for at least @p duration.
+Expected<void> sleep_for(di::Nanoseconds duration);
 }
@@ -10,6 +10,7 @@
 #include <iris/fs/file.h>
 #include <iris/fs/tnode.h>
 #include <iris/mm/address_space.h>
+#include <iris/uapi/scheduling.h>
 
 #include IRIS_ARCH_INCLUDE(core/task.h)
 
@@ -20,6 +21,8 @@ using TaskId = di::StrongInt<TaskIdTag>;
 
 class TaskNamespace;
 
+struct FairRunQueueTag : di::IntrusiveTreeSetTag<FairRunQueueTag> {};
+
 struct TaskFinalizationRequest {
     di::Arc<mm::AddressSpace> address_space;
     mm::VirtualAddress kernel_stack;
@@ -27,6 +30,7 @@ struct TaskFinalizationRequest {
 
 class Task
     : public di::IntrusiveListNode<>
+    , public di::IntrusiveTreeSetNode<FairRunQueueTag>
     , public di::IntrusiveRefCount<Task> {
 public:
     explicit Task(bool userspace, di::Arc<mm::AddressSpace> address_space, di::Arc<TaskNamespace> task_namespace,
@@ -45,6 +49,12 @@ public:
         if (m_kernel_stack.raw_value() != 0) {
             arch::load_kernel_stack(m_kernel_stack + 0x2000zu);
         }
+
+        // A task which yielded is still in the kernel, and only the registers saved by yielding need to be restored.
+        if (auto kernel_context = di::exchange(m_kernel_context, 0)) {
+            arch::switch_to_kernel_context(kernel_context);
+        }
+
         arch::load_userspace_thread_pointer(userspace_thread_pointer(), m_task_state);
 
         m_task_state.context_switch_to();
@@ -53,6 +63,15 @@ public:
     arch::TaskState const& task_state() const { return m_task_state; }
     void set_task_state(arch::TaskState const& state) { m_task_state = state; }
 
+    /// @brief Record the stack pointer of the kernel context saved by `Scheduler::yield()`.
+    ///
+    /// The task will be resumed from this context instead of its task state the next time it runs.
+    void set_kernel_context(uptr stack_pointer) { m_kernel_context = stack_pointer; }
+
+    /// @brief The next task in the IPI inbox this task was posted to, to be scheduled by another processor.
+    Task* next_in_ipi_inbox() const { return m_next_in_ipi_inbox; }
+    void set_next_in_ipi_inbox(Task* task) { m_next_in_ipi_inbox = task; }
+
     di::Arc<TaskArguments> task_arguments() const { return m_task_arguments; }
     void set_task_arguments(di::Arc<TaskArguments> task_arguments) { m_task_arguments = di::move(task_arguments); }
 
@@ -87,6 +106,49 @@ public:
     void set_waiting() { return m_waiting.store(true, di::MemoryOrder::Relaxed); }
     void set_runnable() { return m_waiting.store(false, di::MemoryOrder::Relaxed); }
 
+    /// @brief The id of the processor this task last ran on, if it has ever run.
+    di::Optional<u32> last_processor_id() const {
+        auto id = m_last_processor_id.load(di::MemoryOrder::Relaxed);
+        if (id == no_processor_id) {
+            return di::nullopt;
+        }
+        return id;
+    }
+    void set_last_processor_id(u32 id) { m_last_processor_id.store(id, di::MemoryOrder::Relaxed); }
+
+    /// @brief Whether this task's last processor may still be using its state.
+    ///
+    /// This is set when the task starts running, and is only cleared once its processor has completed switching to a
+    /// different task. While set, the task must not be run on any other processor.
+    bool on_processor() const { return m_on_processor.load(di::MemoryOrder::Acquire); }
+    void set_on_processor(bool value) { m_on_processor.store(value, di::MemoryOrder::Release); }
+
+    SchedulingClass scheduling_class() const {
+        return SchedulingClass(m_scheduling_class.load(di::MemoryOrder::Relaxed));
+    }
+    i32 nice() const { return m_nice.load(di::MemoryOrder::Relaxed); }
+
+    /// @brief Change how this task is scheduled.
+    ///
+    /// This can be called from any processor. The new class takes effect the next time the task is added to a run
+    /// queue, and the new nice value the next time the task's runtime is accounted for.
+    void set_scheduling_class(SchedulingClass scheduling_class, i32 nice) {
+        m_nice.store(nice, di::MemoryOrder::Relaxed);
+        m_scheduling_class.store(di::to_underlying(scheduling_class), di::MemoryOrder::Relaxed);
+    }
+
+    /// @brief The processor time used by this task in nanoseconds, scaled inversely by its weight.
+    ///
+    /// While the task is queued or running, this is comparable with the other tasks of its scheduler. Otherwise, it is
+    /// stored relative to the minimum virtual runtime of the scheduler it last left, so that it can be placed fairly
+    /// on any scheduler. This must only be modified by the scheduler which owns the task.
+    i64 vruntime() const { return m_vruntime; }
+    void set_vruntime(i64 vruntime) { m_vruntime = vruntime; }
+
+    /// @brief The monotonic time when this task's runtime was last accounted for.
+    di::Nanoseconds run_start() const { return m_run_start; }
+    void set_run_start(di::Nanoseconds run_start) { m_run_start = run_start; }
+
     mm::VirtualAddress kernel_stack() const { return m_kernel_stack; }
     void set_kernel_stack(mm::VirtualAddress kernel_stack) { m_kernel_stack = kernel_stack; }
 
@@ -102,7 +164,11 @@ public:
     void set_cwd_tnode(di::Arc<TNode> cwd_tnode) { m_cwd_tnode = di::move(cwd_tnode); }
 
 private:
+    constexpr static auto no_processor_id = di::NumericLimits<u32>::max;
+
     arch::TaskState m_task_state;
+    uptr m_kernel_context { 0 };
+    Task* m_next_in_ipi_inbox { nullptr };
     arch::FpuState m_fpu_state;
     di::Arc<mm::AddressSpace> m_address_space;
     di::Arc<TaskNamespace> m_task_namespace;
@@ -113,6 +179,12 @@ private:
     di::Arc<TaskStatus> m_task_status;
     di::Arc<TaskArguments> m_task_arguments;
     di::Atomic<bool> m_waiting { false };
+    di::Atomic<bool> m_on_processor { false };
+    di::Atomic<u32> m_last_processor_id { no_processor_id };
+    di::Atomic<u32> m_scheduling_class { di::to_underlying(SchedulingClass::Fair) };
+    di::Atomic<i32> m_nice { 0 };
+    i64 m_vruntime { 0 };
+    di::Nanoseconds m_run_start { 0 };
     mm::VirtualAddress m_kernel_stack { 0 };
     uptr m_userspace_thread_pointer { 0 };
     FileTable m_file_table;
@@ -4,6 +4,7 @@
 #include <di/sync/prelude.h>
 #include <di/vocab/pointer/prelude.h>
 #include <iris/core/error.h>
+#include <iris/core/interruptible_spinlock.h>
 #include <iris/core/task.h>
 
 namespace iris {
@@ -16,6 +17,9 @@ public:
 
     Expected<di::Arc<Task>> find_task(TaskId id) const;
 
+    /// @brief All registered tasks, ordered by task id.
+    di::TreeMap<TaskId, di::Arc<Task>> const& tasks() const { return m_task_id_map; }
+
 private:
     TaskId m_next_id { 0 };
     di::TreeMap<TaskId, di::Arc<Task>> m_task_id_map;
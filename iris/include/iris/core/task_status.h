@@ -9,6 +9,11 @@ public:
 
     Expected<void> wait_until_exited();
 
+    /// @brief Wait for the task to exit, giving up once the monotonic clock reaches @p deadline.
+    ///
+    /// @return Returns Error::TimedOut if the task was still running at the deadline.
+    Expected<void> wait_until_exited(di::Nanoseconds deadline);
+
 private:
     WaitQueue m_wait_queue;
     bool m_exited { false };
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <di/chrono/duration/prelude.h>
+#include <di/container/intrusive/prelude.h>
+#include <di/function/container/prelude.h>
+#include <di/sync/prelude.h>
+#include <di/vocab/array/prelude.h>
+#include <di/vocab/optional/prelude.h>
+
+namespace iris {
+class TimerWheel;
+
+/// @brief A callback which runs once a deadline has passed.
+///
+/// Kernel timers are owned by the code which arms them, and typically live on the stack of a blocked task. The callback
+/// runs from the scheduler timer interrupt of the processor which armed the timer, with interrupts disabled.
+class KernelTimer : public di::IntrusiveListNode<> {
+public:
+    explicit KernelTimer(di::Function<void()> callback) : m_callback(di::move(callback)) {}
+
+    KernelTimer(KernelTimer const&) = delete;
+    KernelTimer& operator=(KernelTimer const&) = delete;
+
+    ~KernelTimer() { cancel(); }
+
+    /// @brief Prevent the timer from running.
+    ///
+    /// If the callback is currently running on another processor, this waits for it to finish, so that the timer can
+    /// be safely destroyed afterwards.
+    ///
+    /// @return Returns true if the timer was removed before its callback ran.
+    bool cancel();
+
+private:
+    friend class TimerWheel;
+
+    di::Function<void()> m_callback;
+    di::Nanoseconds m_deadline { 0 };
+    di::Atomic<TimerWheel*> m_wheel { nullptr };
+    usize m_slot { 0 };
+    bool m_queued { false };
+};
+
+/// @brief A hierarchical timing wheel, which holds the kernel timers of a single processor.
+///
+/// Each level has 64 slots, and each slot of a level covers 64 times as much time as a slot of the level below it.
+/// Timers are placed in the lowest level which can represent their deadline, and are moved to lower levels as their
+/// deadline approaches. This makes adding and removing timers constant time, regardless of how many are pending.
+class TimerWheel {
+public:
+    /// The granularity of the wheel. Deadlines are rounded up to a multiple of this.
+    constexpr static auto resolution = di::Nanoseconds(1'000'000);
+
+    constexpr static auto level_count = 4zu;
+    constexpr static auto slots_per_level = 64zu;
+    constexpr static auto bits_per_level = 6zu;
+
+    TimerWheel() = default;
+
+    TimerWheel(TimerWheel const&) = delete;
+    TimerWheel& operator=(TimerWheel const&) = delete;
+
+    /// @brief Arm @p timer to run once the monotonic clock reaches @p deadline.
+    ///
+    /// @warning The timer must not already be pending.
+    void add(KernelTimer& timer, di::Nanoseconds deadline);
+
+    /// @brief Run the callback of every timer whose deadline is at or before @p now.
+    ///
+    /// @warning This must only be called by the processor which owns this wheel.
+    void expire(di::Nanoseconds now);
+
+    /// @brief The time at which the wheel next needs to be processed, or nullopt if no timers are pending.
+    ///
+    /// This may be earlier than the deadline of any timer, because timers in the upper levels must be moved down at the
+    /// start of their slot.
+    di::Optional<di::Nanoseconds> next_event() const;
+
+    /// @brief The number of timers waiting to run.
+    usize pending_count() const {
+        return m_state.with_lock([](State const& state) {
+            return state.pending_count;
+        });
+    }
+
+private:
+    friend class KernelTimer;
+
+    /// Value initialized by di::Synchronized, so every bitmap and counter starts at zero.
+    struct State {
+        di::Array<di::Array<di::IntrusiveList<KernelTimer>, slots_per_level>, level_count> slots;
+
+        /// Bitmaps of the non-empty slots of each level.
+        di::Array<u64, level_count> occupied;
+
+        /// The next tick of the wheel which has not been processed.
+        u64 current_tick;
+
+        usize pending_count;
+    };
+
+    static void insert(State& state, KernelTimer& timer);
+    static void remove(State& state, KernelTimer& timer);
+    static di::Optional<u64> next_event_tick(State const& state);
+
+    mutable di::Synchronized<State> m_state;
+};
+}
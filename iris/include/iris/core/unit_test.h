@@ -3,6 +3,12 @@
 #include <di/container/string/prelude.h>
 #include <di/container/vector/prelude.h>
 #include <di/util/prelude.h>
+#include <di/vocab/pointer/prelude.h>
+#include <di/vocab/span/prelude.h>
+
+namespace iris {
+class Task;
+}
 
 namespace iris::test {
 using TestCaseFunction = void (*)();
@@ -42,6 +48,17 @@ public:
 private:
     di::Vector<TestCase> m_test_cases;
 };
+
+/// @brief Create @p count kernel tasks which run @p entry, without scheduling them.
+di::Vector<di::Arc<Task>> create_kernel_tasks(usize count, void (*entry)());
+
+/// @brief Schedule every task in @p tasks, and wait until all of them have exited.
+void run_tasks_to_completion(di::Span<di::Arc<Task> const> tasks);
+
+/// @brief Run @p count kernel tasks which call @p entry, and wait until all of them have exited.
+///
+/// Like any kernel task, @p entry must end by calling `exit_current_task()`.
+void run_kernel_tasks(usize count, void (*entry)());
 }
 
 #define IRIS_TEST(suite_name, case_name)                                                                          \
@@ -1,9 +1,10 @@
 #pragma once
 
-#include <di/container/queue/prelude.h>
+#include <di/chrono/duration/prelude.h>
+#include <di/container/intrusive/prelude.h>
 #include <di/function/container/prelude.h>
 #include <di/sync/prelude.h>
-#include <iris/core/task.h>
+#include <iris/core/error.h>
 
 namespace iris {
 class WaitQueue {
@@ -28,13 +29,24 @@ public:
     ///         an event has occurred.
     Expected<void> wait(di::FunctionRef<bool()> predicate);
 
+    /// @brief Wait for an event to occur, giving up once the monotonic clock reaches @p deadline.
+    ///
+    /// @param deadline The monotonic time after which to stop waiting.
+    /// @param predicate Predicate which will met if this function returns successfully.
+    ///
+    /// @return Returns Error::TimedOut if the deadline passed before the predicate was satisfied.
+    Expected<void> wait_until(di::Nanoseconds deadline, di::FunctionRef<bool()> predicate);
+
 private:
-    struct WaitQueueEntry : di::IntrusiveForwardListNode<> {
+    struct WaitQueueEntry : di::IntrusiveListNode<> {
         explicit WaitQueueEntry(di::Function<void()> notify_) : notify(di::move(notify_)) {}
 
         di::Function<void()> notify;
+        bool queued { false };
     };
 
-    di::Synchronized<di::Queue<WaitQueueEntry, di::IntrusiveForwardList<WaitQueueEntry>>> m_queue;
+    Expected<void> do_wait(di::Optional<di::Nanoseconds> deadline, di::FunctionRef<bool()> predicate);
+
+    di::Synchronized<di::IntrusiveList<WaitQueueEntry>> m_queue;
 };
 }
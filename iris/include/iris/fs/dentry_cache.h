@@ -0,0 +1,108 @@
+#pragma once
+
+#include <di/container/intrusive/prelude.h>
+#include <di/container/string/prelude.h>
+#include <di/sync/prelude.h>
+#include <di/vocab/array/prelude.h>
+#include <di/vocab/optional/prelude.h>
+#include <di/vocab/pointer/prelude.h>
+
+namespace iris {
+class TNode;
+
+/// @brief The number of hash buckets in the dentry cache.
+constexpr inline auto dentry_cache_bucket_count = 1024zu;
+
+/// @brief The default number of entries kept in the dentry cache before the least recently used are evicted.
+constexpr inline auto dentry_cache_capacity = 4096zu;
+
+struct DentryCacheBucketTag : di::IntrusiveListTag<DentryCacheBucketTag> {};
+struct DentryCacheLruTag : di::IntrusiveListTag<DentryCacheLruTag> {};
+
+/// @brief A cached result of looking up @p name in the directory @p parent.
+///
+/// Negative entries have a null @p node, and record that the name did not exist at the parent directory's @p generation.
+struct DentryCacheEntry
+    : di::IntrusiveListNode<DentryCacheBucketTag>
+    , di::IntrusiveListNode<DentryCacheLruTag> {
+    /// Holding the parent ensures that its address is not reused while the entry is cached.
+    di::Arc<TNode> parent;
+    di::TransparentString name;
+    di::Arc<TNode> node;
+    u64 generation { 0 };
+    u64 hash { 0 };
+};
+
+/// @brief A cache of path component lookups, keyed by the parent TNode and the component name.
+///
+/// Hits avoid calling into the file system, and return the same TNode every time, so repeatedly resolving a path
+/// allocates nothing. The cache is bounded, and evicts the least recently used entry once it is full.
+///
+/// A directory can be reached through several TNodes, so negative entries are validated against the generation of the
+/// directory's inode, which changes whenever a name is created in it. This way, creating a name through one TNode
+/// invalidates negative entries cached under every other one.
+class DentryCache {
+public:
+    struct Statistics {
+        di::Atomic<u64> hits { 0 };
+        di::Atomic<u64> negative_hits { 0 };
+        di::Atomic<u64> misses { 0 };
+        di::Atomic<u64> evictions { 0 };
+    };
+
+    explicit DentryCache(usize capacity = dentry_cache_capacity) : m_capacity(capacity) {}
+
+    DentryCache(DentryCache const&) = delete;
+    DentryCache& operator=(DentryCache const&) = delete;
+
+    ~DentryCache();
+
+    /// @brief Look up @p name in @p parent, whose directory is currently at @p generation.
+    ///
+    /// @return Returns nullopt on a miss. Otherwise, returns the cached TNode, which is null for a negative entry.
+    ///         Negative entries made at a different generation are treated as misses.
+    di::Optional<di::Arc<TNode>> lookup(TNode const& parent, di::TransparentStringView name, u64 generation);
+
+    /// @brief Cache that looking up @p name in @p parent found @p node, replacing any existing entry.
+    ///
+    /// Since the cache is only an optimization, this silently does nothing if memory cannot be allocated.
+    void insert(di::Arc<TNode> parent, di::TransparentStringView name, di::Arc<TNode> node);
+
+    /// @brief Cache that @p name did not exist in @p parent when its directory was at @p generation.
+    ///
+    /// The generation must be read before asking the file system, so that a concurrent creation either is seen by the
+    /// lookup or makes the entry stale. A negative entry never replaces a positive one.
+    void insert_negative(di::Arc<TNode> parent, di::TransparentStringView name, u64 generation);
+
+    /// @brief Remove the entry for @p name in @p parent, if one exists.
+    void invalidate(TNode const& parent, di::TransparentStringView name);
+
+    /// @brief The number of entries currently cached.
+    usize size() const {
+        return m_state.with_lock([](State const& state) {
+            return state.size;
+        });
+    }
+
+    Statistics const& statistics() const { return m_statistics; }
+
+private:
+    struct State {
+        di::Array<di::IntrusiveList<DentryCacheEntry, DentryCacheBucketTag>, dentry_cache_bucket_count> buckets;
+
+        /// Ordered from least to most recently used.
+        di::IntrusiveList<DentryCacheEntry, DentryCacheLruTag> lru;
+
+        usize size { 0 };
+    };
+
+    static DentryCacheEntry* find(State& state, u64 hash, TNode const& parent, di::TransparentStringView name);
+    static void remove(State& state, DentryCacheEntry& entry);
+
+    void do_insert(di::Arc<TNode> parent, di::TransparentStringView name, di::Arc<TNode> node, u64 generation);
+
+    mutable di::Synchronized<State> m_state;
+    Statistics m_statistics;
+    usize m_capacity { 0 };
+};
+}
@@ -9,6 +9,7 @@
 #include <di/types/prelude.h>
 #include <iris/core/error.h>
 #include <iris/core/userspace_buffer.h>
+#include <iris/mm/backing_object.h>
 #include <iris/uapi/metadata.h>
 
 namespace iris {
@@ -27,6 +28,20 @@ namespace detail {
         }
     };
 
+    struct WriteFileAtDefaultFunction {
+        template<typename T>
+        di::AnySenderOf<usize> operator()(T&, UserspaceBuffer<byte const>, u64) const {
+            return di::Unexpected(Error::InvalidSeek);
+        }
+    };
+
+    struct ReadFileAtDefaultFunction {
+        template<typename T>
+        di::AnySenderOf<usize> operator()(T&, UserspaceBuffer<byte>, u64) const {
+            return di::Unexpected(Error::InvalidSeek);
+        }
+    };
+
     struct ReadDirectoryDefaultFunction {
         template<typename T>
         di::AnySenderOf<usize> operator()(T&, UserspaceBuffer<byte>) const {
@@ -49,6 +64,12 @@ namespace detail {
     struct FileHACKRawDataFunction {
         di::AnySenderOf<di::Span<byte const>> operator()(auto&) const { return di::Unexpected(Error::NotSupported); }
     };
+
+    struct FileBackingObjectDefaultFunction {
+        di::AnySenderOf<di::Arc<mm::BackingObject>> operator()(auto&) const {
+            return di::Unexpected(Error::NotSupported);
+        }
+    };
 }
 
 struct WriteFileFunction
@@ -63,6 +84,20 @@ struct ReadFileFunction
 
 constexpr inline auto read_file = ReadFileFunction {};
 
+/// @brief Write to a file at @p offset, without using or updating the file's current offset.
+struct WriteFileAtFunction
+    : di::Dispatcher<WriteFileAtFunction, di::AnySenderOf<usize>(di::This&, UserspaceBuffer<byte const>, u64),
+                     detail::WriteFileAtDefaultFunction> {};
+
+constexpr inline auto write_file_at = WriteFileAtFunction {};
+
+/// @brief Read from a file at @p offset, without using or updating the file's current offset.
+struct ReadFileAtFunction
+    : di::Dispatcher<ReadFileAtFunction, di::AnySenderOf<usize>(di::This&, UserspaceBuffer<byte>, u64),
+                     detail::ReadFileAtDefaultFunction> {};
+
+constexpr inline auto read_file_at = ReadFileAtFunction {};
+
 struct ReadDirectoryFunction
     : di::Dispatcher<ReadDirectoryFunction, di::AnySenderOf<usize>(di::This&, UserspaceBuffer<byte>),
                      detail::ReadDirectoryDefaultFunction> {};
@@ -91,8 +126,17 @@ struct FileHACKRawDataFunction
 
 constexpr inline auto file_hack_raw_data = FileHACKRawDataFunction {};
 
-using FileInterface = di::meta::List<WriteFileFunction, ReadFileFunction, ReadDirectoryFunction, FileMetadataFunction,
-                                     SeekFileFunction, FileTruncateFunction, FileHACKRawDataFunction>;
+/// @brief Get the object which caches the file's contents, so that it can be mapped into memory.
+struct FileBackingObjectFunction
+    : di::Dispatcher<FileBackingObjectFunction, di::AnySenderOf<di::Arc<mm::BackingObject>>(di::This&),
+                     detail::FileBackingObjectDefaultFunction> {};
+
+constexpr inline auto file_backing_object = FileBackingObjectFunction {};
+
+using FileInterface =
+    di::meta::List<WriteFileFunction, ReadFileFunction, WriteFileAtFunction, ReadFileAtFunction, ReadDirectoryFunction,
+                   FileMetadataFunction, SeekFileFunction, FileTruncateFunction, FileHACKRawDataFunction,
+                   FileBackingObjectFunction>;
 using File = di::AnyShared<FileInterface>;
 
 class FileTable {
@@ -4,6 +4,7 @@
 #include <di/any/prelude.h>
 #include <di/container/tree/prelude.h>
 #include <di/execution/any/any_sender.h>
+#include <di/sync/prelude.h>
 #include <di/types/integers.h>
 #include <iris/core/error.h>
 #include <iris/fs/file.h>
@@ -15,6 +16,8 @@
 namespace iris {
 struct TNode;
 
+/// Read in the page at @p page_number, and add it to the backing object. The page may be read by several tasks at once,
+/// in which case the page added by the first one is returned to all of them.
 struct InodeReadFunction
     : di::Dispatcher<InodeReadFunction,
                      di::AnySenderOf<mm::PhysicalAddress>(di::This&, mm::BackingObject&, u64 page_number)> {};
@@ -67,10 +70,15 @@ public:
     friend di::AnySenderOf<usize> tag_invoke(di::Tag<read_file>, InodeFile& self, UserspaceBuffer<byte> buffer);
     friend di::AnySenderOf<usize> tag_invoke(di::Tag<read_directory>, InodeFile& self, UserspaceBuffer<byte> buffer);
     friend di::AnySenderOf<usize> tag_invoke(di::Tag<write_file>, InodeFile& self, UserspaceBuffer<byte const> buffer);
+    friend di::AnySenderOf<usize> tag_invoke(di::Tag<read_file_at>, InodeFile& self, UserspaceBuffer<byte> buffer,
+                                             u64 offset);
+    friend di::AnySenderOf<usize> tag_invoke(di::Tag<write_file_at>, InodeFile& self,
+                                             UserspaceBuffer<byte const> buffer, u64 offset);
     friend di::AnySenderOf<Metadata> tag_invoke(di::Tag<file_metadata>, InodeFile& self);
     friend di::AnySenderOf<u64> tag_invoke(di::Tag<seek_file>, InodeFile& self, i64 offset, int whence);
     friend di::AnySenderOf<> tag_invoke(di::Tag<file_truncate>, InodeFile& self, u64 size);
     friend di::AnySenderOf<di::Span<byte const>> tag_invoke(di::Tag<file_hack_raw_data>, InodeFile& self);
+    friend di::AnySenderOf<di::Arc<mm::BackingObject>> tag_invoke(di::Tag<file_backing_object>, InodeFile& self);
 
 private:
     di::Arc<TNode> m_tnode;
@@ -79,13 +87,29 @@ private:
 
 class Inode : public di::IntrusiveRefCount<Inode> {
 public:
-    explicit Inode(InodeImpl impl) : m_impl(di::move(impl)) {}
+    explicit Inode(InodeImpl impl) : m_impl(di::move(impl)) { m_backing_object.set_inode(*this); }
 
     mm::BackingObject& backing_object() { return m_backing_object; }
 
     di::Optional<Mount&> mount() const { return m_mount.transform(di::chain(di::dereference, di::ref)); }
     void set_mount(di::Box<Mount> mount) { m_mount = di::move(mount); }
 
+    /// @brief The size of the inode, if it is known without asking the file system.
+    ///
+    /// The size is remembered the first time the inode's metadata is read, and kept up to date by `inode_truncate()`.
+    di::Optional<u64> cached_size() const {
+        auto size = m_cached_size.load(di::MemoryOrder::Acquire);
+        if (size == unknown_size) {
+            return di::nullopt;
+        }
+        return size;
+    }
+
+    /// @brief A counter which is incremented whenever a name is created in this directory.
+    ///
+    /// Cached negative lookups remember the generation they were made at, and are ignored once it changes.
+    u64 directory_generation() const { return m_directory_generation.load(di::MemoryOrder::Acquire); }
+
 private:
     friend di::AnySenderOf<mm::PhysicalAddress> tag_invoke(di::Tag<inode_read>, Inode& self,
                                                            mm::BackingObject& backing_object, u64 page_number);
@@ -100,8 +124,12 @@ private:
     friend di::AnySenderOf<> tag_invoke(di::Tag<inode_truncate>, Inode& self, u64 size);
     friend di::AnySenderOf<di::Span<byte const>> tag_invoke(di::Tag<inode_hack_raw_data>, Inode& self);
 
+    constexpr static auto unknown_size = di::NumericLimits<u64>::max;
+
     InodeImpl m_impl;
     di::Optional<di::Box<Mount>> m_mount;
     mm::BackingObject m_backing_object;
+    di::Atomic<u64> m_cached_size { unknown_size };
+    di::Atomic<u64> m_directory_generation { 0 };
 };
 }
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <di/container/string/prelude.h>
+#include <di/execution/any/any_sender.h>
+#include <iris/core/interruptible_spinlock.h>
+#include <iris/fs/file.h>
+#include <iris/uapi/statistics.h>
+
+namespace iris {
+/// @brief Render a human readable report of kernel statistics.
+Expected<di::String> format_statistics(StatisticsKind kind);
+
+/// @brief A read-only pseudo-file which reports kernel statistics as text.
+///
+/// The report is generated on the first read, so that every read through a single open file observes the same snapshot.
+class StatisticsFile {
+public:
+    explicit StatisticsFile(StatisticsKind kind) : m_kind(kind) {}
+
+private:
+    friend di::AnySenderOf<usize> tag_invoke(di::Tag<read_file>, StatisticsFile& self, UserspaceBuffer<byte> buffer);
+
+    InterruptibleSpinlock m_lock;
+    StatisticsKind m_kind;
+    di::Optional<di::String> m_contents;
+    usize m_offset { 0 };
+};
+}
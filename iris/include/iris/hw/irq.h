@@ -27,5 +27,11 @@ extern "C" void generic_irq_handler(GlobalIrqNumber irq, iris::arch::TaskState&
 Expected<GlobalIrqNumber> irq_number_for_legacy_isa_interrupt_number(IrqLine irq_line);
 Expected<usize> register_external_irq_handler(IrqLine line, IrqHandler handler);
 Expected<void> register_exception_handler(GlobalIrqNumber number, IrqHandler handler);
+
+/// @brief Install the sole handler for an exception, which is called without holding the IRQ handler lock.
+///
+/// This is needed by handlers which can sleep or wait for other processors, which may themselves be trying to handle an
+/// IRQ. Handlers are called with interrupts disabled, and must not be registered after kernel initialization.
+void register_unlocked_exception_handler(GlobalIrqNumber number, IrqHandler handler);
 void unregister_external_irq_handler(IrqLine line, usize handler_id);
 }
@@ -39,18 +39,40 @@ struct TimerSetIntervalFunction
                      Expected<void>(di::This&, TimerResolution, di::Function<void(IrqContext&)>),
                      detail::TimerDefaultNotSupported<>> {};
 
+/// Arm the timer to fire once more, using the callback passed to the last call to `timer_set_single_shot`. This can be
+/// called from within the callback itself.
+struct TimerRestartSingleShotFunction
+    : di::Dispatcher<TimerRestartSingleShotFunction, Expected<void>(di::This&, TimerResolution),
+                     detail::TimerDefaultNotSupported<>> {};
+
+/// Cancel any pending interrupt from the timer.
+struct TimerStopFunction
+    : di::Dispatcher<TimerStopFunction, Expected<void>(di::This&), detail::TimerDefaultNotSupported<>> {};
+
 constexpr inline auto timer_name = TimerName {};
 constexpr inline auto timer_capabilities = TimerCapabilitiesFunction {};
 constexpr inline auto timer_resolution = TimerResolutionFunction {};
 constexpr inline auto timer_calibrate = TimerCalibrateFunction {};
 constexpr inline auto timer_set_single_shot = TimerSetSingleShotFunction {};
 constexpr inline auto timer_set_interval = TimerSetIntervalFunction {};
+constexpr inline auto timer_restart_single_shot = TimerRestartSingleShotFunction {};
+constexpr inline auto timer_stop = TimerStopFunction {};
 
-using TimerInterface = di::meta::List<TimerName, TimerCapabilitiesFunction, TimerResolutionFunction,
-                                      TimerCalibrateFunction, TimerSetSingleShotFunction, TimerSetIntervalFunction>;
+using TimerInterface =
+    di::meta::List<TimerName, TimerCapabilitiesFunction, TimerResolutionFunction, TimerCalibrateFunction,
+                   TimerSetSingleShotFunction, TimerSetIntervalFunction, TimerRestartSingleShotFunction,
+                   TimerStopFunction>;
 using Timer = di::Any<TimerInterface>;
 
 di::Synchronized<Timer>& scheduler_timer();
+
+/// @brief Access the scheduler timer without taking its lock, to reprogram it on the current processor.
+///
+/// Per-CPU timers only program the current processor's hardware, and their shared state is not modified after
+/// calibration, so processors never need to exclude each other from using them.
+///
+/// @warning This must only be used if the scheduler timer has the `PerCpu` capability, and with interrupts disabled.
+Timer& scheduler_timer_unlocked();
 di::Synchronized<Timer>& calibration_timer();
 
 void init_timer_assignments();
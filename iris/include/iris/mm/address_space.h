@@ -4,27 +4,75 @@
 #include <di/sync/prelude.h>
 #include <di/vocab/pointer/prelude.h>
 #include <iris/core/error.h>
-#include <iris/core/interruptible_spinlock.h>
+#include <iris/core/mutex.h>
 #include <iris/mm/backing_object.h>
 #include <iris/mm/physical_address.h>
 #include <iris/mm/physical_page.h>
 #include <iris/mm/region.h>
+#include <iris/mm/tlb_flush_batch.h>
 #include <iris/mm/virtual_address.h>
 
 namespace iris::mm {
 class AddressSpace;
 
+/// @brief The size of a page mapped by a single page directory entry.
+constexpr inline auto large_page_size = 2_u64 * 1024 * 1024;
+
+/// @brief Describes the access which caused a page fault.
+enum class PageFaultFlags {
+    None = 0,
+    /// The faulting address was mapped, so the fault was caused by a protection violation.
+    Present = 1,
+    Write = 2,
+    User = 4,
+    InstructionFetch = 8,
+};
+
+DI_DEFINE_ENUM_BITWISE_OPERATIONS(PageFaultFlags)
+
+/// @brief A page which must be read in from an inode before a page fault can be resolved.
+struct PendingPageRead {
+    di::Arc<Inode> inode;
+    u64 page_number { 0 };
+};
+
 class LockedAddressSpace {
 public:
     Expected<void> map_physical_page_early(VirtualAddress location, PhysicalAddress physical_address,
                                            RegionFlags flags);
     Expected<void> map_physical_page(VirtualAddress location, PhysicalAddress physical_address, RegionFlags flags);
 
+    /// @brief Map a large page at @p location, which must be aligned to `large_page_size`.
+    ///
+    /// The physical memory must be contiguous and aligned to `large_page_size`, and no pages may already be mapped in
+    /// the covered range (see `is_large_page_unmapped()`). Large pages are split into individual pages on demand, for
+    /// instance when one of the pages is replaced to break copy-on-write sharing.
+    Expected<void> map_physical_large_page(VirtualAddress location, PhysicalAddress physical_address,
+                                           RegionFlags flags);
+
+    /// @brief Whether nothing is mapped in the large page sized range containing @p location.
+    bool is_large_page_unmapped(VirtualAddress location);
+
     Expected<VirtualAddress> allocate_region(di::Arc<BackingObject> backing_object, di::Box<Region> region);
     Expected<void> allocate_region_at(di::Arc<BackingObject> backing_object, di::Box<Region> region);
 
     Expected<void> destroy_region(VirtualAddress start, usize length);
 
+    /// @brief Returns the physical page mapped at @p location, if any.
+    di::Optional<PhysicalAddress> translate(VirtualAddress location);
+
+    /// @brief Returns the physical page mapped at @p location, if writes to @p location land in that page.
+    ///
+    /// Returns nothing if the page is not mapped, or if it is shared through copy-on-write, in which case a write fault
+    /// would first replace it with a private copy.
+    di::Optional<PhysicalAddress> translate_for_write(VirtualAddress location);
+
+    /// @brief Remove write access from any pages mapped in the given range.
+    ///
+    /// The stale translations are only queued for invalidation, so that several ranges can be write protected with a
+    /// single TLB shootdown. The caller must call `flush_tlb()` before releasing the lock.
+    Expected<void> write_protect(VirtualAddress base, usize page_aligned_length);
+
     Expected<void> create_low_identity_mapping(VirtualAddress base, usize page_aligned_length);
     Expected<void> remove_low_identity_mapping(VirtualAddress base, usize page_aligned_length);
 
@@ -34,47 +82,164 @@ public:
 
     Expected<void> bootstrap_kernel_page_tracking();
 
+    /// @brief Queue the translations for the given range for invalidation by the next call to `flush_tlb()`.
+    void queue_tlb_flush(VirtualAddress base, usize byte_length) { m_pending_tlb_flush.add(base, byte_length); }
+
+    /// @brief Release a reference to a page which was just unmapped, once its translations are invalidated.
+    ///
+    /// If this was the last reference, the page is only freed by the next call to `flush_tlb()`.
+    void queue_page_drop(PhysicalAddress address);
+
+    /// @brief Free a page table page which was just unlinked, once its translations are invalidated.
+    void queue_page_frame_free(PhysicalAddress address);
+
+    /// @brief Invalidate all queued translations on every processor which has this address space loaded.
+    ///
+    /// For user address spaces, only processors which currently have the address space loaded are sent an IPI.
+    /// Processors which load it later notice that its TLB generation has changed, and flush before using it. Kernel
+    /// mappings are shared by every address space, so changes to the kernel address space are flushed everywhere.
+    ///
+    /// Pages queued by `queue_page_drop()` and `queue_page_frame_free()` are freed once the flush completes.
+    void flush_tlb();
+
     void flush_tlb_global(VirtualAddress base) { flush_tlb_global(base, 1); }
-    void flush_tlb_global(VirtualAddress base, usize byte_length);
+    void flush_tlb_global(VirtualAddress base, usize byte_length) {
+        queue_tlb_flush(base, byte_length);
+        flush_tlb();
+    }
 
     AddressSpace& base();
 
 private:
     friend class AddressSpace;
 
+    Expected<void> map_physical_large_page_early(VirtualAddress location, PhysicalAddress physical_address,
+                                                 RegionFlags flags);
+    /// @brief Find the lowest free range which can hold @p page_aligned_length bytes at the requested alignment.
+    di::Optional<VirtualAddress> find_free_range(usize page_aligned_length, usize alignment);
+    Expected<bool> try_map_large_page(Region& region, VirtualAddress address);
+    Expected<void> split_large_page(VirtualAddress location);
+    Expected<void> populate_kernel_region(Region& region);
+    Expected<void> clone_regions_into(LockedAddressSpace& target);
+
+    /// @brief Resolve a page fault by mapping in the faulting page from its region's backing object.
+    ///
+    /// Reading a page in from an inode can wait for I/O, which must not happen while holding the address space lock.
+    /// Instead, the page to read is returned, and the fault must be retried once it has been read.
+    ///
+    /// @return An error if the fault is not caused by a missing or copy-on-write page in a region which allows the
+    /// access.
+    Expected<di::Optional<PendingPageRead>> try_handle_page_fault(VirtualAddress address, PageFaultFlags flags);
+    void shoot_down_tlb();
+
     di::IntrusiveTreeSet<Region, AddressSpaceRegionListTag> m_regions;
+    TlbFlushBatch m_pending_tlb_flush;
+    di::IntrusiveList<UnmappedPhysicalPage> m_pending_page_frees;
 };
 
 class AddressSpace
-    : public di::Synchronized<LockedAddressSpace, InterruptibleSpinlock>
+    : public di::Synchronized<LockedAddressSpace, Mutex>
     , public di::IntrusiveRefCount<AddressSpace> {
     friend class LockedAddressSpace;
 
 public:
-    AddressSpace() = default;
+    /// @brief The maximum number of processors whose use of an address space can be tracked.
+    constexpr static auto max_processors = 256zu;
+
+    AddressSpace();
 
     ~AddressSpace();
 
+    /// @brief A unique identifier for this address space, which is never reused.
+    u64 id() const { return m_id; }
+
     PhysicalAddress architecture_page_table_base() const { return m_architecture_page_table_base; }
     void set_architecture_page_table_base(PhysicalAddress value) { m_architecture_page_table_base = value; }
 
     void set_kernel() { m_kernel = true; }
     bool is_kernel() const { return m_kernel; }
 
+    /// @brief Load this address space on the current processor.
+    ///
+    /// @warning This must be called with preemption disabled.
     void load();
 
+    /// @brief Whether the processor with id @p processor_id currently has this address space loaded.
+    bool is_active_on(u32 processor_id) const {
+        auto bit = 1_u64 << (processor_id % 64);
+        return (m_active_processors[processor_id / 64].load(di::MemoryOrder::SequentialConsistency) & bit) != 0;
+    }
+
+    /// @brief Whether any processor currently has this address space loaded.
+    bool is_active() const {
+        return di::any_of(m_active_processors, [](auto const& word) {
+            return word.load(di::MemoryOrder::SequentialConsistency) != 0;
+        });
+    }
+
+    /// @brief A counter which is incremented whenever translations in this address space are invalidated.
+    u64 tlb_generation() const { return m_tlb_generation.load(di::MemoryOrder::SequentialConsistency); }
+
     u64 resident_pages() const { return m_resident_pages.load(di::MemoryOrder::Relaxed); }
     u64 structure_pages() const { return m_structure_pages.load(di::MemoryOrder::Relaxed); }
 
+    /// @brief The number of page faults taken in this address space, including ones which could not be resolved.
+    u64 page_faults() const { return m_page_faults.load(di::MemoryOrder::Relaxed); }
+
+    /// @name Mapping counters
+    /// The number of page table entries which map a page of each supported size.
+    /// @{
+    u64 mapped_4kib_pages() const { return m_mapped_4kib_pages.load(di::MemoryOrder::Relaxed); }
+    u64 mapped_2mib_pages() const { return m_mapped_2mib_pages.load(di::MemoryOrder::Relaxed); }
+    u64 mapped_1gib_pages() const { return m_mapped_1gib_pages.load(di::MemoryOrder::Relaxed); }
+    /// @}
+
     Expected<VirtualAddress> allocate_region(di::Arc<BackingObject> backing_object, usize page_aligned_length,
                                              RegionFlags flags);
     Expected<void> allocate_region_at(di::Arc<BackingObject> backing_object, VirtualAddress location,
                                       usize page_aligned_length, RegionFlags flags);
 
+    /// @brief Resolve a page fault by mapping in the faulting page from its region's backing object.
+    ///
+    /// Regions in user address spaces are populated lazily, so the first access to each page faults. The page is
+    /// looked up in the region's backing object, and is either read in from its inode or freshly allocated if not
+    /// present. Writes to pages shared with a copy-on-write source are resolved by copying the page.
+    ///
+    /// @return An error if the fault is not caused by a missing or copy-on-write page in a region which allows the
+    /// access.
+    Expected<void> handle_page_fault(VirtualAddress address, PageFaultFlags flags);
+
+    /// @brief Resolve a fault as if it had been taken at @p address, without counting it as a page fault.
+    ///
+    /// This is used by the kernel to make sure a page is mapped with the given access before looking it up.
+    Expected<void> fault_in_page(VirtualAddress address, PageFaultFlags flags);
+
+    /// @brief Create a copy-on-write clone of this userspace address space.
+    ///
+    /// No memory is copied: both address spaces share the existing pages until one of them writes to a page, at which
+    /// point the page is copied. The new address space starts with no pages mapped, and faults them in on demand.
+    Expected<di::Arc<AddressSpace>> clone();
+
 private:
+    void mark_active(u32 processor_id) {
+        m_active_processors[processor_id / 64].fetch_or(1_u64 << (processor_id % 64),
+                                                        di::MemoryOrder::SequentialConsistency);
+    }
+    void mark_inactive(u32 processor_id) {
+        m_active_processors[processor_id / 64].fetch_and(~(1_u64 << (processor_id % 64)),
+                                                         di::MemoryOrder::SequentialConsistency);
+    }
+
     PhysicalAddress m_architecture_page_table_base { 0 };
+    di::Array<di::Atomic<u64>, max_processors / 64> m_active_processors {};
+    di::Atomic<u64> m_tlb_generation { 0 };
+    u64 m_id { 0 };
     di::Atomic<u64> m_resident_pages { 0 };
     di::Atomic<u64> m_structure_pages { 0 };
+    di::Atomic<u64> m_page_faults { 0 };
+    di::Atomic<u64> m_mapped_4kib_pages { 0 };
+    di::Atomic<u64> m_mapped_2mib_pages { 0 };
+    di::Atomic<u64> m_mapped_1gib_pages { 0 };
     bool m_kernel { false };
 };
 
@@ -2,21 +2,138 @@
 
 #include <di/container/intrusive/prelude.h>
 #include <di/sync/prelude.h>
-#include <iris/core/interruptible_spinlock.h>
+#include <di/vocab/optional/prelude.h>
+#include <di/vocab/span/prelude.h>
+#include <iris/core/error.h>
+#include <iris/core/mutex.h>
+#include <iris/mm/page_index.h>
 #include <iris/mm/physical_address.h>
 #include <iris/mm/physical_page.h>
 
+namespace iris {
+class Inode;
+}
+
 namespace iris::mm {
 class LockedBackingObject {
 public:
-    void add_page(mm::PhysicalAddress address, u64 page_offset);
+    LockedBackingObject() = default;
+
+    ~LockedBackingObject();
+
+    /// @brief Add the page at @p address to this object, which then owns a reference to it.
+    ///
+    /// @note On failure, the page is not added and still belongs to the caller.
+    Expected<void> add_page(mm::PhysicalAddress address, u64 page_offset);
+
+    /// @brief Add a page which another object already owns, so that both objects hold a reference to it.
+    ///
+    /// @note On failure, the page is not added.
+    Expected<void> add_shared_page(mm::PhysicalAddress address, u64 page_offset);
+
+    /// @brief Allocate a zero-filled page and add it to this object.
+    Expected<mm::PhysicalAddress> add_zeroed_page(u64 page_offset);
+
+    /// @brief Ensure adding pages in the range [@p first_page_offset, @p first_page_offset + @p count) cannot fail.
+    Expected<void> reserve_pages(u64 first_page_offset, u64 count) { return m_pages.reserve(first_page_offset, count); }
+
     di::Optional<mm::PhysicalAddress> lookup_page(u64 page_offset) const;
 
+    /// @brief Look up the run of consecutive present pages starting at @p first_page_offset.
+    ///
+    /// The lookup stops at the first missing page, or once @p pages is full.
+    ///
+    /// @return The number of pages written to @p pages.
+    usize lookup_pages(u64 first_page_offset, di::Span<mm::PhysicalAddress> pages) const;
+
+    /// @brief Whether any of the pages in the range [@p first_page_offset, @p first_page_offset + @p count) is present.
+    bool has_pages_in_range(u64 first_page_offset, u64 count) const;
+
+    /// @brief The index of the pages in this object, which also tracks which pages are dirty or were accessed.
+    PageIndex& pages() { return m_pages; }
+    PageIndex const& pages() const { return m_pages; }
+
 private:
-    di::IntrusiveTreeSet<BackedPhysicalPage, BackedPhysicalPageTreeTag> m_pages;
+    PageIndex m_pages;
 };
 
 class BackingObject
     : public di::IntrusiveRefCount<BackingObject>
-    , public di::Synchronized<LockedBackingObject, InterruptibleSpinlock> {};
+    , public di::Synchronized<LockedBackingObject, Mutex> {
+public:
+    BackingObject();
+    explicit BackingObject(di::Arc<BackingObject> copy_on_write_source);
+
+    ~BackingObject();
+
+    /// @brief The inode whose contents are cached by this object.
+    ///
+    /// Missing pages of a file-backed object are read in using `inode_read()`. Otherwise, the object is anonymous
+    /// memory, and missing pages are zero-filled.
+    di::Optional<Inode&> inode() const {
+        if (!m_inode) {
+            return di::nullopt;
+        }
+        return *m_inode;
+    }
+
+    void set_inode(Inode& inode) { m_inode = &inode; }
+
+    /// @brief Look up a page without acquiring the lock.
+    ///
+    /// Pages are never removed from a backing object while it is alive, and its page index supports lookups which run
+    /// concurrently with insertions. A page which is being added at the same time may or may not be found, so callers
+    /// must still take the lock before adding a missing page.
+    di::Optional<mm::PhysicalAddress> lookup_page_without_locking(u64 page_offset) const {
+        return get_const_assuming_no_concurrent_mutations().lookup_page(page_offset);
+    }
+
+    /// @brief Look up a run of consecutive pages without acquiring the lock.
+    ///
+    /// @see lookup_page_without_locking()
+    usize lookup_pages_without_locking(u64 first_page_offset, di::Span<mm::PhysicalAddress> pages) const {
+        return get_const_assuming_no_concurrent_mutations().lookup_pages(first_page_offset, pages);
+    }
+
+    /// @brief The object which this object is a private copy of.
+    ///
+    /// Pages not present in a copy-on-write object are looked up in its source, and are shared until the first write,
+    /// at which point the page is copied into this object. The source object must never be written to directly once
+    /// it has been copied.
+    di::Optional<BackingObject&> copy_on_write_source() const {
+        if (!m_copy_on_write_source) {
+            return di::nullopt;
+        }
+        return *m_copy_on_write_source;
+    }
+
+    /// @brief Whether this object is the only user of its copy-on-write source.
+    ///
+    /// Anonymous sources are only reachable through the objects which were created from them, so in this case no other
+    /// address space can observe the source's pages, and they can be modified in place. File-backed sources are shared
+    /// with the file itself, and so never qualify.
+    bool is_sole_copy_on_write_user() const {
+        return m_copy_on_write_source && !m_copy_on_write_source->inode() &&
+               m_copy_on_write_source->m_copy_on_write_users.load(di::MemoryOrder::Acquire) == 1;
+    }
+
+    /// @brief Shorten the chain of copy-on-write sources, by merging in sources which only this object uses.
+    ///
+    /// Every clone of an address space adds another level of copy-on-write objects, so without this the chains (and
+    /// so page lookups) would grow with every generation of processes.
+    ///
+    /// @warning The caller must ensure that no page lookups walk this object's chain concurrently.
+    Expected<void> collapse_copy_on_write_chain();
+
+private:
+    Inode* m_inode { nullptr };
+    di::Arc<BackingObject> m_copy_on_write_source;
+
+    // The number of objects which use this object as their copy-on-write source.
+    di::Atomic<usize> m_copy_on_write_users { 0 };
+
+    // When the source is file-backed, its inode must stay alive as long as this object does. Inodes do not hold a
+    // reference to their own backing object, so this does not create a cycle.
+    di::Arc<Inode> m_source_inode;
+};
 }
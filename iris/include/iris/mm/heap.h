@@ -0,0 +1,81 @@
+#pragma once
+
+#include <di/sync/prelude.h>
+#include <di/types/prelude.h>
+#include <di/vocab/array/prelude.h>
+#include <iris/mm/physical_page.h>
+
+namespace iris::mm {
+/// @brief Object sizes served by the kernel heap's slab allocator.
+///
+/// Allocations larger than the biggest size class (or with alignment which cannot be satisfied by any size class) are
+/// served directly by the page frame allocator.
+constexpr inline auto heap_size_classes = di::Array { 16zu,  32zu,  48zu,  64zu,  96zu,   128zu,  192zu,
+                                                      256zu, 384zu, 512zu, 768zu, 1024zu, 1536zu, 2048zu };
+
+constexpr inline auto heap_size_class_count = heap_size_classes.size();
+
+/// @brief The number of free objects each processor caches per size class.
+constexpr inline auto heap_magazine_capacity = 32zu;
+
+/// @brief Global pool of slabs for a single size class.
+///
+/// Only slabs with at least one free object are kept in the partial slab list. Completely full slabs are not tracked,
+/// and are re-added to the list once an object is freed back into them.
+struct SlabDepot {
+    di::IntrusiveList<SlabPhysicalPage> partial_slabs;
+    usize empty_slab_count { 0 };
+    usize slab_page_count { 0 };
+};
+
+/// @brief Per-processor cache of free heap objects.
+///
+/// Each processor owns one of these, which allows the common allocation and deallocation paths to avoid taking any
+/// global locks. Objects are moved between the magazines and the global slab depots in batches.
+///
+/// @warning All members must be accessed with interrupts disabled on the owning processor.
+class HeapCache {
+public:
+    HeapCache() = default;
+
+    void* allocate(usize size_class_index);
+    void deallocate(void* object, usize size_class_index);
+
+    /// @brief Number of live objects allocated minus deallocated by this processor.
+    ///
+    /// This value can be negative, since objects are often freed on a different processor than they were allocated on.
+    /// The sum across all processors is the number of live objects of a particular size class.
+    i64 allocated_objects(usize size_class_index) const {
+        return m_allocated_objects[size_class_index].load(di::MemoryOrder::Relaxed);
+    }
+
+private:
+    struct Magazine {
+        di::Array<void*, heap_magazine_capacity> objects {};
+        usize count { 0 };
+    };
+
+    void account(usize size_class_index, i64 delta) {
+        auto& counter = m_allocated_objects[size_class_index];
+        counter.store(counter.load(di::MemoryOrder::Relaxed) + delta, di::MemoryOrder::Relaxed);
+    }
+
+    di::Array<Magazine, heap_size_class_count> m_magazines {};
+    di::Array<di::Atomic<i64>, heap_size_class_count> m_allocated_objects {};
+};
+
+struct HeapSizeClassStatistics {
+    usize object_size { 0 };
+    usize allocated_objects { 0 };
+    usize slab_pages { 0 };
+};
+
+struct HeapStatistics {
+    di::Array<HeapSizeClassStatistics, heap_size_class_count> size_classes {};
+    usize large_allocations { 0 };
+    usize large_allocation_pages { 0 };
+};
+
+/// @brief Take a snapshot of the kernel heap usage counters.
+HeapStatistics heap_statistics();
+}
@@ -11,6 +11,9 @@ struct PhysicalAddressMapping;
 
 Expected<PhysicalAddressMapping> map_physical_address(PhysicalAddress, usize byte_size);
 
+/// @brief Get the physical address of a pointer which was obtained through `map_physical_address()`.
+PhysicalAddress physical_address_of_mapping(void const* pointer);
+
 struct PhysicalAddressMapping {
 public:
     explicit PhysicalAddressMapping(di::Span<di::Byte> data) : m_data(data) {}
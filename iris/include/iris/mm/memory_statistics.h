@@ -0,0 +1,69 @@
+#pragma once
+
+#include <di/sync/prelude.h>
+#include <di/types/prelude.h>
+#include <di/vocab/array/prelude.h>
+
+namespace iris::mm {
+/// @brief Memory management events which are counted by every processor.
+enum class MemoryEvent : u32 {
+    PageFault,
+    LargePageFault,
+    CopyOnWriteFault,
+    /// A copy-on-write fault which took over the shared page instead of copying it.
+    CopyOnWriteReuse,
+    ZeroedPagePoolHit,
+    ZeroedPagePoolMiss,
+    Count,
+};
+
+constexpr inline auto memory_event_count = usize(MemoryEvent::Count);
+
+/// @brief Per-processor counters of memory management events.
+///
+/// Each processor only ever increments its own counters, so this is a plain load and store, without any locked
+/// instructions or shared cache lines. Other processors only read the counters, to compute the system-wide totals.
+///
+/// @warning Counters must be incremented with interrupts disabled on the owning processor.
+class MemoryCounters {
+public:
+    MemoryCounters() = default;
+
+    void increment(MemoryEvent event) {
+        auto& counter = m_counts[usize(event)];
+        counter.store(counter.load(di::MemoryOrder::Relaxed) + 1, di::MemoryOrder::Relaxed);
+    }
+
+    u64 count(MemoryEvent event) const { return m_counts[usize(event)].load(di::MemoryOrder::Relaxed); }
+
+private:
+    di::Array<di::Atomic<u64>, memory_event_count> m_counts {};
+};
+
+/// @brief Count a memory management event on the current processor.
+void count_memory_event(MemoryEvent event);
+
+struct PhysicalMemoryStatistics {
+    /// The number of page frames managed by the page frame allocator.
+    usize total_pages { 0 };
+    /// Free page frames held by the buddy allocator.
+    usize free_pages { 0 };
+    /// Free page frames held in per-processor caches.
+    usize cached_pages { 0 };
+    /// Free page frames which were zeroed ahead of time.
+    usize zeroed_pages { 0 };
+
+    usize available_pages() const { return free_pages + cached_pages + zeroed_pages; }
+    usize used_pages() const { return total_pages - available_pages(); }
+};
+
+struct MemoryStatistics {
+    PhysicalMemoryStatistics physical {};
+    di::Array<u64, memory_event_count> events {};
+
+    u64 event_count(MemoryEvent event) const { return events[usize(event)]; }
+};
+
+/// @brief Take a snapshot of the physical memory usage and memory event counters.
+MemoryStatistics memory_statistics();
+}
@@ -1,12 +1,99 @@
 #pragma once
 
+#include <di/sync/prelude.h>
+#include <di/types/prelude.h>
+#include <di/vocab/array/prelude.h>
+#include <di/vocab/optional/prelude.h>
 #include <iris/core/error.h>
+#include <iris/core/lock_statistics.h>
+#include <iris/mm/memory_statistics.h>
 #include <iris/mm/physical_address.h>
 
 namespace iris::mm {
+/// @brief The number of free page frames each processor caches.
+constexpr inline auto page_frame_cache_capacity = 64zu;
+
+/// @brief The maximum number of pre-zeroed pages each processor keeps around for `allocate_page_frame()`.
+constexpr inline auto zeroed_page_pool_capacity = 64zu;
+
+/// @brief Per-processor cache of free page frames.
+///
+/// Single page allocations and deallocations are served from this cache, which is refilled from and drained to the
+/// global buddy allocator in batches. This avoids taking the global lock for most page frame allocations.
+///
+/// The cache also holds a pool of pages which were zeroed ahead of time by the processor's idle task, and which are
+/// handed out before any other page.
+///
+/// @warning All members must be accessed with interrupts disabled on the owning processor.
+class PageFrameCache {
+public:
+    PageFrameCache() = default;
+
+    di::Optional<PhysicalAddress> allocate();
+    void deallocate(PhysicalAddress address);
+
+    /// @brief Take a page from the pool of pre-zeroed pages, if it is not empty.
+    di::Optional<PhysicalAddress> allocate_zeroed();
+
+    /// @brief Add a page which has already been zeroed to the pool.
+    ///
+    /// @return False if the pool is full, in which case the page still belongs to the caller.
+    bool add_zeroed(PhysicalAddress address);
+
+    /// @brief Return every cached page frame, including pre-zeroed pages, to the buddy allocator.
+    void drain();
+
+    /// @brief The number of free page frames currently held by this cache, excluding pre-zeroed pages.
+    ///
+    /// This can safely be read from any processor, although the value may be stale.
+    usize count() const { return m_count.load(di::MemoryOrder::Relaxed); }
+
+    /// @brief The number of pre-zeroed pages currently held by this cache.
+    ///
+    /// This can safely be read from any processor, although the value may be stale.
+    usize zeroed_count() const { return m_zeroed_count.load(di::MemoryOrder::Relaxed); }
+
+private:
+    di::Array<u64, page_frame_cache_capacity> m_page_numbers {};
+    di::Array<u64, zeroed_page_pool_capacity> m_zeroed_page_numbers {};
+    di::Atomic<usize> m_count { 0 };
+    di::Atomic<usize> m_zeroed_count { 0 };
+};
+
+/// @brief Returns the number of bytes the page frame allocator needs to track @p max_physical_address bytes of memory.
+usize page_frame_allocator_metadata_size(PhysicalAddress max_physical_address);
+
+/// @brief Initialize the page frame allocator.
+///
+/// @param max_physical_address The end of physical memory.
+/// @param metadata_base The start of a usable memory range of at least `page_frame_allocator_metadata_size()` bytes,
+/// which the allocator will use to track every physical page.
+///
+/// @note Initially every page frame is reserved. Usable memory must be released with `unreserve_page_frames()`.
+void init_page_frame_allocator(PhysicalAddress max_physical_address, PhysicalAddress metadata_base);
+
 void reserve_page_frames(PhysicalAddress base_address, usize page_count);
 void unreserve_page_frames(PhysicalAddress base_address, usize page_count);
+/// @brief Allocate a single zero-filled page frame.
+///
+/// Pages are taken from the current processor's pool of pages zeroed ahead of time when possible, which avoids having
+/// to zero the page here.
 Expected<PhysicalAddress> allocate_page_frame();
 Expected<PhysicalAddress> allocate_physically_contiguous_page_frames(usize page_count);
 void deallocate_page_frame(PhysicalAddress);
+
+/// @brief Zero a single page and add it to the current processor's pool of pre-zeroed pages.
+///
+/// This is called by idle processors, and must be called with interrupts enabled.
+///
+/// @return Whether a page was added, meaning the pool may still need more pages.
+bool refill_zeroed_page_pool();
+
+/// @brief Take a snapshot of how many page frames are in use, and where the free page frames are held.
+PhysicalMemoryStatistics physical_memory_statistics();
+
+#ifdef IRIS_LOCK_STATISTICS
+/// @brief Contention counters for the lock which protects the global buddy allocator.
+LockStatistics const& page_frame_allocator_lock_statistics();
+#endif
 }
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <di/function/prelude.h>
+#include <di/math/prelude.h>
+#include <di/sync/prelude.h>
+#include <di/vocab/array/prelude.h>
+#include <di/vocab/optional/prelude.h>
+#include <di/vocab/span/prelude.h>
+#include <iris/core/error.h>
+#include <iris/mm/physical_address.h>
+
+namespace iris::mm {
+/// @brief A mark which can be attached to the pages of a page index.
+enum class PageTag : u8 {
+    Dirty,
+    Accessed,
+};
+
+constexpr inline auto page_tag_count = 2zu;
+
+namespace detail {
+    struct PageIndexNode;
+}
+
+/// @brief A radix tree which maps page offsets to physical pages.
+///
+/// Each node has 64 slots, and so consumes 6 bits of the page offset. The tree only has as many levels as are needed
+/// to hold the largest offset inserted so far, so small objects are a single node deep. Every node also keeps a bitmap
+/// of its occupied slots and of the slots which contain a tagged page, which makes range iteration and searching for
+/// tagged pages skip over empty parts of the tree.
+///
+/// Modifications must be serialized by the owner, but lookups may run concurrently with them without any locking. This
+/// works because entries are never removed, and nodes are only freed once the whole index is destroyed.
+class PageIndex {
+public:
+    constexpr static auto bits_per_level = 6zu;
+    constexpr static auto slots_per_node = 64zu;
+
+    PageIndex() = default;
+
+    PageIndex(PageIndex const&) = delete;
+    PageIndex& operator=(PageIndex const&) = delete;
+
+    ~PageIndex();
+
+    di::Optional<PhysicalAddress> lookup(u64 index) const;
+
+    /// @brief Look up the run of consecutive present pages starting at @p first_index.
+    ///
+    /// @return The number of pages written to @p pages.
+    usize lookup_range(u64 first_index, di::Span<PhysicalAddress> pages) const;
+
+    /// @brief Find the first present page whose index is at least @p index.
+    di::Optional<u64> find_next(u64 index) const;
+
+    /// @brief Find the first page tagged with @p tag whose index is at least @p index.
+    di::Optional<u64> find_next_tagged(u64 index, PageTag tag) const;
+
+    /// @brief Call @p function with the index and address of every present page in [@p first_index, @p last_index).
+    template<di::concepts::InvocableTo<void, u64, PhysicalAddress> Function>
+    void for_each_in_range(u64 first_index, u64 last_index, Function&& function) const {
+        for (auto index = find_next(first_index); index && *index < last_index; index = find_next(*index + 1)) {
+            function(*index, *lookup(*index));
+            if (*index == di::NumericLimits<u64>::max) {
+                break;
+            }
+        }
+    }
+
+    /// @brief Add a page at @p index, which must not already be present.
+    ///
+    /// This only fails if memory for the tree nodes cannot be allocated, which cannot happen when the range containing
+    /// @p index was previously passed to `reserve()`.
+    Expected<void> insert(u64 index, PhysicalAddress address);
+
+    /// @brief Allocate the tree nodes needed to insert pages in [@p first_index, @p first_index + @p count).
+    Expected<void> reserve(u64 first_index, u64 count);
+
+    /// @brief Tag the page at @p index, which must be present.
+    void set_tag(u64 index, PageTag tag);
+    void clear_tag(u64 index, PageTag tag);
+    bool has_tag(u64 index, PageTag tag) const;
+
+    usize size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+private:
+    Expected<detail::PageIndexNode*> leaf_for_insertion(u64 index);
+    detail::PageIndexNode const* leaf(u64 index) const;
+
+    di::Atomic<detail::PageIndexNode*> m_root { nullptr };
+    usize m_size { 0 };
+};
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <iris/mm/physical_address.h>
+
+namespace iris::mm {
+/// @brief Select the fastest page clearing and copying routines supported by the processor.
+///
+/// Until this is called, generic routines which work on every processor are used.
+void init_page_operations();
+
+/// @brief Fill a page of physical memory with zeroes.
+void clear_page(PhysicalAddress page);
+
+/// @brief Fill a page of physical memory with zeroes, bypassing the processor's caches.
+///
+/// This avoids evicting useful data from the cache, at the cost of making the next access to the page slower. It should
+/// be used for pages which will not be accessed soon, such as those zeroed ahead of time.
+void clear_page_non_temporal(PhysicalAddress page);
+
+/// @brief Copy the contents of the physical page at @p source to @p destination.
+void copy_page(PhysicalAddress destination, PhysicalAddress source);
+}
@@ -26,8 +26,26 @@ struct PageStructurePhysicalPage : di::IntrusiveListNode<> {
         di::IntrusiveList<PageStructurePhysicalPage> children;
         u64 mapped_page_count;
     };
+
+    /// @brief The number of entries in a parent table which directly map a large page, instead of a child table.
+    u16 large_page_count { 0 };
+};
+
+/// @brief A physical page of memory used as a slab by the kernel heap.
+struct SlabPhysicalPage : di::IntrusiveListNode<> {
+    constexpr explicit SlabPhysicalPage(u16 size_class_index) : size_class_index(size_class_index) {}
+
+    void* free_list { nullptr };
+    u16 used_count { 0 };
+    u16 size_class_index { 0 };
+    bool in_partial_list { false };
 };
 
+/// @brief A physical page of memory which has been unmapped, but may still be reachable through stale translations.
+///
+/// The page is only returned to the page frame allocator once every processor has invalidated its translations.
+struct UnmappedPhysicalPage : di::IntrusiveListNode<> {};
+
 struct BackedPhysicalPage;
 
 struct BackedPhysicalPagePtrTag {
@@ -38,27 +56,11 @@ private:
                            BackedPhysicalPage* ptr);
 };
 
-struct BackedPhysicalPageTreeTag : di::container::IntrusiveTagBase<BackedPhysicalPage> {
-    static void did_remove(auto&, auto& node);
-};
-
 /// @brief A physical page of memory tracked by a backing object.
-struct BackedPhysicalPage : di::IntrusiveTreeSetNode<BackedPhysicalPageTreeTag> {
-    constexpr explicit BackedPhysicalPage(u64 page_number) : page_number(page_number) {}
-
+///
+/// The backing object's page index records where the page lives, so only the reference count is stored here.
+struct BackedPhysicalPage {
     di::sync::Atomic<usize> reference_count { 1 };
-    u64 page_number;
-
-private:
-    constexpr friend bool operator==(BackedPhysicalPage const& a, BackedPhysicalPage const& b) {
-        return a.page_number == b.page_number;
-    }
-    constexpr friend di::strong_ordering operator<=>(BackedPhysicalPage const& a, BackedPhysicalPage const& b) {
-        return a.page_number <=> b.page_number;
-    }
-
-    constexpr friend bool operator==(BackedPhysicalPage const& a, u64 b) { return a.page_number == b; }
-    constexpr friend di::strong_ordering operator<=>(BackedPhysicalPage const& a, u64 b) { return a.page_number <=> b; }
 };
 
 /// @brief A physical page of memory.
@@ -70,6 +72,8 @@ struct PhysicalPage {
     union {
         PageStructurePhysicalPage as_page_structure_page;
         BackedPhysicalPage as_backed_page;
+        SlabPhysicalPage as_slab_page;
+        UnmappedPhysicalPage as_unmapped_page;
     };
 };
 
@@ -90,6 +94,14 @@ namespace detail {
             return void_pointer_to_physical_address(&page);
         }
 
+        inline PhysicalAddress operator()(SlabPhysicalPage const& page) const {
+            return void_pointer_to_physical_address(&page);
+        }
+
+        inline PhysicalAddress operator()(UnmappedPhysicalPage const& page) const {
+            return void_pointer_to_physical_address(&page);
+        }
+
     private:
         static inline PhysicalAddress void_pointer_to_physical_address(void const* pointer) {
             auto page_number = (VirtualAddress(di::to_uintptr(pointer)) - physical_page_base) / sizeof(PhysicalPage);
@@ -114,6 +126,10 @@ inline BackedPhysicalPage& backed_page(PhysicalAddress address) {
     return physical_page(address).as_backed_page;
 }
 
+inline SlabPhysicalPage& slab_page(PhysicalAddress address) {
+    return physical_page(address).as_slab_page;
+}
+
 namespace detail {
     struct BumpPage {
         inline void operator()(BackedPhysicalPage& page) const {
@@ -147,8 +163,4 @@ namespace detail {
 }
 
 constexpr inline auto drop_page = iris::mm::detail::DropPageFunction {};
-
-void BackedPhysicalPageTreeTag::did_remove(auto&, auto& node) {
-    drop_page(node);
-}
 }
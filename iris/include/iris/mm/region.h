@@ -1,6 +1,7 @@
 #pragma once
 
 #include <di/assert/prelude.h>
+#include <di/container/algorithm/prelude.h>
 #include <di/container/intrusive/prelude.h>
 #include <iris/mm/backing_object.h>
 #include <iris/mm/virtual_address.h>
@@ -19,6 +20,12 @@ DI_DEFINE_ENUM_BITWISE_OPERATIONS(RegionFlags)
 class Region;
 
 struct AddressSpaceRegionListTag : di::container::IntrusiveTagBase<Region> {
+    template<typename T>
+    constexpr static bool is_augmented(di::InPlaceType<T>) {
+        return true;
+    }
+
+    constexpr static void update_augmented_data(Region& node);
     constexpr static void did_remove(auto&, auto& node);
 };
 
@@ -47,6 +54,10 @@ public:
     }
     constexpr void set_end(VirtualAddress end) { m_length = end - m_base; }
 
+    /// @brief The page of the backing object which is mapped at the start of this region.
+    constexpr u64 backing_object_page_offset() const { return m_backing_object_page_offset; }
+    constexpr void set_backing_object_page_offset(u64 page_offset) { m_backing_object_page_offset = page_offset; }
+
     constexpr RegionFlags flags() const { return m_flags; }
     constexpr BackingObject& backing_object() const { return *m_backing_object; }
 
@@ -57,6 +68,38 @@ public:
 
     constexpr bool contains(VirtualAddress b) const { return b >= base() && b < end(); }
 
+    /// @brief The lowest address covered by any region in this region's subtree of the address space's region tree.
+    constexpr VirtualAddress subtree_base() const { return m_subtree_base; }
+
+    /// @brief The highest end address of any region in this region's subtree of the address space's region tree.
+    constexpr VirtualAddress subtree_end() const { return m_subtree_end; }
+
+    /// @brief The size of the largest unmapped gap between two adjacent regions in this region's subtree.
+    ///
+    /// This lets the address space skip entire subtrees when searching for a free range, so that the search takes
+    /// O(log n) time.
+    constexpr usize subtree_max_gap() const { return m_subtree_max_gap; }
+
+    constexpr Region* left_child() const { return static_cast<Region*>(left); }
+    constexpr Region* right_child() const { return static_cast<Region*>(right); }
+    constexpr Region* parent_region() const { return static_cast<Region*>(parent); }
+
+    constexpr void update_subtree_data() {
+        m_subtree_base = base();
+        m_subtree_end = end();
+        m_subtree_max_gap = 0;
+        if (auto* child = left_child()) {
+            m_subtree_base = child->subtree_base();
+            auto gap = usize(base() - child->subtree_end());
+            m_subtree_max_gap = di::max(di::max(m_subtree_max_gap, child->subtree_max_gap()), gap);
+        }
+        if (auto* child = right_child()) {
+            m_subtree_end = child->subtree_end();
+            auto gap = usize(child->subtree_base() - end());
+            m_subtree_max_gap = di::max(di::max(m_subtree_max_gap, child->subtree_max_gap()), gap);
+        }
+    }
+
     constexpr di::strong_ordering compare_with_address(VirtualAddress b) const {
         if (contains(b)) {
             return di::strong_ordering::equal;
@@ -86,9 +129,17 @@ private:
     VirtualAddress m_base;
     usize m_length { 0 };
     di::Arc<BackingObject> m_backing_object;
+    u64 m_backing_object_page_offset { 0 };
     RegionFlags m_flags {};
+    VirtualAddress m_subtree_base;
+    VirtualAddress m_subtree_end;
+    usize m_subtree_max_gap { 0 };
 };
 
+constexpr void AddressSpaceRegionListTag::update_augmented_data(Region& node) {
+    node.update_subtree_data();
+}
+
 constexpr void AddressSpaceRegionListTag::did_remove(auto&, auto& node) {
     auto to_drop = di::Box<Region>(di::addressof(node));
 }
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <di/types/prelude.h>
+#include <di/vocab/array/prelude.h>
+#include <di/vocab/span/prelude.h>
+#include <iris/mm/virtual_address.h>
+
+namespace iris::mm {
+struct TlbFlushRange {
+    VirtualAddress base;
+    usize page_count { 0 };
+};
+
+/// @brief A set of virtual address ranges whose cached translations must be invalidated.
+///
+/// Page table updates add the ranges they modify to a batch, which is then invalidated on every affected processor
+/// with a single IPI. Once the batch covers too many ranges or pages, it degrades to a full TLB flush, which is cheaper
+/// than invalidating each page individually.
+class TlbFlushBatch {
+public:
+    constexpr static auto max_ranges = 8zu;
+    constexpr static auto max_pages = 64zu;
+
+    TlbFlushBatch() = default;
+
+    void add(VirtualAddress base, usize byte_length);
+    void add_everything();
+    void clear();
+
+    /// @brief Mark the batch as invalidating kernel mappings, which are shared by every address space.
+    void set_kernel() { m_kernel = true; }
+    bool kernel() const { return m_kernel; }
+
+    bool empty() const { return !m_flush_everything && m_range_count == 0; }
+    bool flush_everything() const { return m_flush_everything; }
+    di::Span<TlbFlushRange const> ranges() const { return { m_ranges.data(), m_range_count }; }
+
+private:
+    di::Array<TlbFlushRange, max_ranges> m_ranges {};
+    usize m_range_count { 0 };
+    usize m_page_count { 0 };
+    bool m_flush_everything { false };
+    bool m_kernel { false };
+};
+}
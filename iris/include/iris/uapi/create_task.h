@@ -0,0 +1,14 @@
+#pragma once
+
+#include <di/types/prelude.h>
+#include <di/util/bitwise_enum.h>
+
+namespace iris {
+enum class CreateTaskFlags : u32 {
+    None = 0,
+    CopyAddressSpace = (1 << 0),
+    Mask = CopyAddressSpace,
+};
+
+DI_DEFINE_ENUM_BITWISE_OPERATIONS(CreateTaskFlags)
+}
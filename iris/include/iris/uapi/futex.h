@@ -0,0 +1,8 @@
+#pragma once
+
+#include <di/types/prelude.h>
+
+namespace iris {
+/// @brief Timeout for the futex_wait system call which waits until the task is woken up.
+constexpr inline i64 futex_wait_forever = -1;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <di/types/prelude.h>
+
+namespace iris {
+/// @brief A buffer passed to the readv and writev system calls, with the same layout as POSIX's `struct iovec`.
+struct IoVector {
+    void* base;
+    usize length;
+};
+
+/// @brief The maximum number of buffers accepted by a single readv or writev system call.
+constexpr inline usize io_vector_max_count = 16;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <di/types/prelude.h>
+#include <di/util/bitwise_enum.h>
+
+namespace iris {
+enum class MapFileFlags : u32 {
+    /// Map the file read-only, sharing its pages directly.
+    None = 0,
+    /// Map a writable, private copy of the file. Pages are copied on the first write, and changes are never written
+    /// back to the file.
+    Private = (1 << 0),
+    Mask = Private,
+};
+
+DI_DEFINE_ENUM_BITWISE_OPERATIONS(MapFileFlags)
+}
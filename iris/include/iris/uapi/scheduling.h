@@ -0,0 +1,17 @@
+#pragma once
+
+#include <di/types/prelude.h>
+
+namespace iris {
+enum class SchedulingClass : u32 {
+    /// Tasks share processor time in proportion to their weight, which is derived from their nice value.
+    Fair = 0,
+    /// Tasks run in first-in first-out order ahead of every fair task, and are never preempted by the scheduler tick.
+    /// Only kernel tasks can use this class.
+    RealTimeFifo = 1,
+    Max = RealTimeFifo,
+};
+
+constexpr inline auto min_nice_value = -20;
+constexpr inline auto max_nice_value = 19;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <di/types/prelude.h>
+
+namespace iris {
+enum class StatisticsKind : u32 {
+    Heap = 0,
+    Memory = 1,
+    Tasks = 2,
+    /// Contention counters for the kernel's busiest locks. These are only collected when the kernel is built with
+    /// IRIS_LOCK_STATISTICS.
+    Locks = 3,
+    Max = Locks,
+};
+}
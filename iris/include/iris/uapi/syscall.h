@@ -24,5 +24,17 @@ enum class SystemCall {
     read_directory = 19,
     truncate = 20,
     create_node = 21,
+    open_statistics = 22,
+    map_file = 23,
+    set_scheduling_class = 24,
+    monotonic_time = 25,
+    sleep_for = 26,
+    sleep_until = 27,
+    futex_wait = 28,
+    futex_wake = 29,
+    pread = 30,
+    pwrite = 31,
+    readv = 32,
+    writev = 33,
 };
 }
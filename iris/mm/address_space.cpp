@@ -1,25 +1,321 @@
+#include <di/execution/algorithm/sync_wait.h>
 #include <di/math/prelude.h>
 #include <iris/core/global_state.h>
 #include <iris/core/print.h>
+#include <iris/fs/inode.h>
 #include <iris/mm/address_space.h>
 #include <iris/mm/backing_object.h>
-#include <iris/mm/map_physical_address.h>
+#include <iris/mm/memory_statistics.h>
 #include <iris/mm/page_frame_allocator.h>
+#include <iris/mm/page_operations.h>
 #include <iris/mm/physical_address.h>
 #include <iris/mm/physical_page.h>
 #include <iris/mm/sections.h>
 
 namespace iris::mm {
+static auto next_address_space_id = di::Atomic<u64> { 1 };
+
+AddressSpace::AddressSpace() : m_id(next_address_space_id.fetch_add(1, di::MemoryOrder::Relaxed)) {}
+
 AddressSpace& LockedAddressSpace::base() {
     return static_cast<AddressSpace&>(
-        reinterpret_cast<di::Synchronized<LockedAddressSpace, InterruptibleSpinlock>&>(*this));
+        reinterpret_cast<di::Synchronized<LockedAddressSpace, Mutex>&>(*this));
+}
+
+// Kernel regions are populated immediately, since the kernel cannot tolerate faults in most contexts (for example, when
+// touching its own stack). Userspace regions are instead populated on demand by the page fault handler.
+Expected<void> LockedAddressSpace::populate_kernel_region(Region& region) {
+    if (!base().m_kernel) {
+        return {};
+    }
+
+    auto guard = region.backing_object().lock();
+    for (auto [page_number, virtual_address] : di::enumerate(region.each_page())) {
+        auto page_frame = TRY(guard->add_zeroed_page(page_number));
+        TRY(map_physical_page(virtual_address, page_frame, region.flags()));
+    }
+    return {};
+}
+
+struct ResolvedPage {
+    // Not set if the page must first be read in from `read`'s inode.
+    di::Optional<PhysicalAddress> page;
+
+    // Set if the page belongs to a copy-on-write source object, and so must not be written to.
+    bool shared { false };
+
+    di::Optional<PendingPageRead> read;
+};
+
+static Expected<ResolvedPage> lookup_page(BackingObject& backing_object, u64 page_number) {
+    // Walk the chain of copy-on-write sources, until an object which has the page (or is backed by an inode) is found.
+    for (auto object = di::Optional<BackingObject&>(backing_object); object; object = object->copy_on_write_source()) {
+        auto shared = &*object != &backing_object;
+        if (auto page = object->lookup_page_without_locking(page_number)) {
+            return ResolvedPage { *page, shared };
+        }
+        if (auto inode = object->inode()) {
+            return ResolvedPage { di::nullopt, shared, PendingPageRead { inode->arc_from_this(), page_number } };
+        }
+    }
+
+    // Anonymous memory is zero-filled. Hold the lock while allocating, so that concurrent faults on the same page
+    // cannot both add a page.
+    return backing_object.with_lock([&](LockedBackingObject& object) -> Expected<ResolvedPage> {
+        if (auto page = object.lookup_page(page_number)) {
+            return ResolvedPage { *page };
+        }
+        auto page = TRY(object.add_zeroed_page(page_number));
+        return ResolvedPage { page };
+    });
+}
+
+// Whether the shared page @p source can be written in place, because nothing besides @p backing_object's own source (and
+// the faulting address space, if @p mapped is set) can observe it.
+static bool is_sole_owner(BackingObject& backing_object, u64 page_number, PhysicalAddress source, bool mapped) {
+    if (!backing_object.is_sole_copy_on_write_user() ||
+        backing_object.copy_on_write_source()->lookup_page_without_locking(page_number) != source) {
+        return false;
+    }
+    auto expected_references = mapped ? 2_usize : 1_usize;
+    return backed_page(source).reference_count.load(di::MemoryOrder::Acquire) == expected_references;
+}
+
+static Expected<PhysicalAddress> copy_shared_page(BackingObject& backing_object, u64 page_number,
+                                                  PhysicalAddress source, bool mapped) {
+    return backing_object.with_lock([&](LockedBackingObject& object) -> Expected<PhysicalAddress> {
+        if (auto page = object.lookup_page(page_number)) {
+            return *page;
+        }
+
+        // When the other side of the copy-on-write sharing has already gone away, the page is taken over instead of
+        // being copied.
+        if (is_sole_owner(backing_object, page_number, source, mapped)) {
+            TRY(object.add_shared_page(source, page_number));
+            count_memory_event(MemoryEvent::CopyOnWriteReuse);
+            return source;
+        }
+
+        auto page = TRY(allocate_page_frame());
+        copy_page(page, source);
+        count_memory_event(MemoryEvent::CopyOnWriteFault);
+
+        if (auto result = object.add_page(page, page_number); !result) {
+            deallocate_page_frame(page);
+            return di::Unexpected(di::move(result).error());
+        }
+        return page;
+    });
+}
+
+// Anonymous memory is mapped using large pages when the faulting address lies in a large page sized chunk which is
+// entirely covered by the region and has not been touched yet. This greatly reduces both the number of faults and TLB
+// misses for large allocations. Returns false if the fault must instead be resolved one page at a time.
+Expected<bool> LockedAddressSpace::try_map_large_page(Region& region, VirtualAddress address) {
+    auto large_page_address = VirtualAddress(di::align_down(address.raw_value(), large_page_size));
+    if (large_page_address < region.base() || large_page_address + large_page_size > region.end()) {
+        return false;
+    }
+
+    auto& backing_object = region.backing_object();
+    if (backing_object.inode() || backing_object.copy_on_write_source()) {
+        return false;
+    }
+
+    if (!is_large_page_unmapped(large_page_address)) {
+        return false;
+    }
+
+    auto constexpr page_count = large_page_size / 4096;
+    auto first_page_number = region.backing_object_page_offset() + (large_page_address - region.base()) / 4096;
+    return backing_object.with_lock([&](LockedBackingObject& object) -> Expected<bool> {
+        if (object.has_pages_in_range(first_page_number, page_count)) {
+            return false;
+        }
+
+        // Allocate the page index nodes up front, so that adding the pages below cannot fail part of the way through.
+        TRY(object.reserve_pages(first_page_number, page_count));
+
+        // Physically contiguous memory may be unavailable when memory is fragmented, in which case falling back to
+        // individual pages is always possible.
+        auto physical_address = allocate_physically_contiguous_page_frames(page_count);
+        if (!physical_address) {
+            return false;
+        }
+
+        for (auto i : di::range(page_count)) {
+            clear_page(*physical_address + i * 4096);
+            *object.add_page(*physical_address + i * 4096, first_page_number + i);
+        }
+        TRY(map_physical_large_page(large_page_address, *physical_address, region.flags()));
+        count_memory_event(MemoryEvent::LargePageFault);
+        return true;
+    });
+}
+
+Expected<di::Optional<PendingPageRead>> LockedAddressSpace::try_handle_page_fault(VirtualAddress address,
+                                                                                  PageFaultFlags flags) {
+    auto region = m_regions.find(address);
+    if (region == m_regions.end()) {
+        return di::Unexpected(Error::BadAddress);
+    }
+
+    auto const write = !!(flags & PageFaultFlags::Write);
+    if ((write && !region->writable()) ||
+        (!!(flags & PageFaultFlags::InstructionFetch) && !region->executable()) ||
+        (!!(flags & PageFaultFlags::User) && !region->user())) {
+        return di::Unexpected(Error::BadAddress);
+    }
+
+    // Faults on present pages are protection violations, which can only be fixed by breaking copy-on-write sharing.
+    if (!!(flags & PageFaultFlags::Present) && !write) {
+        return di::Unexpected(Error::BadAddress);
+    }
+
+    if (!(flags & PageFaultFlags::Present) && TRY(try_map_large_page(*region, address))) {
+        return di::nullopt;
+    }
+
+    auto page_address = VirtualAddress(di::align_down(address.raw_value(), 4096));
+    auto page_number = region->backing_object_page_offset() + (page_address - region->base()) / 4096;
+    auto& backing_object = region->backing_object();
+    auto [resolved_page, shared, read] = TRY(lookup_page(backing_object, page_number));
+    if (read) {
+        return di::move(read);
+    }
+
+    auto page = *resolved_page;
+    if (shared && write) {
+        page = TRY(copy_shared_page(backing_object, page_number, page, translate(page_address) == page));
+        shared = false;
+    }
+
+    // Another processor may have resolved the fault while we were waiting for the lock, in which case the right page is
+    // already mapped and there is nothing left to do. Write faults on present pages still remap the page, since a page
+    // owned by the region's object may have been write protected while it was being cloned.
+    if (!(flags & PageFaultFlags::Present) && translate(page_address) == page) {
+        return di::nullopt;
+    }
+
+    auto page_flags = region->flags();
+    if (shared) {
+        page_flags &= ~RegionFlags::Writable;
+    }
+    TRY(map_physical_page(page_address, page, page_flags));
+    return di::nullopt;
+}
+
+di::Optional<PhysicalAddress> LockedAddressSpace::translate_for_write(VirtualAddress location) {
+    auto region = m_regions.find(location);
+    if (region == m_regions.end()) {
+        return di::nullopt;
+    }
+
+    auto page_address = VirtualAddress(di::align_down(location.raw_value(), 4096));
+    auto page = translate(page_address);
+    if (!page || !region->writable()) {
+        return page;
+    }
+
+    // Pages owned by the region's object are written in place. Anything else mapped here came from a copy-on-write
+    // source.
+    auto page_number = region->backing_object_page_offset() + (page_address - region->base()) / 4096;
+    if (region->backing_object().lookup_page_without_locking(page_number) != page) {
+        return di::nullopt;
+    }
+    return page;
+}
+
+// Dynamically allocated user regions are placed above the low part of the address space, which is left for executables
+// loaded at fixed addresses. The very top of both halves of the address space is never used, which avoids having to
+// worry about overflow when computing the end of a region.
+constexpr auto user_allocation_start = VirtualAddress(0x10000000000);
+constexpr auto user_allocation_end = VirtualAddress(0x800000000000 - large_page_size);
+constexpr auto kernel_allocation_end = VirtualAddress(0 - large_page_size);
+
+// Every region is surrounded by at least one unmapped page, so that overflowing a region (for example, a stack) faults
+// instead of silently corrupting its neighbour.
+constexpr auto guard_size = 4096_u64;
+
+struct FreeRangeRequest {
+    VirtualAddress lower;
+    VirtualAddress upper;
+    usize length;
+    usize alignment;
+
+    // The smallest gap which could possibly satisfy the request.
+    constexpr usize minimum_gap() const { return length + 2 * guard_size; }
+
+    constexpr di::Optional<VirtualAddress> fit(VirtualAddress gap_start, VirtualAddress gap_end) const {
+        gap_start = di::max(gap_start, lower);
+        gap_end = di::min(gap_end, upper);
+        if (gap_start >= gap_end || usize(gap_end - gap_start) < minimum_gap()) {
+            return di::nullopt;
+        }
+
+        auto start = VirtualAddress(di::align_up((gap_start + guard_size).raw_value(), alignment));
+        if (start >= gap_end || usize(gap_end - start) < length + guard_size) {
+            return di::nullopt;
+        }
+        return start;
+    }
+};
+
+// Search the gaps between the regions in the subtree rooted at @p node, in address order.
+static di::Optional<VirtualAddress> find_gap_in_subtree(Region& node, FreeRangeRequest const& request) {
+    if (node.subtree_max_gap() < request.minimum_gap() || node.subtree_end() <= request.lower ||
+        node.subtree_base() >= request.upper) {
+        return di::nullopt;
+    }
+
+    if (auto* left = node.left_child()) {
+        if (auto result = find_gap_in_subtree(*left, request)) {
+            return result;
+        }
+        if (auto result = request.fit(left->subtree_end(), node.base())) {
+            return result;
+        }
+    }
+    if (auto* right = node.right_child()) {
+        if (auto result = request.fit(node.end(), right->subtree_base())) {
+            return result;
+        }
+        return find_gap_in_subtree(*right, request);
+    }
+    return di::nullopt;
+}
+
+di::Optional<VirtualAddress> LockedAddressSpace::find_free_range(usize page_aligned_length, usize alignment) {
+    auto request = FreeRangeRequest {
+        .lower = base().m_kernel ? global_state().heap_start : user_allocation_start,
+        .upper = base().m_kernel ? kernel_allocation_end : user_allocation_end,
+        .length = page_aligned_length,
+        .alignment = alignment,
+    };
+
+    if (m_regions.empty()) {
+        return request.fit(request.lower, request.upper);
+    }
+
+    // The lowest address is chosen, which keeps the address space compact.
+    auto& first = *m_regions.front();
+    if (auto result = request.fit(request.lower, first.base())) {
+        return result;
+    }
+
+    auto* root = &first;
+    while (root->parent_region()) {
+        root = root->parent_region();
+    }
+    if (auto result = find_gap_in_subtree(*root, request)) {
+        return result;
+    }
+
+    return request.fit(m_regions.back()->end(), request.upper);
 }
 
 Expected<VirtualAddress> LockedAddressSpace::allocate_region(di::Arc<BackingObject> backing_object,
                                                              di::Box<Region> region) {
-    // Basic hack algorithm: allocate the new region at a large fixed offset from the old region.
-    // Additionally, immediately fill in the newly created pages.
-
     auto flags = region->flags();
     auto page_aligned_length = region->length();
 
@@ -33,28 +329,26 @@ Expected<VirtualAddress> LockedAddressSpace::allocate_region(di::Arc<BackingObje
         return di::Unexpected(Error::NotEnoughMemory);
     }
 
-    auto heap_start = global_state().heap_start;
-    auto default_address = base().m_kernel ? heap_start : mm::VirtualAddress(0x10000000000);
-    auto last_virtual_address = m_regions.back().transform(&Region::end).value_or(default_address);
-    auto new_virtual_address = last_virtual_address + 8192zu * 0x1000zu;
-
-    region->set_base(new_virtual_address);
-    auto [new_region, did_insert] = m_regions.insert(*region.release());
-    if (!did_insert) {
-        println("WARNING: attempt to allocate a region at an already-allocated address."_sv);
-        return di::Unexpected(Error::InvalidArgument);
+    // Align regions which can hold a large page, so that they can be mapped using large pages. If the address space is
+    // too fragmented for that, any page aligned range will do.
+    auto new_virtual_address = di::Optional<VirtualAddress> {};
+    if (page_aligned_length >= large_page_size) {
+        new_virtual_address = find_free_range(page_aligned_length, large_page_size);
     }
-
-    {
-        auto guard = backing_object->lock();
-        new_region->set_backing_object(di::move(backing_object));
-        for (auto [page_number, virtual_address] : di::enumerate(new_region->each_page())) {
-            auto page_frame = TRY(allocate_page_frame());
-            guard->add_page(page_frame, page_number);
-            TRY(map_physical_page(virtual_address, page_frame, flags));
-        }
+    if (!new_virtual_address) {
+        new_virtual_address = find_free_range(page_aligned_length, 4096);
+    }
+    if (!new_virtual_address) {
+        println("WARNING: no free virtual address range of size {:x}."_sv, page_aligned_length);
+        return di::Unexpected(Error::NotEnoughMemory);
     }
 
+    region->set_base(*new_virtual_address);
+    auto [new_region, did_insert] = m_regions.insert(*region.release());
+    ASSERT(did_insert);
+
+    new_region->set_backing_object(di::move(backing_object));
+    TRY(populate_kernel_region(*new_region));
     return new_region->base();
 }
 
@@ -65,21 +359,18 @@ Expected<void> LockedAddressSpace::allocate_region_at(di::Arc<BackingObject> bac
         return di::Unexpected(Error::InvalidArgument);
     }
 
-    auto [new_region, did_insert] = m_regions.insert(*region.release());
-    if (!did_insert) {
+    // The first region which either contains the new region's base or starts after it is the only one which can overlap.
+    auto next = m_regions.lower_bound(region->base());
+    if (next != m_regions.end() && (*next).base() < region->end()) {
         println("WARNING: attempt to allocate a region at an already-allocated address."_sv);
         return di::Unexpected(Error::InvalidArgument);
     }
 
-    {
-        auto guard = backing_object->lock();
-        new_region->set_backing_object(di::move(backing_object));
-        for (auto [page_number, virtual_address] : di::enumerate(new_region->each_page())) {
-            auto page_frame = TRY(allocate_page_frame());
-            guard->add_page(page_frame, page_number);
-            TRY(map_physical_page(virtual_address, page_frame, flags));
-        }
-    }
+    auto [new_region, did_insert] = m_regions.insert(*region.release());
+    ASSERT(did_insert);
+
+    new_region->set_backing_object(di::move(backing_object));
+    TRY(populate_kernel_region(*new_region));
     return {};
 }
 
@@ -95,6 +386,87 @@ Expected<void> AddressSpace::allocate_region_at(di::Arc<BackingObject> backing_o
     return lock()->allocate_region_at(di::move(backing_object), di::move(region));
 }
 
+Expected<void> AddressSpace::handle_page_fault(VirtualAddress address, PageFaultFlags flags) {
+    count_memory_event(MemoryEvent::PageFault);
+    m_page_faults.fetch_add(1, di::MemoryOrder::Relaxed);
+    return fault_in_page(address, flags);
+}
+
+Expected<void> AddressSpace::fault_in_page(VirtualAddress address, PageFaultFlags flags) {
+    for (;;) {
+        auto read = TRY(lock()->try_handle_page_fault(address, flags));
+        if (!read) {
+            return {};
+        }
+
+        // The lock is not held while reading the page in, so the region may have changed by the time the read
+        // completes. The fault is handled again from the start, which finds the page now that it is cached.
+        auto& inode = *read->inode;
+        TRY_UNERASE_ERROR(di::execution::sync_wait(inode_read(inode, inode.backing_object(), read->page_number)));
+    }
+}
+
+Expected<void> LockedAddressSpace::clone_regions_into(LockedAddressSpace& target) {
+    // Write protecting each region only queues the invalidation, so that every region is flushed with one shootdown.
+    auto guard = di::ScopeExit([&] {
+        flush_tlb();
+    });
+
+    // Everything which can fail is done before this address space is modified, so that a failed clone leaves it
+    // untouched. The target is discarded on failure, so it is filled in directly.
+    auto replacement_objects = di::Vector<di::Arc<BackingObject>> {};
+    for (auto& region : m_regions) {
+        auto new_region = TRY(di::make_box<Region>(region.base(), region.length(), region.flags()));
+        new_region->set_backing_object_page_offset(region.backing_object_page_offset());
+        if (!region.writable()) {
+            // Pages of read-only regions are never modified, so the backing object can be shared directly.
+            new_region->set_backing_object(region.backing_object().arc_from_this());
+            TRY(replacement_objects.push_back(nullptr));
+        } else {
+            // Both address spaces get a new private object, which shares the existing pages. The original object is no
+            // longer written to by anyone, which ensures that writes made by one address space are not visible to the
+            // other. This address space is locked, so nothing else walks the object's chain while it is collapsed.
+            auto& object = region.backing_object();
+            TRY(object.collapse_copy_on_write_chain());
+
+            // An object without any pages of its own adds nothing to the chain, so its source is shared directly.
+            auto source = object.arc_from_this();
+            if (!object.inode() && object.copy_on_write_source() && object.lock()->pages().empty()) {
+                source = object.copy_on_write_source()->arc_from_this();
+            }
+            auto new_object = TRY(di::make_arc<BackingObject>(source));
+            TRY(replacement_objects.push_back(TRY(di::make_arc<BackingObject>(di::move(source)))));
+            new_region->set_backing_object(di::move(new_object));
+        }
+        target.m_regions.insert(*new_region.release());
+    }
+
+    // Write protecting a region can only fail part of the way through, in which case some of this address space's own
+    // pages are left read-only. This is harmless, since write faults on them simply map them writable again.
+    for (auto& region : m_regions) {
+        if (region.writable()) {
+            TRY(write_protect(region.base(), region.length()));
+        }
+    }
+
+    auto replacement_object = replacement_objects.begin();
+    for (auto& region : m_regions) {
+        if (*replacement_object) {
+            region.set_backing_object(di::move(*replacement_object));
+        }
+        ++replacement_object;
+    }
+    return {};
+}
+
+Expected<di::Arc<AddressSpace>> AddressSpace::clone() {
+    ASSERT(!is_kernel());
+
+    auto result = TRY(create_empty_user_address_space());
+    TRY(lock()->clone_regions_into(result->get_assuming_no_concurrent_accesses()));
+    return result;
+}
+
 Expected<void> init_and_load_initial_kernel_address_space(PhysicalAddress kernel_physical_start,
                                                           VirtualAddress kernel_virtual_start,
                                                           PhysicalAddress max_physical_address) {
@@ -1,17 +1,103 @@
 #include <di/util/prelude.h>
+#include <iris/fs/inode.h>
 #include <iris/mm/backing_object.h>
+#include <iris/mm/page_frame_allocator.h>
 #include <iris/mm/physical_page.h>
 
 namespace iris::mm {
-void LockedBackingObject::add_page(PhysicalAddress address, u64 page_offset) {
-    ASSERT(!m_pages.contains(page_offset));
+BackingObject::BackingObject() = default;
 
+BackingObject::BackingObject(di::Arc<BackingObject> copy_on_write_source)
+    : m_copy_on_write_source(di::move(copy_on_write_source)) {
+    m_copy_on_write_source->m_copy_on_write_users.fetch_add(1, di::MemoryOrder::Release);
+    if (auto inode = m_copy_on_write_source->inode()) {
+        m_source_inode = inode->arc_from_this();
+    }
+}
+
+BackingObject::~BackingObject() {
+    if (m_copy_on_write_source) {
+        m_copy_on_write_source->m_copy_on_write_users.fetch_sub(1, di::MemoryOrder::Release);
+    }
+}
+
+Expected<void> BackingObject::collapse_copy_on_write_chain() {
+    while (is_sole_copy_on_write_user()) {
+        auto& source = *m_copy_on_write_source;
+
+        // Take over every page of the source which this object does not already have. Stopping part of the way through
+        // is harmless, since the source still holds every page.
+        {
+            auto locked = lock();
+            auto locked_source = source.lock();
+            auto result = Expected<void> {};
+            auto add_missing_page = [&](u64 page_offset, PhysicalAddress address) {
+                if (result && !locked->lookup_page(page_offset)) {
+                    result = locked->add_shared_page(address, page_offset);
+                }
+            };
+            locked_source->pages().for_each_in_range(0, di::NumericLimits<u64>::max, add_missing_page);
+            TRY(result);
+        }
+
+        // The source's own source (if any) is used directly instead. The old source is destroyed once its reference
+        // is dropped, which also releases its pages.
+        auto next = source.m_copy_on_write_source;
+        if (next) {
+            next->m_copy_on_write_users.fetch_add(1, di::MemoryOrder::Release);
+        }
+        m_source_inode = source.m_source_inode;
+        m_copy_on_write_source = di::move(next);
+    }
+    return {};
+}
+
+LockedBackingObject::~LockedBackingObject() {
+    m_pages.for_each_in_range(0, di::NumericLimits<u64>::max, [](u64, PhysicalAddress address) {
+        drop_page(address);
+    });
+}
+
+Expected<void> LockedBackingObject::add_page(PhysicalAddress address, u64 page_offset) {
+    // The page must own its reference before being published, since lock-free lookups may find and map it as soon as it
+    // is inserted.
     auto& page = physical_page(address);
-    di::construct_at(&page.as_backed_page, page_offset);
-    m_pages.insert(page.as_backed_page);
+    di::construct_at(&page.as_backed_page);
+    if (auto result = m_pages.insert(page_offset, address); !result) {
+        di::destroy_at(&page.as_backed_page);
+        return result;
+    }
+    return {};
+}
+
+Expected<void> LockedBackingObject::add_shared_page(PhysicalAddress address, u64 page_offset) {
+    bump_page(address);
+    if (auto result = m_pages.insert(page_offset, address); !result) {
+        drop_page(address);
+        return result;
+    }
+    return {};
+}
+
+Expected<PhysicalAddress> LockedBackingObject::add_zeroed_page(u64 page_offset) {
+    auto page = TRY(allocate_page_frame());
+    if (auto result = add_page(page, page_offset); !result) {
+        deallocate_page_frame(page);
+        return di::Unexpected(di::move(result).error());
+    }
+    return page;
 }
 
 di::Optional<mm::PhysicalAddress> LockedBackingObject::lookup_page(u64 page_offset) const {
-    return m_pages.at(page_offset).transform(physical_address);
+    return m_pages.lookup(page_offset);
+}
+
+usize LockedBackingObject::lookup_pages(u64 first_page_offset, di::Span<PhysicalAddress> pages) const {
+    return m_pages.lookup_range(first_page_offset, pages);
+}
+
+bool LockedBackingObject::has_pages_in_range(u64 first_page_offset, u64 count) const {
+    auto next = m_pages.find_next(first_page_offset);
+    return next && *next - first_page_offset < count;
 }
 }
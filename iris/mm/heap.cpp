@@ -2,75 +2,263 @@
 #include <di/platform/compiler.h>
 #include <di/util/prelude.h>
 #include <iris/core/global_state.h>
+#include <iris/core/interrupt_disabler.h>
 #include <iris/core/print.h>
-#include <iris/mm/address_space.h>
+#include <iris/mm/heap.h>
+#include <iris/mm/map_physical_address.h>
 #include <iris/mm/page_frame_allocator.h>
-#include <iris/mm/sections.h>
+#include <iris/mm/physical_page.h>
 
 #if DI_GCC
 #pragma GCC diagnostic ignored "-Wsized-deallocation"
 #endif
 
-// These functions are explicitly not to be used in the iris kernel.
-// Nothrow new and sized deallocations are required throughout the kernel.
-// void* operator new(std::size_t size);
-// void* operator new(std::size_t size, std::align_val_t alignment);
+namespace iris::mm {
+// Keep a few empty slabs around for each size class, so that a workload which repeatedly allocates and frees a
+// single object does not bounce pages back and forth with the page frame allocator.
+constexpr auto max_empty_slabs_per_size_class = 2zu;
 
-void* operator new(std::size_t size, std::nothrow_t const&) noexcept {
-    return ::operator new(size, std::align_val_t { 16 }, std::nothrow);
+static di::Optional<usize> size_class_index(usize size, usize alignment) {
+    for (auto i : di::range(heap_size_class_count)) {
+        if (heap_size_classes[i] >= size && heap_size_classes[i] % alignment == 0) {
+            return i;
+        }
+    }
+    return di::nullopt;
 }
 
-void* operator new(std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept {
-    auto const& global_state = iris::global_state();
-    return global_state.kernel_address_space.with_lock([&](auto& address_space) -> void* {
-        ASSERT(!iris::interrupts_disabled() || !iris::current_processor_unsafe().is_online());
+static byte* slab_data(SlabPhysicalPage& slab) {
+    return &(*map_physical_address(physical_address(slab), 4096)).typed<byte>();
+}
 
-        auto& heap_region = global_state.inital_kernel_regions.back();
-        auto old_heap_end = global_state.heap_end;
+static SlabPhysicalPage& slab_for_object(void* object) {
+    auto address = physical_address_of_mapping(object);
+    return slab_page(PhysicalAddress(di::align_down(address.raw_value(), 4096)));
+}
 
-        auto alignment_difference = old_heap_end.raw_value() % di::to_underlying(alignment);
-        if (alignment_difference != 0) {
-            global_state.heap_end = old_heap_end + di::to_underlying(alignment) - alignment_difference;
-        }
+static Expected<SlabPhysicalPage*> allocate_slab(SlabDepot& depot, usize index) {
+    auto page = TRY(allocate_page_frame());
+    auto& slab = slab_page(page);
+    di::construct_at(&slab, u16(index));
 
-        auto result = global_state.heap_end;
-        global_state.heap_end = result + size;
-
-        if (old_heap_end == global_state.heap_start ||
-            di::align_up(old_heap_end.raw_value(), 4096) != di::align_up(global_state.heap_end.raw_value(), 4096)) {
-            auto virtual_start = iris::mm::VirtualAddress(di::align_up(old_heap_end.raw_value(), 4096));
-            auto virtual_end = iris::mm::VirtualAddress(di::align_up(global_state.heap_end.raw_value(), 4096));
-            for (auto virtual_address = virtual_start; virtual_address < virtual_end; virtual_address += 4096zu) {
-                auto physical_page = iris::mm::allocate_page_frame();
-                if (!physical_page) {
-                    iris::println(u8"Failed to allocate physical page in ::new()"_sv);
-                    return nullptr;
-                }
+    // Thread the free list through the objects themselves, so that objects are handed out in address order.
+    auto object_size = heap_size_classes[index];
+    auto* data = slab_data(slab);
+    for (auto i = 4096 / object_size; i > 0; i--) {
+        auto* object = data + (i - 1) * object_size;
+        *reinterpret_cast<void**>(object) = slab.free_list;
+        slab.free_list = object;
+    }
 
-                auto const page_number = (virtual_address - global_state.heap_start) / 4096;
-                heap_region.backing_object().lock()->add_page(*physical_page, page_number);
+    depot.slab_page_count++;
+    return &slab;
+}
 
-                if (!address_space.map_physical_page(virtual_address, *physical_page,
-                                                     iris::mm::RegionFlags::Readable |
-                                                         iris::mm::RegionFlags::Writable)) {
-                    iris::println(u8"Failed to map physical page in ::new()"_sv);
-                    return nullptr;
+static usize take_from_depot(usize index, di::Span<void*> output) {
+    return global_state().heap_slab_depots[index].with_lock([&](SlabDepot& depot) {
+        auto count = 0zu;
+        while (count < output.size()) {
+            if (depot.partial_slabs.empty()) {
+                auto slab = allocate_slab(depot, index);
+                if (!slab) {
+                    break;
                 }
+                (*slab)->in_partial_list = true;
+                depot.partial_slabs.push_front(**slab);
+                depot.empty_slab_count++;
+            }
+
+            auto& slab = *depot.partial_slabs.front();
+            if (slab.used_count == 0) {
+                depot.empty_slab_count--;
+            }
+
+            while (slab.free_list && count < output.size()) {
+                auto* object = slab.free_list;
+                slab.free_list = *static_cast<void**>(object);
+                slab.used_count++;
+                output[count++] = object;
+            }
+
+            if (!slab.free_list) {
+                depot.partial_slabs.pop_front();
+                slab.in_partial_list = false;
             }
-            heap_region.set_end(virtual_end);
         }
+        return count;
+    });
+}
+
+static void return_to_depot(usize index, di::Span<void*> objects) {
+    global_state().heap_slab_depots[index].with_lock([&](SlabDepot& depot) {
+        for (auto* object : objects) {
+            auto& slab = slab_for_object(object);
+            ASSERT_EQ(slab.size_class_index, index);
+            ASSERT_GT(slab.used_count, 0);
+
+            *static_cast<void**>(object) = slab.free_list;
+            slab.free_list = object;
+            slab.used_count--;
 
-        return result.void_pointer();
+            if (!slab.in_partial_list) {
+                depot.partial_slabs.push_back(slab);
+                slab.in_partial_list = true;
+            }
+
+            if (slab.used_count == 0) {
+                if (depot.empty_slab_count < max_empty_slabs_per_size_class) {
+                    depot.empty_slab_count++;
+                    continue;
+                }
+
+                depot.partial_slabs.erase(decltype(depot.partial_slabs.begin())(slab));
+                deallocate_page_frame(physical_address(slab));
+                depot.slab_page_count--;
+            }
+        }
     });
 }
 
+void* HeapCache::allocate(usize size_class_index) {
+    auto& magazine = m_magazines[size_class_index];
+    if (magazine.count == 0) {
+        magazine.count =
+            take_from_depot(size_class_index, { magazine.objects.data(), heap_magazine_capacity / 2 });
+        if (magazine.count == 0) {
+            return nullptr;
+        }
+    }
+
+    account(size_class_index, 1);
+    return magazine.objects[--magazine.count];
+}
+
+void HeapCache::deallocate(void* object, usize size_class_index) {
+    auto& magazine = m_magazines[size_class_index];
+    if (magazine.count == heap_magazine_capacity) {
+        // Return the least recently freed half of the magazine to the depot, since the other half is more likely to
+        // still be in the processor's cache.
+        auto constexpr half = heap_magazine_capacity / 2;
+        return_to_depot(size_class_index, { magazine.objects.data(), half });
+        di::copy(di::Span { magazine.objects.data() + half, half }, magazine.objects.data());
+        magazine.count = half;
+    }
+
+    account(size_class_index, -1);
+    magazine.objects[magazine.count++] = object;
+}
+
+static HeapCache& current_heap_cache() {
+    auto& global_state = global_state_in_boot();
+    if (!global_state.current_processor_available) {
+        return global_state.boot_processor.heap_cache();
+    }
+    // SAFETY: this function is called with interrupts disabled.
+    return current_processor_unsafe().heap_cache();
+}
+
+static void* allocate_large(usize size, usize alignment) {
+    if (alignment > 4096) {
+        println("WARNING: attempt to allocate from the kernel heap with alignment {}."_sv, alignment);
+        return nullptr;
+    }
+
+    auto page_count = di::divide_round_up(size, 4096);
+    auto base = page_count == 1 ? allocate_page_frame() : allocate_physically_contiguous_page_frames(page_count);
+    if (!base) {
+        println("WARNING: failed to allocate {} pages for the kernel heap."_sv, page_count);
+        return nullptr;
+    }
+
+    auto const& global_state = iris::global_state();
+    global_state.heap_large_allocation_count.fetch_add(1, di::MemoryOrder::Relaxed);
+    global_state.heap_large_allocation_page_count.fetch_add(page_count, di::MemoryOrder::Relaxed);
+    return &(*map_physical_address(*base, page_count * 4096)).typed<byte>();
+}
+
+static void deallocate_large(void* pointer, usize size) {
+    auto base = physical_address_of_mapping(pointer);
+    auto page_count = di::divide_round_up(size, 4096);
+    for (auto i : di::range(page_count)) {
+        deallocate_page_frame(base + i * 4096);
+    }
+
+    auto const& global_state = iris::global_state();
+    global_state.heap_large_allocation_count.fetch_sub(1, di::MemoryOrder::Relaxed);
+    global_state.heap_large_allocation_page_count.fetch_sub(page_count, di::MemoryOrder::Relaxed);
+}
+
+static void* allocate(usize size, usize alignment) {
+    auto index = size_class_index(size, alignment);
+    if (!index) {
+        return allocate_large(size, alignment);
+    }
+
+    auto guard = InterruptDisabler {};
+    return current_heap_cache().allocate(*index);
+}
+
+static void deallocate(void* pointer, usize size, usize alignment) {
+    if (!pointer) {
+        return;
+    }
+
+    auto index = size_class_index(size, alignment);
+    if (!index) {
+        return deallocate_large(pointer, size);
+    }
+
+    auto guard = InterruptDisabler {};
+    current_heap_cache().deallocate(pointer, *index);
+}
+
+HeapStatistics heap_statistics() {
+    auto const& global_state = iris::global_state();
+
+    auto result = HeapStatistics {};
+    for (auto i : di::range(heap_size_class_count)) {
+        auto allocated_objects = 0_i64;
+        if (global_state.processor_map.empty()) {
+            allocated_objects = global_state.boot_processor.heap_cache().allocated_objects(i);
+        }
+        for (auto [_, processor] : global_state.processor_map) {
+            allocated_objects += processor->heap_cache().allocated_objects(i);
+        }
+
+        result.size_classes[i] = {
+            .object_size = heap_size_classes[i],
+            .allocated_objects = usize(di::max(allocated_objects, 0_i64)),
+            .slab_pages = global_state.heap_slab_depots[i].lock()->slab_page_count,
+        };
+    }
+    result.large_allocations = global_state.heap_large_allocation_count.load(di::MemoryOrder::Relaxed);
+    result.large_allocation_pages = global_state.heap_large_allocation_page_count.load(di::MemoryOrder::Relaxed);
+    return result;
+}
+}
+
+// These functions are explicitly not to be used in the iris kernel.
+// Nothrow new and sized deallocations are required throughout the kernel.
+// void* operator new(std::size_t size);
+// void* operator new(std::size_t size, std::align_val_t alignment);
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept {
+    return ::operator new(size, std::align_val_t { 16 }, std::nothrow);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept {
+    ASSERT(!iris::interrupts_disabled() || !iris::current_processor_unsafe().is_online());
+    return iris::mm::allocate(size, di::to_underlying(alignment));
+}
+
 // Deallocating delete.
-void operator delete(void*, std::size_t) noexcept {
-    ASSERT(!iris::interrupts_disabled() || !iris::current_processor()->is_online());
+void operator delete(void* pointer, std::size_t size) noexcept {
+    ::operator delete(pointer, size, std::align_val_t { 16 });
 }
 void operator delete(void*, std::align_val_t) noexcept {
     di::unreachable();
 }
-void operator delete(void*, std::size_t, std::align_val_t) noexcept {
+void operator delete(void* pointer, std::size_t size, std::align_val_t alignment) noexcept {
     ASSERT(!iris::interrupts_disabled() || !iris::current_processor()->is_online());
+    iris::mm::deallocate(pointer, size, di::to_underlying(alignment));
 }
@@ -0,0 +1,38 @@
+#include <iris/core/global_state.h>
+#include <iris/core/interrupt_disabler.h>
+#include <iris/mm/memory_statistics.h>
+#include <iris/mm/page_frame_allocator.h>
+
+namespace iris::mm {
+static MemoryCounters& current_memory_counters() {
+    auto& global_state = global_state_in_boot();
+    if (!global_state.current_processor_available) {
+        return global_state.boot_processor.memory_counters();
+    }
+    // SAFETY: this function is called with interrupts disabled.
+    return current_processor_unsafe().memory_counters();
+}
+
+void count_memory_event(MemoryEvent event) {
+    with_interrupts_disabled([&] {
+        current_memory_counters().increment(event);
+    });
+}
+
+MemoryStatistics memory_statistics() {
+    auto const& global_state = iris::global_state();
+
+    auto result = MemoryStatistics {};
+    result.physical = physical_memory_statistics();
+    for (auto i : di::range(memory_event_count)) {
+        auto event = MemoryEvent(i);
+        if (global_state.processor_map.empty()) {
+            result.events[i] = global_state.boot_processor.memory_counters().count(event);
+        }
+        for (auto [_, processor] : global_state.processor_map) {
+            result.events[i] += processor->memory_counters().count(event);
+        }
+    }
+    return result;
+}
+}
@@ -1,86 +1,399 @@
+#include <di/math/prelude.h>
 #include <di/platform/compiler.h>
+#include <iris/core/global_state.h>
+#include <iris/core/interrupt_disabler.h>
 #include <iris/core/print.h>
 #include <iris/mm/map_physical_address.h>
 #include <iris/mm/page_frame_allocator.h>
+#include <iris/mm/page_operations.h>
 
 #if DI_GCC
 #pragma GCC diagnostic ignored "-Wstringop-overflow"
 #endif
 
 namespace iris::mm {
-// Store enough for 4 GiB of physical memory.
-constexpr usize physical_page_count = 4llu * 1024u * 1024u * 1024u / 4096u;
+// The largest block tracked by the buddy allocator is 2^max_order pages (4 GiB).
+constexpr auto max_order = 20zu;
+constexpr auto no_page = di::NumericLimits<u64>::max;
 
-static auto page_frame_bitmap = di::Synchronized<di::BitSet<physical_page_count>> {};
+// Free blocks are kept in doubly linked lists, which are threaded through the first page of each free block. Free pages
+// are always accessible through the physical memory direct map, so this requires no additional storage.
+struct FreeBlock {
+    u64 next;
+    u64 prev;
+};
 
-void reserve_page_frames(PhysicalAddress base_address, usize page_count) {
-    return page_frame_bitmap.with_lock([&](auto& bitmap) {
-        for (auto address = base_address; address < base_address + 4096 * page_count; address += 4096zu) {
-            if (address.raw_value() / 4096 >= physical_page_count) {
-                break;
+struct BuddyAllocator {
+    // One byte per physical page. A non-zero value means the page is the first page of a free block of order
+    // (value - 1). All other pages, free or not, have a value of 0.
+    u8* page_state { nullptr };
+    u64 page_count { 0 };
+    u64 metadata_begin { 0 };
+    u64 metadata_end { 0 };
+    di::Array<u64, max_order + 1> free_lists {};
+    usize free_page_count { 0 };
+    usize total_page_count { 0 };
+};
+
+static auto buddy_allocator = di::Synchronized<BuddyAllocator> {};
+
+static FreeBlock& free_block(u64 page) {
+    return (*map_physical_address(PhysicalAddress(page * 4096), sizeof(FreeBlock))).typed<FreeBlock>();
+}
+
+static void push_free_block(BuddyAllocator& allocator, u64 page, usize order) {
+    auto& block = free_block(page);
+    block.prev = no_page;
+    block.next = allocator.free_lists[order];
+    if (block.next != no_page) {
+        free_block(block.next).prev = page;
+    }
+    allocator.free_lists[order] = page;
+    allocator.page_state[page] = order + 1;
+    allocator.free_page_count += 1zu << order;
+}
+
+static void remove_free_block(BuddyAllocator& allocator, u64 page, usize order) {
+    auto& block = free_block(page);
+    if (block.prev != no_page) {
+        free_block(block.prev).next = block.next;
+    } else {
+        allocator.free_lists[order] = block.next;
+    }
+    if (block.next != no_page) {
+        free_block(block.next).prev = block.prev;
+    }
+    allocator.page_state[page] = 0;
+    allocator.free_page_count -= 1zu << order;
+}
+
+static void free_block_and_coalesce(BuddyAllocator& allocator, u64 page, usize order) {
+    while (order < max_order) {
+        auto buddy = page ^ (1_u64 << order);
+        if (buddy >= allocator.page_count || allocator.page_state[buddy] != order + 1) {
+            break;
+        }
+        remove_free_block(allocator, buddy, order);
+        page = di::min(page, buddy);
+        order++;
+    }
+    push_free_block(allocator, page, order);
+}
+
+static void free_range(BuddyAllocator& allocator, u64 begin, u64 end) {
+    // Free the largest naturally aligned blocks which fit in the range.
+    while (begin < end) {
+        auto order = 0zu;
+        while (order < max_order && begin % (2_u64 << order) == 0 && begin + (2_u64 << order) <= end) {
+            order++;
+        }
+        free_block_and_coalesce(allocator, begin, order);
+        begin += 1_u64 << order;
+    }
+}
+
+static di::Optional<u64> allocate_block(BuddyAllocator& allocator, usize order) {
+    for (auto current = order; current <= max_order; current++) {
+        auto page = allocator.free_lists[current];
+        if (page == no_page) {
+            continue;
+        }
+
+        // Split the block until it is the requested size, returning the upper halves to the free lists.
+        remove_free_block(allocator, page, current);
+        while (current > order) {
+            current--;
+            push_free_block(allocator, page + (1_u64 << current), current);
+        }
+        return page;
+    }
+    return di::nullopt;
+}
+
+static void reserve_page(BuddyAllocator& allocator, u64 page) {
+    for (auto order = 0zu; order <= max_order; order++) {
+        auto head = di::align_down(page, 1_u64 << order);
+        if (allocator.page_state[head] != order + 1) {
+            continue;
+        }
+
+        // Split the free block containing the page, until only the page itself is removed.
+        remove_free_block(allocator, head, order);
+        while (order > 0) {
+            order--;
+            auto half = 1_u64 << order;
+            if (page >= head + half) {
+                push_free_block(allocator, head, order);
+                head += half;
+            } else {
+                push_free_block(allocator, head + half, order);
             }
-            bitmap[address.raw_value() / 4096] = false;
         }
+        return;
+    }
+}
+
+usize page_frame_allocator_metadata_size(PhysicalAddress max_physical_address) {
+    return di::align_up(di::divide_round_up(max_physical_address.raw_value(), 4096), 4096);
+}
+
+void init_page_frame_allocator(PhysicalAddress max_physical_address, PhysicalAddress metadata_base) {
+    buddy_allocator.with_lock([&](BuddyAllocator& allocator) {
+        auto metadata_size = page_frame_allocator_metadata_size(max_physical_address);
+
+        allocator.page_count = di::divide_round_up(max_physical_address.raw_value(), 4096);
+        allocator.page_state = &(*map_physical_address(metadata_base, metadata_size)).typed<u8>();
+        allocator.metadata_begin = metadata_base.raw_value() / 4096;
+        allocator.metadata_end = allocator.metadata_begin + metadata_size / 4096;
+        allocator.free_lists.fill(no_page);
+        di::fill_n(allocator.page_state, allocator.page_count, 0);
+    });
+}
+
+void reserve_page_frames(PhysicalAddress base_address, usize page_count) {
+    return buddy_allocator.with_lock([&](BuddyAllocator& allocator) {
+        auto begin = base_address.raw_value() / 4096;
+        auto end = di::min(begin + page_count, allocator.page_count);
+        auto free_pages_before = allocator.free_page_count;
+        for (auto page = begin; page < end; page++) {
+            reserve_page(allocator, page);
+        }
+        allocator.total_page_count -= free_pages_before - allocator.free_page_count;
     });
 }
 
 void unreserve_page_frames(PhysicalAddress base_address, usize page_count) {
-    return page_frame_bitmap.with_lock([&](auto& bitmap) {
-        for (auto address = base_address; address < base_address + 4096 * page_count; address += 4096zu) {
-            if (address.raw_value() / 4096 >= physical_page_count) {
-                break;
+    return buddy_allocator.with_lock([&](BuddyAllocator& allocator) {
+        auto begin = base_address.raw_value() / 4096;
+        auto end = di::min(begin + page_count, allocator.page_count);
+
+        // Never hand out the pages used to store the allocator's own metadata.
+        auto free_pages_before = allocator.free_page_count;
+        free_range(allocator, begin, di::max(begin, di::min(end, allocator.metadata_begin)));
+        free_range(allocator, di::max(begin, allocator.metadata_end), di::max(end, allocator.metadata_end));
+        allocator.total_page_count += allocator.free_page_count - free_pages_before;
+    });
+}
+
+static PageFrameCache& current_page_frame_cache() {
+    auto& global_state = global_state_in_boot();
+    if (!global_state.current_processor_available) {
+        return global_state.boot_processor.page_frame_cache();
+    }
+    // SAFETY: this function is called with interrupts disabled.
+    return current_processor_unsafe().page_frame_cache();
+}
+
+// The count is only written by the owning processor, and is atomic only so that it can be read when collecting
+// statistics.
+di::Optional<PhysicalAddress> PageFrameCache::allocate() {
+    auto count = m_count.load(di::MemoryOrder::Relaxed);
+    if (count == 0) {
+        buddy_allocator.with_lock([&](BuddyAllocator& allocator) {
+            while (count < page_frame_cache_capacity / 2) {
+                auto page = allocate_block(allocator, 0);
+                if (!page) {
+                    break;
+                }
+                m_page_numbers[count++] = *page;
+            }
+        });
+        if (count == 0) {
+            return di::nullopt;
+        }
+    }
+    m_count.store(--count, di::MemoryOrder::Relaxed);
+    return PhysicalAddress(m_page_numbers[count] * 4096);
+}
+
+void PageFrameCache::deallocate(PhysicalAddress address) {
+    auto count = m_count.load(di::MemoryOrder::Relaxed);
+    if (count == page_frame_cache_capacity) {
+        auto constexpr half = page_frame_cache_capacity / 2;
+        buddy_allocator.with_lock([&](BuddyAllocator& allocator) {
+            for (auto page : di::Span { m_page_numbers.data(), half }) {
+                free_block_and_coalesce(allocator, page, 0);
             }
-            bitmap[address.raw_value() / 4096] = true;
+        });
+        di::copy(di::Span { m_page_numbers.data() + half, half }, m_page_numbers.data());
+        count = half;
+    }
+    m_page_numbers[count++] = address.raw_value() / 4096;
+    m_count.store(count, di::MemoryOrder::Relaxed);
+}
+
+di::Optional<PhysicalAddress> PageFrameCache::allocate_zeroed() {
+    auto count = m_zeroed_count.load(di::MemoryOrder::Relaxed);
+    if (count == 0) {
+        return di::nullopt;
+    }
+    m_zeroed_count.store(--count, di::MemoryOrder::Relaxed);
+    return PhysicalAddress(m_zeroed_page_numbers[count] * 4096);
+}
+
+bool PageFrameCache::add_zeroed(PhysicalAddress address) {
+    auto count = m_zeroed_count.load(di::MemoryOrder::Relaxed);
+    if (count == zeroed_page_pool_capacity) {
+        return false;
+    }
+    m_zeroed_page_numbers[count++] = address.raw_value() / 4096;
+    m_zeroed_count.store(count, di::MemoryOrder::Relaxed);
+    return true;
+}
+
+void PageFrameCache::drain() {
+    auto count = m_count.load(di::MemoryOrder::Relaxed);
+    auto zeroed_count = m_zeroed_count.load(di::MemoryOrder::Relaxed);
+    if (count == 0 && zeroed_count == 0) {
+        return;
+    }
+
+    buddy_allocator.with_lock([&](BuddyAllocator& allocator) {
+        for (auto page : di::Span { m_page_numbers.data(), count }) {
+            free_block_and_coalesce(allocator, page, 0);
         }
+        for (auto page : di::Span { m_zeroed_page_numbers.data(), zeroed_count }) {
+            free_block_and_coalesce(allocator, page, 0);
+        }
+    });
+    m_count.store(0, di::MemoryOrder::Relaxed);
+    m_zeroed_count.store(0, di::MemoryOrder::Relaxed);
+}
+
+// Under memory pressure, the remaining free pages may be sitting in the per-processor caches. Return all of them to the
+// buddy allocator, so that the caller can retry. Other processors can only be asked to drain their caches when
+// interrupts are enabled, since they may be waiting on this processor to drain its own.
+static void drain_page_frame_caches() {
+    auto drain_local = [] {
+        with_interrupts_disabled([] {
+            current_page_frame_cache().drain();
+        });
+    };
+
+    auto const& global_state = global_state_in_boot();
+    if (interrupts_disabled() || !global_state.all_aps_booted.load(di::MemoryOrder::Relaxed)) {
+        drain_local();
+        return;
+    }
+
+    with_preemption_disabled([&] {
+        // SAFETY: preemption is disabled.
+        current_processor_unsafe().drain_remote_page_frame_caches();
+        drain_local();
     });
 }
 
 Expected<PhysicalAddress> allocate_page_frame() {
-    return page_frame_bitmap.with_lock([&](auto& bitmap) -> Expected<PhysicalAddress> {
-        for (usize i = 0; i < physical_page_count; i++) {
-            if (bitmap[i]) {
-                bitmap[i] = false;
-
-                auto& array = TRY(map_physical_address(PhysicalAddress(i * 4096), 4096))
-                                  .typed<di::Array<mm::PhysicalAddress, 512>>();
-                array.fill(mm::PhysicalAddress(0));
-                return PhysicalAddress(i * 4096);
-            }
+    auto [page, zeroed] = with_interrupts_disabled([] -> di::Tuple<di::Optional<PhysicalAddress>, bool> {
+        auto& cache = current_page_frame_cache();
+        if (auto page = cache.allocate_zeroed()) {
+            return { page, true };
+        }
+        return { cache.allocate(), false };
+    });
+    count_memory_event(zeroed ? MemoryEvent::ZeroedPagePoolHit : MemoryEvent::ZeroedPagePoolMiss);
+    if (!page) {
+        drain_page_frame_caches();
+        page = with_interrupts_disabled([] {
+            return current_page_frame_cache().allocate();
+        });
+        if (!page) {
+            return di::Unexpected(Error::NotEnoughMemory);
+        }
+    }
+
+    if (!zeroed) {
+        clear_page(*page);
+    }
+    return *page;
+}
+
+bool refill_zeroed_page_pool() {
+    auto page = with_interrupts_disabled([] -> di::Optional<PhysicalAddress> {
+        auto& cache = current_page_frame_cache();
+        if (cache.zeroed_count() == zeroed_page_pool_capacity) {
+            return di::nullopt;
         }
-        return di::Unexpected(Error::NotEnoughMemory);
+        return cache.allocate();
+    });
+    if (!page) {
+        return false;
+    }
+
+    // The page is zeroed with interrupts enabled. Since the page will not be used until some later allocation, there is
+    // no point in bringing it into the cache.
+    clear_page_non_temporal(*page);
+
+    // The caller may have moved to another processor while zeroing, so look up the current processor's cache again.
+    auto added = with_interrupts_disabled([&] {
+        return current_page_frame_cache().add_zeroed(*page);
     });
+    if (!added) {
+        deallocate_page_frame(*page);
+    }
+    return added;
 }
 
 Expected<PhysicalAddress> allocate_physically_contiguous_page_frames(usize page_count) {
-    return page_frame_bitmap.with_lock([&](auto& bitmap) -> Expected<PhysicalAddress> {
-        for (usize i = 0; i <= physical_page_count - page_count; i++) {
-            if (bitmap[i]) {
-                auto valid = true;
-                for (auto j : di::range(page_count)) {
-                    if (!bitmap[i + j]) {
-                        // Skip to the next page, ensuring this algorithm is linear.
-                        i += j;
-                        valid = false;
-                        break;
-                    }
-                }
-                if (!valid) {
-                    continue;
-                }
-                for (auto k : di::range(page_count)) {
-                    bitmap[i + k] = false;
-                }
-                return PhysicalAddress(i * 4096);
-            }
+    auto order = 0zu;
+    while ((1zu << order) < page_count) {
+        if (++order > max_order) {
+            return di::Unexpected(Error::NotEnoughMemory);
         }
-        return di::Unexpected(Error::NotEnoughMemory);
+    }
+
+    auto allocate = [&] {
+        return buddy_allocator.with_lock([&](BuddyAllocator& allocator) -> Expected<PhysicalAddress> {
+            auto page = allocate_block(allocator, order);
+            if (!page) {
+                return di::Unexpected(Error::NotEnoughMemory);
+            }
+
+            // Return the unused tail of the block to the free lists.
+            free_range(allocator, *page + page_count, *page + (1_u64 << order));
+            return PhysicalAddress(*page * 4096);
+        });
+    };
+
+    // Cached pages may be the missing buddies needed to form a large enough block.
+    if (auto result = allocate()) {
+        return result;
+    }
+    drain_page_frame_caches();
+    return allocate();
+}
+
+PhysicalMemoryStatistics physical_memory_statistics() {
+    auto const& global_state = iris::global_state();
+
+    auto result = PhysicalMemoryStatistics {};
+    buddy_allocator.with_lock([&](BuddyAllocator& allocator) {
+        result.total_pages = allocator.total_page_count;
+        result.free_pages = allocator.free_page_count;
     });
+    auto add_cache = [&](PageFrameCache const& cache) {
+        result.cached_pages += cache.count();
+        result.zeroed_pages += cache.zeroed_count();
+    };
+    if (global_state.processor_map.empty()) {
+        add_cache(global_state.boot_processor.page_frame_cache());
+    }
+    for (auto [_, processor] : global_state.processor_map) {
+        add_cache(processor->page_frame_cache());
+    }
+    return result;
 }
 
 void deallocate_page_frame(PhysicalAddress address) {
     ASSERT(address.raw_value() % 4096 == 0);
-    return page_frame_bitmap.with_lock([&](auto& bitmap) {
-        bitmap[address.raw_value() / 4096] = true;
+    with_interrupts_disabled([&] {
+        current_page_frame_cache().deallocate(address);
     });
 }
+
+#ifdef IRIS_LOCK_STATISTICS
+LockStatistics const& page_frame_allocator_lock_statistics() {
+    return buddy_allocator.get_lock().statistics();
+}
+#endif
 }
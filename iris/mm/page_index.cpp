@@ -0,0 +1,285 @@
+#include <di/bit/prelude.h>
+#include <di/util/prelude.h>
+#include <iris/mm/page_index.h>
+
+namespace iris::mm {
+namespace detail {
+    struct PageIndexNode {
+        explicit PageIndexNode(u8 shift) : shift(shift) {}
+
+        // Interior nodes hold pointers to their children. Leaves hold the physical address of a page with the lowest
+        // bit set, so that the page at physical address 0 can be told apart from an empty slot.
+        di::Array<di::Atomic<uptr>, PageIndex::slots_per_node> slots {};
+
+        // Bit i of the first bitmap is set when slot i is occupied. Bit i of the remaining bitmaps is set when slot i
+        // holds a page with the corresponding tag, or a child node which contains such a page.
+        di::Array<di::Atomic<u64>, 1 + page_tag_count> marks {};
+
+        // The number of page offset bits below this node's level.
+        u8 shift;
+    };
+}
+
+using Node = detail::PageIndexNode;
+
+constexpr auto present_mark = 0zu;
+
+// The depth of the tallest possible tree, which holds every 64 bit page offset.
+constexpr auto max_height = di::divide_round_up(64zu, PageIndex::bits_per_level);
+
+static usize tag_mark(PageTag tag) {
+    return 1 + usize(tag);
+}
+
+// Whether a node at the level of @p shift spans @p index, assuming it is on the leftmost path of the tree.
+static bool covers(usize shift, u64 index) {
+    auto const bits = shift + PageIndex::bits_per_level;
+    return bits >= 64 || (index >> bits) == 0;
+}
+
+// The first index spanned by the node at the level of @p shift which contains @p index.
+static u64 node_base(usize shift, u64 index) {
+    auto const bits = shift + PageIndex::bits_per_level;
+    return bits >= 64 ? 0 : (index >> bits) << bits;
+}
+
+static usize slot_index(Node const& node, u64 index) {
+    return (index >> node.shift) % PageIndex::slots_per_node;
+}
+
+static Node* child(Node const& node, usize slot) {
+    return reinterpret_cast<Node*>(node.slots[slot].load(di::MemoryOrder::Acquire));
+}
+
+// Only the owner of the index modifies the bitmaps, so a plain read-modify-write is enough. The release ordering
+// ensures lockless readers which observe the bit also observe the slot it describes.
+static void set_bit(di::Atomic<u64>& bitmap, usize bit) {
+    bitmap.store(bitmap.load(di::MemoryOrder::Relaxed) | (1_u64 << bit), di::MemoryOrder::Release);
+}
+
+static void clear_bit(di::Atomic<u64>& bitmap, usize bit) {
+    bitmap.store(bitmap.load(di::MemoryOrder::Relaxed) & ~(1_u64 << bit), di::MemoryOrder::Release);
+}
+
+static bool test_bit(di::Atomic<u64> const& bitmap, usize bit) {
+    return bitmap.load(di::MemoryOrder::Acquire) & (1_u64 << bit);
+}
+
+static Expected<Node*> allocate_node(usize shift) {
+    auto* node = new (std::nothrow) Node(u8(shift));
+    if (!node) {
+        return di::Unexpected(Error::NotEnoughMemory);
+    }
+    return node;
+}
+
+static void destroy_node(Node* node) {
+    if (node->shift > 0) {
+        for (auto bits = node->marks[present_mark].load(di::MemoryOrder::Relaxed); bits; bits &= bits - 1) {
+            destroy_node(child(*node, usize(di::countr_zero(bits))));
+        }
+    }
+    delete node;
+}
+
+// Find the first index at least @p index below @p node whose slot is marked in the bitmap @p mark.
+static di::Optional<u64> find_marked(Node const& node, u64 index, usize mark) {
+    auto const first_slot = slot_index(node, index);
+    auto bits = node.marks[mark].load(di::MemoryOrder::Acquire) & (~0_u64 << first_slot);
+    for (; bits; bits &= bits - 1) {
+        auto const slot = usize(di::countr_zero(bits));
+        auto const slot_base = node_base(node.shift, index) | (u64(slot) << node.shift);
+        if (node.shift == 0) {
+            return slot_base;
+        }
+
+        // A concurrent modification may leave a child without any marked slot, in which case the search moves on.
+        auto const* next = child(node, slot);
+        if (auto result = find_marked(*next, slot == first_slot ? index : slot_base, mark)) {
+            return result;
+        }
+    }
+    return di::nullopt;
+}
+
+PageIndex::~PageIndex() {
+    if (auto* root = m_root.load(di::MemoryOrder::Relaxed)) {
+        destroy_node(root);
+    }
+}
+
+Node const* PageIndex::leaf(u64 index) const {
+    auto const* node = m_root.load(di::MemoryOrder::Acquire);
+    if (!node || !covers(node->shift, index)) {
+        return nullptr;
+    }
+    while (node && node->shift > 0) {
+        node = child(*node, slot_index(*node, index));
+    }
+    return node;
+}
+
+Expected<Node*> PageIndex::leaf_for_insertion(u64 index) {
+    auto* root = m_root.load(di::MemoryOrder::Relaxed);
+    if (!root) {
+        auto shift = 0zu;
+        while (!covers(shift, index)) {
+            shift += bits_per_level;
+        }
+        root = TRY(allocate_node(shift));
+        m_root.store(root, di::MemoryOrder::Release);
+    }
+
+    // Grow the tree until the root spans the index, by placing the old root in the first slot of a new one. Readers
+    // which still see the old root get the same results for the indices it spans.
+    while (!covers(root->shift, index)) {
+        auto* new_root = TRY(allocate_node(root->shift + bits_per_level));
+        new_root->slots[0].store(di::to_uintptr(root), di::MemoryOrder::Relaxed);
+        new_root->marks[present_mark].store(1, di::MemoryOrder::Relaxed);
+        for (auto mark : di::range(1zu, 1 + page_tag_count)) {
+            if (root->marks[mark].load(di::MemoryOrder::Relaxed)) {
+                new_root->marks[mark].store(1, di::MemoryOrder::Relaxed);
+            }
+        }
+        m_root.store(new_root, di::MemoryOrder::Release);
+        root = new_root;
+    }
+
+    auto* node = root;
+    while (node->shift > 0) {
+        auto const slot = slot_index(*node, index);
+        auto* next = child(*node, slot);
+        if (!next) {
+            next = TRY(allocate_node(node->shift - bits_per_level));
+            node->slots[slot].store(di::to_uintptr(next), di::MemoryOrder::Release);
+            set_bit(node->marks[present_mark], slot);
+        }
+        node = next;
+    }
+    return node;
+}
+
+di::Optional<PhysicalAddress> PageIndex::lookup(u64 index) const {
+    auto const* node = leaf(index);
+    if (!node) {
+        return di::nullopt;
+    }
+    auto const value = node->slots[slot_index(*node, index)].load(di::MemoryOrder::Acquire);
+    if (!value) {
+        return di::nullopt;
+    }
+    return PhysicalAddress(value & ~1_u64);
+}
+
+usize PageIndex::lookup_range(u64 first_index, di::Span<PhysicalAddress> pages) const {
+    // Walk down the tree once per leaf, instead of once per page.
+    auto count = 0zu;
+    while (count < pages.size()) {
+        auto const index = first_index + count;
+        auto const* node = leaf(index);
+        if (!node) {
+            break;
+        }
+        for (auto slot = slot_index(*node, index); slot < slots_per_node && count < pages.size(); slot++) {
+            auto const value = node->slots[slot].load(di::MemoryOrder::Acquire);
+            if (!value) {
+                return count;
+            }
+            pages[count++] = PhysicalAddress(value & ~1_u64);
+        }
+    }
+    return count;
+}
+
+di::Optional<u64> PageIndex::find_next(u64 index) const {
+    auto const* root = m_root.load(di::MemoryOrder::Acquire);
+    if (!root || !covers(root->shift, index)) {
+        return di::nullopt;
+    }
+    return find_marked(*root, index, present_mark);
+}
+
+di::Optional<u64> PageIndex::find_next_tagged(u64 index, PageTag tag) const {
+    auto const* root = m_root.load(di::MemoryOrder::Acquire);
+    if (!root || !covers(root->shift, index)) {
+        return di::nullopt;
+    }
+    return find_marked(*root, index, tag_mark(tag));
+}
+
+Expected<void> PageIndex::insert(u64 index, PhysicalAddress address) {
+    ASSERT(address.raw_value() % 4096 == 0);
+
+    auto* node = TRY(leaf_for_insertion(index));
+    auto const slot = slot_index(*node, index);
+    ASSERT(!node->slots[slot].load(di::MemoryOrder::Relaxed));
+
+    node->slots[slot].store(address.raw_value() | 1, di::MemoryOrder::Release);
+    set_bit(node->marks[present_mark], slot);
+    m_size++;
+    return {};
+}
+
+Expected<void> PageIndex::reserve(u64 first_index, u64 count) {
+    for (auto offset = 0_u64; offset < count;) {
+        auto const index = first_index + offset;
+        TRY(leaf_for_insertion(index));
+
+        auto const next_leaf = node_base(0, index) + slots_per_node;
+        if (next_leaf == 0) {
+            break;
+        }
+        offset = next_leaf - first_index;
+    }
+    return {};
+}
+
+void PageIndex::set_tag(u64 index, PageTag tag) {
+    // Tag every node on the path to the page, so that searches can skip subtrees which have no tagged pages.
+    auto* node = m_root.load(di::MemoryOrder::Relaxed);
+    ASSERT(node && covers(node->shift, index));
+    for (;;) {
+        auto const slot = slot_index(*node, index);
+        ASSERT(test_bit(node->marks[present_mark], slot));
+        set_bit(node->marks[tag_mark(tag)], slot);
+        if (node->shift == 0) {
+            return;
+        }
+        node = child(*node, slot);
+    }
+}
+
+void PageIndex::clear_tag(u64 index, PageTag tag) {
+    auto path = di::Array<Node*, max_height> {};
+    auto depth = 0zu;
+    auto* node = m_root.load(di::MemoryOrder::Relaxed);
+    if (!node || !covers(node->shift, index)) {
+        return;
+    }
+    for (;;) {
+        path[depth++] = node;
+        if (node->shift == 0) {
+            break;
+        }
+        node = child(*node, slot_index(*node, index));
+        if (!node) {
+            return;
+        }
+    }
+
+    // Parents stay tagged as long as one of their other slots still has a tagged page.
+    auto const mark = tag_mark(tag);
+    for (auto i = depth; i > 0; i--) {
+        auto& current = *path[i - 1];
+        clear_bit(current.marks[mark], slot_index(current, index));
+        if (current.marks[mark].load(di::MemoryOrder::Relaxed) != 0) {
+            break;
+        }
+    }
+}
+
+bool PageIndex::has_tag(u64 index, PageTag tag) const {
+    auto const* node = leaf(index);
+    return node && test_bit(node->marks[tag_mark(tag)], slot_index(*node, index));
+}
+}
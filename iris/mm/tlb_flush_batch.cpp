@@ -0,0 +1,46 @@
+#include <di/math/prelude.h>
+#include <iris/mm/tlb_flush_batch.h>
+
+namespace iris::mm {
+void TlbFlushBatch::add(VirtualAddress base, usize byte_length) {
+    if (m_flush_everything || byte_length == 0) {
+        return;
+    }
+
+    auto first_page = VirtualAddress(di::align_down(base.raw_value(), 4096));
+    auto page_count = di::divide_round_up(base.raw_value() % 4096 + byte_length, 4096);
+
+    m_page_count += page_count;
+    if (m_page_count > max_pages) {
+        return add_everything();
+    }
+
+    // Merge with the previous range when the pages are contiguous, which is the common case when a caller walks a
+    // region page by page.
+    if (m_range_count > 0) {
+        auto& last = m_ranges[m_range_count - 1];
+        if (last.base + last.page_count * 4096 == first_page) {
+            last.page_count += page_count;
+            return;
+        }
+    }
+
+    if (m_range_count == max_ranges) {
+        return add_everything();
+    }
+    m_ranges[m_range_count++] = { first_page, page_count };
+}
+
+void TlbFlushBatch::add_everything() {
+    m_flush_everything = true;
+    m_range_count = 0;
+    m_page_count = 0;
+}
+
+void TlbFlushBatch::clear() {
+    m_flush_everything = false;
+    m_kernel = false;
+    m_range_count = 0;
+    m_page_count = 0;
+}
+}
@@ -1,6 +1,14 @@
 #include <di/math/prelude.h>
+#include <dius/filesystem/prelude.h>
+#include <dius/print.h>
 #include <dius/system/system_call.h>
 #include <dius/test/prelude.h>
+#include <iris/uapi/futex.h>
+#include <iris/uapi/io_vector.h>
+#include <iris/uapi/map_file.h>
+#include <iris/uapi/open.h>
+#include <iris/uapi/scheduling.h>
+#include <iris/uapi/statistics.h>
 
 static void allocate_memory() {
     auto x = dius::system::system_call<uptr>(dius::system::Number::allocate_memory, 4096);
@@ -30,5 +38,348 @@ static void fault() {
     ASSERT_EQ(w, di::Unexpected(di::BasicError::BadAddress));
 }
 
+static void statistics() {
+    auto kinds = di::Array { iris::StatisticsKind::Heap, iris::StatisticsKind::Memory, iris::StatisticsKind::Tasks,
+                             iris::StatisticsKind::Locks };
+    for (auto kind : kinds) {
+        auto fd = dius::system::system_call<i32>(dius::system::Number::open_statistics, di::to_underlying(kind));
+        ASSERT(fd);
+
+        auto buffer = di::Array<byte, 4096> {};
+        auto nread = dius::system::system_call<usize>(dius::system::Number::read, *fd, buffer.data(), buffer.size());
+        ASSERT(nread);
+        ASSERT_GT(*nread, 0u);
+
+        ASSERT(dius::system::system_call<i32>(dius::system::Number::close, *fd));
+    }
+
+    auto invalid = dius::system::system_call<i32>(dius::system::Number::open_statistics, 1000);
+    ASSERT_EQ(invalid, di::Unexpected(di::BasicError::InvalidArgument));
+    auto truncated = dius::system::system_call<i32>(dius::system::Number::open_statistics, 1_u64 << 32);
+    ASSERT_EQ(truncated, di::Unexpected(di::BasicError::InvalidArgument));
+}
+
+static void map_file() {
+    auto path = "/tmp/map_file_test"_tsv;
+    auto fd = dius::system::system_call<i32>(dius::system::Number::open, path.data(), path.size(),
+                                             di::to_underlying(iris::OpenMode::Create));
+    ASSERT(fd);
+
+    auto contents = di::Array<u8, 8192> {};
+    for (auto i : di::range(contents.size())) {
+        contents[i] = u8(i % 251);
+    }
+    auto nwritten =
+        dius::system::system_call<usize>(dius::system::Number::write, *fd, contents.data(), contents.size());
+    ASSERT_EQ(nwritten, contents.size());
+
+    // A read-only mapping sees the file contents, starting at the requested offset.
+    auto shared = dius::system::system_call<uptr>(dius::system::Number::map_file, *fd, 4096, 4096,
+                                                  di::to_underlying(iris::MapFileFlags::None));
+    ASSERT(shared);
+    auto const* shared_bytes = reinterpret_cast<u8 const*>(*shared);
+    for (auto i : di::range(4096zu)) {
+        ASSERT_EQ(shared_bytes[i], contents[4096 + i]);
+    }
+
+    // Writes to a private mapping are not visible to the file or to other mappings.
+    auto copy = dius::system::system_call<uptr>(dius::system::Number::map_file, *fd, 0, contents.size(),
+                                                di::to_underlying(iris::MapFileFlags::Private));
+    ASSERT(copy);
+    auto* copy_bytes = reinterpret_cast<u8*>(*copy);
+    ASSERT_EQ(copy_bytes[4096], contents[4096]);
+    copy_bytes[4096] = u8(0xFF);
+    ASSERT_EQ(copy_bytes[4096], u8(0xFF));
+    ASSERT_EQ(shared_bytes[0], contents[4096]);
+
+    // Mappings must be page aligned and lie within the file.
+    auto unaligned = dius::system::system_call<uptr>(dius::system::Number::map_file, *fd, 100, 4096,
+                                                     di::to_underlying(iris::MapFileFlags::None));
+    ASSERT_EQ(unaligned, di::Unexpected(di::BasicError::InvalidArgument));
+    auto too_long = dius::system::system_call<uptr>(dius::system::Number::map_file, *fd, 4096, 8192,
+                                                    di::to_underlying(iris::MapFileFlags::None));
+    ASSERT_EQ(too_long, di::Unexpected(di::BasicError::InvalidArgument));
+
+    ASSERT(dius::system::system_call<i32>(dius::system::Number::close, *fd));
+}
+
+// The name is ASCII, so the formatted UTF-8 string can be reused as a transparent string.
+static di::TransparentString numbered_file_name(usize index) {
+    auto name = *di::present("file{}"_sv, index);
+    return di::TransparentStringView(reinterpret_cast<char const*>(name.data()), name.size_code_units()).to_owned();
+}
+
+static void large_directory() {
+    constexpr auto file_count = 2000zu;
+    auto directory = "/tmp/large_directory_test"_pv;
+    ASSERT_EQ(dius::filesystem::create_directory(directory), true);
+
+    for (auto i : di::range(file_count)) {
+        auto name = numbered_file_name(i);
+        ASSERT_EQ(dius::filesystem::create_regular_file(directory.to_owned() / di::PathView(name)), true);
+    }
+    ASSERT_EQ(dius::filesystem::create_regular_file(directory.to_owned() / "file0"_pv), false);
+    ASSERT_EQ(dius::filesystem::is_regular_file(directory.to_owned() / "file1999"_pv), true);
+    ASSERT_EQ(dius::filesystem::exists(directory.to_owned() / "file2000"_pv), false);
+
+    // Every entry is listed exactly once, in the order it was created.
+    auto count = 0zu;
+    for (auto entry : *dius::filesystem::DirectoryIterator::create(directory.to_owned())) {
+        ASSERT(entry);
+        ASSERT_EQ(entry->path_view().filename(), numbered_file_name(count).view());
+        count++;
+    }
+    ASSERT_EQ(count, file_count);
+}
+
+constexpr auto file_io_size = 4_u64 * 1024 * 1024;
+constexpr auto file_io_chunk_size = 64_u64 * 1024;
+constexpr auto file_io_random_operations = 1024_u64;
+
+static auto file_io_buffer = di::Array<u8, file_io_chunk_size> {};
+
+static i64 file_io_now() {
+    return *dius::system::system_call<i64>(dius::system::Number::monotonic_time);
+}
+
+// The throughput in MiB/s of transferring @p bytes in @p nanoseconds.
+static u64 file_io_throughput(u64 bytes, i64 nanoseconds) {
+    return bytes * 1'000'000'000 / u64(di::max(nanoseconds, 1_i64)) / (1024 * 1024);
+}
+
+static void file_io() {
+    auto path = "/tmp/file_io_test"_tsv;
+    auto fd = dius::system::system_call<i32>(dius::system::Number::open, path.data(), path.size(),
+                                             di::to_underlying(iris::OpenMode::Create));
+    ASSERT(fd);
+
+    auto seek = [&](u64 offset) {
+        ASSERT_EQ(dius::system::system_call<u64>(dius::system::Number::lseek, *fd, offset, 0), offset);
+    };
+    auto transfer = [&](dius::system::Number number, u64 size) {
+        ASSERT_EQ(dius::system::system_call<usize>(number, *fd, file_io_buffer.data(), size), size);
+    };
+    auto transfer_at = [&](dius::system::Number number, u64 offset) {
+        ASSERT_EQ(dius::system::system_call<usize>(number, *fd, file_io_buffer.data(), 4096, offset), 4096u);
+    };
+
+    auto start = file_io_now();
+    for (auto offset = 0_u64; offset < file_io_size; offset += file_io_chunk_size) {
+        di::fill(file_io_buffer, u8(offset / file_io_chunk_size));
+        transfer(dius::system::Number::write, file_io_chunk_size);
+    }
+    auto sequential_write = file_io_now() - start;
+
+    seek(0);
+    start = file_io_now();
+    for (auto offset = 0_u64; offset < file_io_size; offset += file_io_chunk_size) {
+        transfer(dius::system::Number::read, file_io_chunk_size);
+        ASSERT_EQ(file_io_buffer[0], u8(offset / file_io_chunk_size));
+        ASSERT_EQ(file_io_buffer[file_io_chunk_size - 1], u8(offset / file_io_chunk_size));
+    }
+    auto sequential_read = file_io_now() - start;
+
+    // Random accesses use 4 KiB blocks at offsets from a linear congruential generator.
+    auto random_offset = [state = 1_u64]() mutable {
+        state = state * 6364136223846793005_u64 + 1442695040888963407_u64;
+        return (state >> 33) % (file_io_size / 4096) * 4096;
+    };
+    start = file_io_now();
+    for (auto i = 0_u64; i < file_io_random_operations; i++) {
+        auto offset = random_offset();
+        transfer_at(dius::system::Number::pread, offset);
+        ASSERT_EQ(file_io_buffer[0], u8(offset / file_io_chunk_size));
+    }
+    auto random_read = file_io_now() - start;
+
+    start = file_io_now();
+    for (auto i = 0_u64; i < file_io_random_operations; i++) {
+        transfer_at(dius::system::Number::pwrite, random_offset());
+    }
+    auto random_write = file_io_now() - start;
+
+    dius::println("file_io.throughput: sequential_write_mib_s={} sequential_read_mib_s={} random_read_mib_s={} "
+                  "random_write_mib_s={}"_sv,
+                  file_io_throughput(file_io_size, sequential_write), file_io_throughput(file_io_size, sequential_read),
+                  file_io_throughput(file_io_random_operations * 4096, random_read),
+                  file_io_throughput(file_io_random_operations * 4096, random_write));
+
+    ASSERT(dius::system::system_call<i32>(dius::system::Number::close, *fd));
+}
+
+static void vectored_io() {
+    auto path = "/tmp/vectored_io_test"_tsv;
+    auto fd = dius::system::system_call<i32>(dius::system::Number::open, path.data(), path.size(),
+                                             di::to_underlying(iris::OpenMode::Create));
+    ASSERT(fd);
+
+    // A gathered write writes each buffer in order.
+    auto first = di::Array<u8, 3> { 1, 2, 3 };
+    auto second = di::Array<u8, 5> { 4, 5, 6, 7, 8 };
+    auto write_vectors = di::Array {
+        iris::IoVector { first.data(), first.size() },
+        iris::IoVector { second.data(), second.size() },
+    };
+    ASSERT_EQ(dius::system::system_call<usize>(dius::system::Number::writev, *fd, write_vectors.data(), 2), 8u);
+
+    // Positional I/O neither uses nor moves the file offset, which stays at the end of the file.
+    auto patch = di::Array<u8, 2> { 9, 9 };
+    ASSERT_EQ(dius::system::system_call<usize>(dius::system::Number::pwrite, *fd, patch.data(), patch.size(), 2), 2u);
+    auto contents = di::Array<u8, 8> {};
+    ASSERT_EQ(dius::system::system_call<usize>(dius::system::Number::pread, *fd, contents.data(), contents.size(), 0),
+              8u);
+    ASSERT_EQ(contents, (di::Array<u8, 8> { 1, 2, 9, 9, 5, 6, 7, 8 }));
+    ASSERT_EQ(dius::system::system_call<usize>(dius::system::Number::read, *fd, contents.data(), 1), 0u);
+
+    // A scattered read fills each buffer in order, and stops at the end of the file.
+    ASSERT_EQ(dius::system::system_call<u64>(dius::system::Number::lseek, *fd, 0, 0), 0u);
+    auto head = di::Array<u8, 4> {};
+    auto tail = di::Array<u8, 8> {};
+    auto read_vectors = di::Array {
+        iris::IoVector { head.data(), head.size() },
+        iris::IoVector { tail.data(), tail.size() },
+    };
+    ASSERT_EQ(dius::system::system_call<usize>(dius::system::Number::readv, *fd, read_vectors.data(), 2), 8u);
+    ASSERT_EQ(head, (di::Array<u8, 4> { 1, 2, 9, 9 }));
+    ASSERT_EQ(tail[0], 5);
+    ASSERT_EQ(tail[3], 8);
+
+    // Every buffer is validated before any data is transferred.
+    auto bad_vectors = di::Array {
+        iris::IoVector { head.data(), head.size() },
+        iris::IoVector { reinterpret_cast<void*>(0xFFFF800000000000_u64), 4 },
+    };
+    ASSERT_EQ(dius::system::system_call<usize>(dius::system::Number::writev, *fd, bad_vectors.data(), 2),
+              di::Unexpected(di::BasicError::BadAddress));
+    ASSERT_EQ(dius::system::system_call<usize>(dius::system::Number::readv, *fd, read_vectors.data(),
+                                               iris::io_vector_max_count + 1),
+              di::Unexpected(di::BasicError::InvalidArgument));
+
+    // Offsets must fit in a signed 64 bit integer, and must not wrap around when advanced by the transfer.
+    ASSERT_EQ(dius::system::system_call<usize>(dius::system::Number::pread, *fd, contents.data(), contents.size(),
+                                               u64(-1)),
+              di::Unexpected(di::BasicError::InvalidArgument));
+    ASSERT_EQ(dius::system::system_call<usize>(dius::system::Number::pwrite, *fd, patch.data(), patch.size(),
+                                               u64(di::NumericLimits<i64>::max)),
+              di::Unexpected(di::BasicError::FileTooLarge));
+
+    // SyncFile's offset based reads and writes use the positional system calls.
+    auto file = dius::SyncFile(dius::SyncFile::Owned::Yes, *fd);
+    auto bytes = di::Array<byte, 2> {};
+    ASSERT(file.write_exactly(0, di::Array { byte(7), byte(7) }.span()));
+    ASSERT(file.read_exactly(1, bytes.span()));
+    ASSERT_EQ(bytes, (di::Array { byte(7), byte(9) }));
+}
+
+static void set_scheduling_class() {
+    // Task id 0 refers to the calling task.
+    auto const calling_task = 0;
+    auto fair = di::to_underlying(iris::SchedulingClass::Fair);
+    ASSERT(dius::system::system_call<i32>(dius::system::Number::set_scheduling_class, calling_task, fair, 5));
+    ASSERT(dius::system::system_call<i32>(dius::system::Number::set_scheduling_class, calling_task, fair, 0));
+
+    auto invalid_class =
+        dius::system::system_call<i32>(dius::system::Number::set_scheduling_class, calling_task, 1000, 0);
+    ASSERT_EQ(invalid_class, di::Unexpected(di::BasicError::InvalidArgument));
+    auto invalid_nice = dius::system::system_call<i32>(dius::system::Number::set_scheduling_class, calling_task, fair,
+                                                       iris::max_nice_value + 1);
+    ASSERT_EQ(invalid_nice, di::Unexpected(di::BasicError::InvalidArgument));
+
+    // Values which only become valid once truncated to 32 bits are rejected too.
+    auto truncated_class =
+        dius::system::system_call<i32>(dius::system::Number::set_scheduling_class, calling_task, 1_u64 << 32, 0);
+    ASSERT_EQ(truncated_class, di::Unexpected(di::BasicError::InvalidArgument));
+    auto truncated_nice = dius::system::system_call<i32>(dius::system::Number::set_scheduling_class, calling_task,
+                                                         fair, (1_u64 << 32) + 5);
+    ASSERT_EQ(truncated_nice, di::Unexpected(di::BasicError::InvalidArgument));
+
+    auto real_time = dius::system::system_call<i32>(dius::system::Number::set_scheduling_class, calling_task,
+                                                    di::to_underlying(iris::SchedulingClass::RealTimeFifo), 0);
+    ASSERT_EQ(real_time, di::Unexpected(di::BasicError::OperationNotPermitted));
+}
+
+static void sleep() {
+    auto start = dius::system::system_call<i64>(dius::system::Number::monotonic_time);
+    ASSERT(start);
+
+    ASSERT(dius::system::system_call<i32>(dius::system::Number::sleep_for, 10'000'000));
+    auto end = dius::system::system_call<i64>(dius::system::Number::monotonic_time);
+    ASSERT(end);
+    ASSERT_GT_EQ(*end - *start, 10'000'000);
+
+    ASSERT(dius::system::system_call<i32>(dius::system::Number::sleep_until, *end - 1));
+
+    auto negative = dius::system::system_call<i32>(dius::system::Number::sleep_for, -1);
+    ASSERT_EQ(negative, di::Unexpected(di::BasicError::InvalidArgument));
+}
+
+static void futex() {
+    auto word = 1_u32;
+
+    auto mismatch =
+        dius::system::system_call<i32>(dius::system::Number::futex_wait, &word, 0, iris::futex_wait_forever);
+    ASSERT_EQ(mismatch, di::Unexpected(di::BasicError::ResourceUnavailableTryAgain));
+
+    auto timed_out = dius::system::system_call<i32>(dius::system::Number::futex_wait, &word, 1, 1'000'000);
+    ASSERT_EQ(timed_out, di::Unexpected(di::BasicError::TimedOut));
+
+    ASSERT_EQ(dius::system::system_call<u32>(dius::system::Number::futex_wake, &word, 1), 0u);
+
+    auto misaligned = dius::system::system_call<i32>(dius::system::Number::futex_wake,
+                                                     reinterpret_cast<byte*>(&word) + 1, 1);
+    ASSERT_EQ(misaligned, di::Unexpected(di::BasicError::InvalidArgument));
+}
+
+static void fpu_state() {
+    // Sleeping switches to another task and back, which must not lose the contents of the vector registers.
+    auto value = 0x0123'4567'89ab'cdef_u64;
+    asm volatile("movq %0, %%xmm15" : : "r"(value) : "xmm15");
+
+    ASSERT(dius::system::system_call<i32>(dius::system::Number::sleep_for, 1'000'000));
+    ASSERT(dius::system::system_call<i32>(dius::system::Number::sleep_for, 1'000'000));
+
+    auto result = 0_u64;
+    asm volatile("movq %%xmm15, %0" : "=r"(result));
+    ASSERT_EQ(result, value);
+}
+
+constexpr auto latency_iterations = 100'000_i64;
+
+template<typename F>
+static i64 measure_latency(F do_system_call) {
+    auto start = *dius::system::system_call<i64>(dius::system::Number::monotonic_time);
+    for (auto i = 0_i64; i < latency_iterations; i++) {
+        do_system_call();
+    }
+    auto end = *dius::system::system_call<i64>(dius::system::Number::monotonic_time);
+    return (end - start) / latency_iterations;
+}
+
+static void latency() {
+    // The monotonic_time system call does almost no work, so this measures the cost of entering and leaving the kernel.
+    auto number = u64(di::to_underlying(dius::system::Number::monotonic_time));
+    auto interrupt_latency = measure_latency([&] {
+        auto result = number;
+        asm volatile("int $0x80" : "+a"(result) : : "rdx", "memory", "cc");
+    });
+    auto syscall_latency = measure_latency([] {
+        (void) dius::system::system_call<i64>(dius::system::Number::monotonic_time);
+    });
+
+    dius::println("syscall.latency: int80_ns={} syscall_ns={}"_sv, interrupt_latency, syscall_latency);
+    ASSERT_GT(interrupt_latency, 0);
+    ASSERT_GT(syscall_latency, 0);
+}
+
 TEST(syscall, allocate_memory)
 TEST(syscall, fault)
+TEST(syscall, statistics)
+TEST(syscall, map_file)
+TEST(syscall, large_directory)
+TEST(syscall, file_io)
+TEST(syscall, vectored_io)
+TEST(syscall, set_scheduling_class)
+TEST(syscall, sleep)
+TEST(syscall, futex)
+TEST(syscall, fpu_state)
+TEST(syscall, latency)
@@ -1,6 +1,13 @@
+#include <di/math/prelude.h>
 #include <di/sync/prelude.h>
+#include <iris/core/preemption.h>
 #include <iris/core/unit_test.h>
 #include <iris/mm/address_space.h>
+#include <iris/mm/heap.h>
+#include <iris/mm/map_physical_address.h>
+#include <iris/mm/memory_statistics.h>
+#include <iris/mm/page_frame_allocator.h>
+#include <iris/mm/page_operations.h>
 
 static void basic() {
     int* x = new (std::nothrow) int;
@@ -11,3 +18,329 @@ static void basic() {
 }
 
 TEST(allocation, basic)
+
+static void reuse() {
+    // Freed objects go into the per-processor magazine, so they should be handed out again immediately.
+    iris::with_preemption_disabled([] {
+        auto* x = new (std::nothrow) di::Array<u64, 5>;
+        ASSERT(x);
+        delete x;
+
+        auto* y = new (std::nothrow) di::Array<u64, 5>;
+        ASSERT_EQ(x, y);
+        delete y;
+    });
+
+    // Allocating and freeing many objects should not leak slabs.
+    auto objects = di::Array<di::Array<u64, 8>*, 1024> {};
+    auto before = iris::mm::heap_statistics();
+    for (auto& object : objects) {
+        object = new (std::nothrow) di::Array<u64, 8>;
+        ASSERT(object);
+        object->fill(42);
+    }
+    for (auto* object : objects) {
+        ASSERT_EQ((*object)[7], 42u);
+        delete object;
+    }
+    auto after = iris::mm::heap_statistics();
+    for (auto [a, b] : di::zip(before.size_classes, after.size_classes)) {
+        ASSERT_EQ(a.allocated_objects, b.allocated_objects);
+    }
+}
+
+TEST(allocation, reuse)
+
+static void large() {
+    auto before = iris::mm::heap_statistics();
+
+    auto* x = new (std::nothrow) di::Array<byte, 3 * 4096 + 1>;
+    ASSERT(x);
+    x->fill(byte(1));
+
+    auto during = iris::mm::heap_statistics();
+    ASSERT_EQ(during.large_allocations, before.large_allocations + 1);
+    ASSERT_EQ(during.large_allocation_pages, before.large_allocation_pages + 4);
+
+    delete x;
+
+    auto after = iris::mm::heap_statistics();
+    ASSERT_EQ(after.large_allocations, before.large_allocations);
+    ASSERT_EQ(after.large_allocation_pages, before.large_allocation_pages);
+}
+
+TEST(allocation, large)
+
+static void page_frames() {
+    auto a = iris::mm::allocate_page_frame();
+    auto b = iris::mm::allocate_page_frame();
+    ASSERT(a);
+    ASSERT(b);
+    ASSERT_NOT_EQ(*a, *b);
+    ASSERT_EQ(a->raw_value() % 4096, 0u);
+
+    // Contiguous allocations which are not a power of 2 in size should still be naturally aligned to the block they
+    // were split from.
+    auto c = iris::mm::allocate_physically_contiguous_page_frames(5);
+    ASSERT(c);
+    ASSERT_EQ(c->raw_value() % (8 * 4096), 0u);
+
+    iris::mm::deallocate_page_frame(*a);
+    iris::mm::deallocate_page_frame(*b);
+    for (auto i : di::range(5zu)) {
+        iris::mm::deallocate_page_frame(*c + i * 4096);
+    }
+}
+
+TEST(allocation, page_frames)
+
+static void demand_paging() {
+    auto address_space = *iris::mm::create_empty_user_address_space();
+    auto object = *di::make_arc<iris::mm::BackingObject>();
+    auto flags = iris::mm::RegionFlags::User | iris::mm::RegionFlags::Readable | iris::mm::RegionFlags::Writable;
+    auto base = *address_space->allocate_region(di::move(object), 4 * 4096, flags);
+
+    // Userspace regions should not be populated until they are accessed.
+    ASSERT_EQ(address_space->resident_pages(), 0u);
+    ASSERT(!address_space->lock()->translate(base));
+
+    using iris::mm::PageFaultFlags;
+    ASSERT(address_space->handle_page_fault(base + 4096zu + 8zu, PageFaultFlags::Write | PageFaultFlags::User));
+    ASSERT_EQ(address_space->resident_pages(), 1u);
+    ASSERT(address_space->lock()->translate(base + 4096zu));
+    ASSERT(!address_space->lock()->translate(base));
+
+    // Faults outside of any region, or on pages which are already present, cannot be resolved.
+    ASSERT(!address_space->handle_page_fault(base + 4 * 4096zu, PageFaultFlags::User));
+    ASSERT(!address_space->handle_page_fault(base + 4096zu, PageFaultFlags::Present | PageFaultFlags::User));
+}
+
+TEST(allocation, demand_paging)
+
+static u64& page_word(iris::mm::AddressSpace& address_space, iris::mm::VirtualAddress address) {
+    auto page = *address_space.lock()->translate(address);
+    return (*iris::mm::map_physical_address(page, 4096)).typed<u64>();
+}
+
+static void copy_on_write() {
+    using iris::mm::PageFaultFlags;
+
+    auto parent = *iris::mm::create_empty_user_address_space();
+    auto object = *di::make_arc<iris::mm::BackingObject>();
+    auto flags = iris::mm::RegionFlags::User | iris::mm::RegionFlags::Readable | iris::mm::RegionFlags::Writable;
+    auto base = *parent->allocate_region(di::move(object), 2 * 4096, flags);
+
+    ASSERT(parent->handle_page_fault(base, PageFaultFlags::Write | PageFaultFlags::User));
+    page_word(*parent, base) = 42;
+
+    // The clone starts out empty, and shares the parent's pages when reading.
+    auto child = *parent->clone();
+    ASSERT_EQ(child->resident_pages(), 0u);
+    ASSERT(child->handle_page_fault(base, PageFaultFlags::User));
+    ASSERT_EQ(child->lock()->translate(base), parent->lock()->translate(base));
+
+    // Writing to the page gives the child its own copy.
+    ASSERT(child->handle_page_fault(base, PageFaultFlags::Present | PageFaultFlags::Write | PageFaultFlags::User));
+    ASSERT_NOT_EQ(child->lock()->translate(base), parent->lock()->translate(base));
+    ASSERT_EQ(page_word(*child, base), 42u);
+    page_word(*child, base) = 7;
+    ASSERT_EQ(page_word(*parent, base), 42u);
+
+    // The parent's mapping was write protected, so it also needs to copy the page before writing to it.
+    auto old_page = parent->lock()->translate(base);
+    ASSERT(parent->handle_page_fault(base, PageFaultFlags::Present | PageFaultFlags::Write | PageFaultFlags::User));
+    ASSERT_NOT_EQ(parent->lock()->translate(base), old_page);
+    ASSERT_EQ(page_word(*parent, base), 42u);
+    ASSERT_EQ(parent->resident_pages(), 1u);
+}
+
+TEST(allocation, copy_on_write)
+
+static void copy_on_write_sole_owner() {
+    using iris::mm::PageFaultFlags;
+
+    auto parent = *iris::mm::create_empty_user_address_space();
+    auto object = *di::make_arc<iris::mm::BackingObject>();
+    auto flags = iris::mm::RegionFlags::User | iris::mm::RegionFlags::Readable | iris::mm::RegionFlags::Writable;
+    auto base = *parent->allocate_region(di::move(object), 4096, flags);
+
+    ASSERT(parent->handle_page_fault(base, PageFaultFlags::Write | PageFaultFlags::User));
+    page_word(*parent, base) = 42;
+
+    // Once the clone is gone, nothing else can see the page, so writing to it does not need a copy. Cloning repeatedly
+    // must keep working, since each clone collapses the chain left behind by the previous one.
+    auto page = parent->lock()->translate(base);
+    for (auto i : di::range(4)) {
+        {
+            auto child = *parent->clone();
+            ASSERT(child->handle_page_fault(base, PageFaultFlags::User));
+            ASSERT_EQ(child->lock()->translate(base), page);
+        }
+
+        ASSERT(parent->handle_page_fault(base, PageFaultFlags::Present | PageFaultFlags::Write | PageFaultFlags::User));
+        ASSERT_EQ(parent->lock()->translate(base), page);
+        ASSERT_EQ(page_word(*parent, base), u64(42 + i));
+        page_word(*parent, base) = 42 + i + 1;
+    }
+}
+
+TEST(allocation, copy_on_write_sole_owner)
+
+static void tlb_flush_batch() {
+    auto batch = iris::mm::TlbFlushBatch {};
+    ASSERT(batch.empty());
+
+    // Contiguous ranges are merged, and partial pages are rounded out.
+    batch.add(iris::mm::VirtualAddress(0x10000), 4096);
+    batch.add(iris::mm::VirtualAddress(0x11000), 4097);
+    ASSERT_EQ(batch.ranges().size(), 1u);
+    ASSERT_EQ(batch.ranges()[0].page_count, 3u);
+
+    batch.add(iris::mm::VirtualAddress(0x20800), 4096);
+    ASSERT_EQ(batch.ranges().size(), 2u);
+    ASSERT_EQ(batch.ranges()[1].base, iris::mm::VirtualAddress(0x20000));
+    ASSERT_EQ(batch.ranges()[1].page_count, 2u);
+
+    // Too many pages degrade to a full flush.
+    batch.add(iris::mm::VirtualAddress(0x100000), iris::mm::TlbFlushBatch::max_pages * 4096);
+    ASSERT(batch.flush_everything());
+    ASSERT(batch.ranges().empty());
+
+    // Clearing also forgets that the batch contained kernel mappings, since batches are reused.
+    batch.set_kernel();
+    batch.clear();
+    ASSERT(batch.empty());
+    ASSERT(!batch.kernel());
+
+    // So do too many distinct ranges.
+    for (auto i : di::range(iris::mm::TlbFlushBatch::max_ranges + 1)) {
+        batch.add(iris::mm::VirtualAddress(0x100000 + i * 0x10000), 4096);
+    }
+    ASSERT(batch.flush_everything());
+}
+
+TEST(allocation, tlb_flush_batch)
+
+static void large_pages() {
+    using iris::mm::PageFaultFlags;
+    using iris::mm::large_page_size;
+
+    auto parent = *iris::mm::create_empty_user_address_space();
+    auto object = *di::make_arc<iris::mm::BackingObject>();
+    auto flags = iris::mm::RegionFlags::User | iris::mm::RegionFlags::Readable | iris::mm::RegionFlags::Writable;
+    auto base = *parent->allocate_region(di::move(object), 2 * large_page_size, flags);
+
+    // Faulting anywhere in a fully covered, aligned chunk maps the whole chunk with a single large page.
+    auto large_page = iris::mm::VirtualAddress(di::align_up(base.raw_value(), large_page_size));
+    ASSERT(parent->handle_page_fault(large_page + 4096zu, PageFaultFlags::Write | PageFaultFlags::User));
+    ASSERT_EQ(parent->mapped_2mib_pages(), 1u);
+    ASSERT_EQ(parent->resident_pages(), large_page_size / 4096);
+    ASSERT_EQ(*parent->lock()->translate(large_page + 4096zu), *parent->lock()->translate(large_page) + 4096zu);
+    ASSERT_EQ(page_word(*parent, large_page + 4096zu), 0u);
+    page_word(*parent, large_page + 4096zu) = 42;
+
+    // Breaking copy-on-write sharing of one page splits the large page.
+    auto child = *parent->clone();
+    ASSERT(parent->handle_page_fault(large_page + 4096zu,
+                                     PageFaultFlags::Present | PageFaultFlags::Write | PageFaultFlags::User));
+    ASSERT_EQ(parent->mapped_2mib_pages(), 0u);
+    ASSERT_EQ(parent->mapped_4kib_pages(), large_page_size / 4096);
+    ASSERT_EQ(page_word(*parent, large_page + 4096zu), 42u);
+
+    ASSERT(child->handle_page_fault(large_page + 4096zu, PageFaultFlags::User));
+    ASSERT_EQ(page_word(*child, large_page + 4096zu), 42u);
+    ASSERT_EQ(child->mapped_2mib_pages(), 0u);
+}
+
+TEST(allocation, large_pages)
+
+static void region_allocation() {
+    auto address_space = *iris::mm::create_empty_user_address_space();
+    auto flags = iris::mm::RegionFlags::User | iris::mm::RegionFlags::Readable | iris::mm::RegionFlags::Writable;
+    auto allocate = [&](usize length) {
+        return *address_space->allocate_region(*di::make_arc<iris::mm::BackingObject>(), length, flags);
+    };
+
+    auto a = allocate(4 * 4096);
+    auto b = allocate(8 * 4096);
+    auto c = allocate(4 * 4096);
+    ASSERT_LT(a + 4 * 4096zu, b);
+    ASSERT_LT(b + 8 * 4096zu, c);
+
+    // Address space freed by destroying a region is reused by later allocations.
+    ASSERT(address_space->lock()->destroy_region(b, 8 * 4096));
+    ASSERT_EQ(allocate(2 * 4096), b);
+    ASSERT_EQ(allocate(2 * 4096), b + 3 * 4096zu);
+
+    // Regions large enough to hold a large page are aligned so that they can be mapped with large pages.
+    auto large = allocate(iris::mm::large_page_size);
+    ASSERT_EQ(large.raw_value() % iris::mm::large_page_size, 0u);
+
+    // Regions cannot be placed on top of existing ones.
+    auto region = *di::make_box<iris::mm::Region>(a + 4096zu, 4096, flags);
+    ASSERT(!address_space->lock()->allocate_region_at(*di::make_arc<iris::mm::BackingObject>(), di::move(region)));
+}
+
+TEST(allocation, region_allocation)
+
+static void page_operations() {
+    auto source = *iris::mm::allocate_page_frame();
+    auto destination = *iris::mm::allocate_page_frame();
+
+    auto& source_data = (*iris::mm::map_physical_address(source, 4096)).typed<di::Array<u64, 512>>();
+    auto& destination_data = (*iris::mm::map_physical_address(destination, 4096)).typed<di::Array<u64, 512>>();
+    for (auto i : di::range(512zu)) {
+        source_data[i] = i;
+    }
+
+    iris::mm::copy_page(destination, source);
+    ASSERT_EQ(destination_data[0], 0u);
+    ASSERT_EQ(destination_data[511], 511u);
+
+    iris::mm::clear_page(source);
+    ASSERT_EQ(source_data[511], 0u);
+
+    iris::mm::clear_page_non_temporal(destination);
+    ASSERT_EQ(destination_data[1], 0u);
+    ASSERT_EQ(destination_data[511], 0u);
+
+    // Pages handed out from the pool of pre-zeroed pages must also be zeroed.
+    (void) iris::mm::refill_zeroed_page_pool();
+    auto page = *iris::mm::allocate_page_frame();
+    auto& page_data = (*iris::mm::map_physical_address(page, 4096)).typed<di::Array<u64, 512>>();
+    ASSERT(di::all_of(page_data, [](u64 value) {
+        return value == 0;
+    }));
+
+    iris::mm::deallocate_page_frame(source);
+    iris::mm::deallocate_page_frame(destination);
+    iris::mm::deallocate_page_frame(page);
+}
+
+TEST(allocation, page_operations)
+
+static void memory_statistics() {
+    auto before = iris::mm::memory_statistics();
+    ASSERT_GT(before.physical.total_pages, 0u);
+    ASSERT_LT(before.physical.available_pages(), before.physical.total_pages);
+
+    auto address_space = *iris::mm::create_empty_user_address_space();
+    auto object = *di::make_arc<iris::mm::BackingObject>();
+    auto flags = iris::mm::RegionFlags::User | iris::mm::RegionFlags::Readable | iris::mm::RegionFlags::Writable;
+    auto base = *address_space->allocate_region(di::move(object), 4096, flags);
+
+    // Faults are counted whether or not they can be resolved.
+    using iris::mm::PageFaultFlags;
+    ASSERT(address_space->handle_page_fault(base, PageFaultFlags::Write | PageFaultFlags::User));
+    ASSERT(!address_space->handle_page_fault(base + 4096zu, PageFaultFlags::User));
+    ASSERT_EQ(address_space->page_faults(), 2u);
+
+    auto after = iris::mm::memory_statistics();
+    auto page_faults = [](iris::mm::MemoryStatistics const& statistics) {
+        return statistics.event_count(iris::mm::MemoryEvent::PageFault);
+    };
+    ASSERT_GT_EQ(page_faults(after), page_faults(before) + 2);
+    ASSERT_EQ(after.physical.total_pages, before.physical.total_pages);
+}
+
+TEST(allocation, memory_statistics)
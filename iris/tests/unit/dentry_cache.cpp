@@ -0,0 +1,83 @@
+#include <di/vocab/pointer/prelude.h>
+#include <iris/core/unit_test.h>
+#include <iris/fs/dentry_cache.h>
+#include <iris/fs/tnode.h>
+
+static di::Arc<iris::TNode> make_tnode(di::Arc<iris::TNode> parent, di::TransparentStringView name) {
+    return *di::make_arc<iris::TNode>(di::move(parent), nullptr, *name.to_owned());
+}
+
+static void lookup() {
+    auto cache = iris::DentryCache {};
+    auto root = make_tnode(nullptr, ""_tsv);
+    auto bin = make_tnode(root, "bin"_tsv);
+
+    ASSERT(!cache.lookup(*root, "bin"_tsv, 0));
+    cache.insert(root, "bin"_tsv, bin);
+    cache.insert_negative(root, "missing"_tsv, 0);
+    ASSERT_EQ(cache.size(), 2u);
+
+    // Hits return the cached TNode itself.
+    auto hit = cache.lookup(*root, "bin"_tsv, 0);
+    ASSERT(hit);
+    ASSERT_EQ(hit->get(), bin.get());
+
+    auto negative = cache.lookup(*root, "missing"_tsv, 0);
+    ASSERT(negative);
+    ASSERT(!*negative);
+
+    // Entries are keyed by the parent as well as the name.
+    ASSERT(!cache.lookup(*bin, "bin"_tsv, 0));
+
+    // Inserting over a negative entry replaces it.
+    auto missing = make_tnode(root, "missing"_tsv);
+    cache.insert(root, "missing"_tsv, missing);
+    ASSERT_EQ(cache.size(), 2u);
+    ASSERT_EQ(cache.lookup(*root, "missing"_tsv, 0)->get(), missing.get());
+
+    cache.invalidate(*root, "bin"_tsv);
+    ASSERT(!cache.lookup(*root, "bin"_tsv, 0));
+    ASSERT_EQ(cache.size(), 1u);
+
+    ASSERT_EQ(cache.statistics().hits.load(di::MemoryOrder::Relaxed), 2u);
+    ASSERT_EQ(cache.statistics().negative_hits.load(di::MemoryOrder::Relaxed), 1u);
+    ASSERT_EQ(cache.statistics().misses.load(di::MemoryOrder::Relaxed), 3u);
+}
+
+static void eviction() {
+    auto cache = iris::DentryCache(2);
+    auto root = make_tnode(nullptr, ""_tsv);
+
+    cache.insert_negative(root, "a"_tsv, 0);
+    cache.insert_negative(root, "b"_tsv, 0);
+
+    // Using "a" makes "b" the least recently used entry.
+    ASSERT(cache.lookup(*root, "a"_tsv, 0));
+    cache.insert_negative(root, "c"_tsv, 0);
+
+    ASSERT_EQ(cache.size(), 2u);
+    ASSERT(cache.lookup(*root, "a"_tsv, 0));
+    ASSERT(!cache.lookup(*root, "b"_tsv, 0));
+    ASSERT(cache.lookup(*root, "c"_tsv, 0));
+    ASSERT_EQ(cache.statistics().evictions.load(di::MemoryOrder::Relaxed), 1u);
+}
+
+static void negative_entries() {
+    auto cache = iris::DentryCache {};
+    auto root = make_tnode(nullptr, ""_tsv);
+    auto file = make_tnode(root, "file"_tsv);
+
+    // A lookup which failed before the name was created must not hide it.
+    cache.insert(root, "file"_tsv, file);
+    cache.insert_negative(root, "file"_tsv, 0);
+    ASSERT_EQ(cache.lookup(*root, "file"_tsv, 0)->get(), file.get());
+
+    // Negative entries are only valid at the directory generation they were made at.
+    cache.insert_negative(root, "missing"_tsv, 0);
+    ASSERT(cache.lookup(*root, "missing"_tsv, 0));
+    ASSERT(!cache.lookup(*root, "missing"_tsv, 1));
+}
+
+TEST(dentry_cache, lookup)
+TEST(dentry_cache, eviction)
+TEST(dentry_cache, negative_entries)
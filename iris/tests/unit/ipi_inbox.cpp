@@ -0,0 +1,66 @@
+#include <iris/core/global_state.h>
+#include <iris/core/ipi_inbox.h>
+#include <iris/core/scheduler.h>
+#include <iris/core/task.h>
+#include <iris/core/unit_test.h>
+
+static void ipi_inbox_task() {
+    iris::current_scheduler()->exit_current_task();
+}
+
+static void tlb_flush() {
+    auto inbox = iris::IpiInbox {};
+
+    // Only the first message posted to an empty inbox needs an interrupt.
+    ASSERT(inbox.post_tlb_flush(1));
+    ASSERT(!inbox.post_tlb_flush(70));
+    ASSERT(!inbox.post_tlb_flush(1));
+
+    auto messages = inbox.take();
+    ASSERT_EQ(messages.tlb_flush_senders[0], 1_u64 << 1);
+    ASSERT_EQ(messages.tlb_flush_senders[1], 1_u64 << 6);
+    ASSERT_EQ(messages.tlb_flush_senders[2], 0u);
+    ASSERT_EQ(messages.tasks_to_schedule, nullptr);
+
+    // Once the inbox is drained, the next message needs another interrupt.
+    ASSERT(inbox.post_tlb_flush(2));
+    ASSERT_EQ(inbox.take().tlb_flush_senders[0], 1_u64 << 2);
+}
+
+static void page_frame_cache_drain() {
+    auto inbox = iris::IpiInbox {};
+
+    // Drain requests share the pending interrupt with every other kind of message.
+    ASSERT(inbox.post_page_frame_cache_drain(3));
+    ASSERT(!inbox.post_tlb_flush(3));
+
+    auto messages = inbox.take();
+    ASSERT_EQ(messages.page_frame_cache_drain_senders[0], 1_u64 << 3);
+    ASSERT_EQ(messages.tlb_flush_senders[0], 1_u64 << 3);
+    ASSERT_EQ(inbox.take().page_frame_cache_drain_senders[0], 0u);
+}
+
+static void tasks_to_schedule() {
+    auto inbox = iris::IpiInbox {};
+
+    auto tasks = iris::test::create_kernel_tasks(4, ipi_inbox_task);
+    for (auto [i, task] : di::enumerate(tasks)) {
+        ASSERT_EQ(inbox.post_task_to_schedule(*task), i == 0);
+    }
+
+    // Tasks come out in the order they were posted.
+    auto messages = inbox.take();
+    auto* task = messages.tasks_to_schedule;
+    for (auto& expected : tasks) {
+        ASSERT_EQ(task, expected.get());
+        task = task->next_in_ipi_inbox();
+    }
+    ASSERT_EQ(task, nullptr);
+
+    // The tasks were never actually scheduled, so they still need to run before they can be destroyed.
+    iris::test::run_tasks_to_completion(tasks.span());
+}
+
+TEST(ipi_inbox, tlb_flush)
+TEST(ipi_inbox, page_frame_cache_drain)
+TEST(ipi_inbox, tasks_to_schedule)
@@ -0,0 +1,39 @@
+#include <di/sync/prelude.h>
+#include <iris/core/global_state.h>
+#include <iris/core/mutex.h>
+#include <iris/core/scheduler.h>
+#include <iris/core/task.h>
+#include <iris/core/unit_test.h>
+
+constexpr auto mutex_task_count = 8zu;
+constexpr auto mutex_iterations = 2000zu;
+
+static auto mutex = iris::Mutex {};
+static auto mutex_counter = 0zu;
+
+static void mutex_task() {
+    for (auto i = 0zu; i < mutex_iterations; i++) {
+        auto guard = di::ScopedLock(mutex);
+
+        // Make the critical section long enough that tasks block on each other, and are sometimes preempted while
+        // holding the lock.
+        auto value = mutex_counter;
+        for (auto j = 0; j < 100; j++) {
+            asm volatile("" ::: "memory");
+        }
+        mutex_counter = value + 1;
+    }
+    iris::current_scheduler()->exit_current_task();
+}
+
+static void contention() {
+    mutex_counter = 0;
+    iris::test::run_kernel_tasks(mutex_task_count, mutex_task);
+
+    ASSERT_EQ(mutex_counter, mutex_task_count * mutex_iterations);
+    ASSERT(mutex.try_lock());
+    ASSERT(!mutex.try_lock());
+    mutex.unlock();
+}
+
+TEST(mutex, contention)
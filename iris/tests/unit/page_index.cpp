@@ -0,0 +1,102 @@
+#include <di/assert/prelude.h>
+#include <di/vocab/array/prelude.h>
+#include <iris/core/unit_test.h>
+#include <iris/mm/page_index.h>
+
+static auto page(u64 number) {
+    return iris::mm::PhysicalAddress(number * 4096);
+}
+
+static void insert_and_lookup() {
+    auto index = iris::mm::PageIndex {};
+    ASSERT(index.empty());
+    ASSERT(!index.lookup(0));
+    ASSERT(!index.find_next(0));
+
+    // The page at physical address 0 must be distinguishable from a missing page.
+    ASSERT(index.insert(0, page(0)));
+    ASSERT_EQ(index.lookup(0), page(0));
+
+    // Each insertion needs a taller tree than the last.
+    ASSERT(index.insert(63, page(1)));
+    ASSERT(index.insert(64, page(2)));
+    ASSERT(index.insert(100'000, page(3)));
+    ASSERT(index.insert(di::NumericLimits<u64>::max, page(4)));
+    ASSERT_EQ(index.size(), 5u);
+
+    ASSERT_EQ(index.lookup(0), page(0));
+    ASSERT_EQ(index.lookup(63), page(1));
+    ASSERT_EQ(index.lookup(64), page(2));
+    ASSERT_EQ(index.lookup(100'000), page(3));
+    ASSERT_EQ(index.lookup(di::NumericLimits<u64>::max), page(4));
+    ASSERT(!index.lookup(1));
+    ASSERT(!index.lookup(99'999));
+    ASSERT(!index.lookup(di::NumericLimits<u64>::max - 1));
+
+    ASSERT_EQ(index.find_next(0), 0u);
+    ASSERT_EQ(index.find_next(1), 63u);
+    ASSERT_EQ(index.find_next(65), 100'000u);
+    ASSERT_EQ(index.find_next(100'001), di::NumericLimits<u64>::max);
+}
+
+static void range() {
+    auto index = iris::mm::PageIndex {};
+    ASSERT(index.reserve(60, 10));
+    for (auto i : di::range(60_u64, 70_u64)) {
+        ASSERT(index.insert(i, page(i + 1)));
+    }
+    ASSERT(index.insert(71, page(72)));
+
+    // The lookup crosses from one leaf to the next, and stops at the first gap.
+    auto pages = di::Array<iris::mm::PhysicalAddress, 16> {};
+    ASSERT_EQ(index.lookup_range(58, pages.span()), 0u);
+    ASSERT_EQ(index.lookup_range(62, pages.span()), 8u);
+    ASSERT_EQ(pages[0], page(63));
+    ASSERT_EQ(pages[7], page(70));
+    ASSERT_EQ(index.lookup_range(60, *pages.first(4)), 4u);
+
+    auto visited = 0_u64;
+    index.for_each_in_range(62, 72, [&](u64 page_number, iris::mm::PhysicalAddress address) {
+        ASSERT_EQ(address, page(page_number + 1));
+        visited++;
+    });
+    ASSERT_EQ(visited, 9u);
+}
+
+static void tags() {
+    using iris::mm::PageTag;
+
+    auto index = iris::mm::PageIndex {};
+    for (auto i = 0_u64; i < 8192; i += 64) {
+        ASSERT(index.insert(i, page(i)));
+    }
+    ASSERT(!index.find_next_tagged(0, PageTag::Dirty));
+
+    index.set_tag(128, PageTag::Dirty);
+    index.set_tag(4096, PageTag::Dirty);
+    index.set_tag(4096, PageTag::Accessed);
+    ASSERT(index.has_tag(128, PageTag::Dirty));
+    ASSERT(!index.has_tag(128, PageTag::Accessed));
+    ASSERT(!index.has_tag(192, PageTag::Dirty));
+
+    ASSERT_EQ(index.find_next_tagged(0, PageTag::Dirty), 128u);
+    ASSERT_EQ(index.find_next_tagged(129, PageTag::Dirty), 4096u);
+    ASSERT_EQ(index.find_next_tagged(0, PageTag::Accessed), 4096u);
+    ASSERT(!index.find_next_tagged(4097, PageTag::Dirty));
+
+    // Clearing the last tagged page of a subtree must clear the tag from its parents too.
+    index.clear_tag(128, PageTag::Dirty);
+    ASSERT(!index.has_tag(128, PageTag::Dirty));
+    ASSERT_EQ(index.find_next_tagged(0, PageTag::Dirty), 4096u);
+    index.clear_tag(4096, PageTag::Dirty);
+    ASSERT(!index.find_next_tagged(0, PageTag::Dirty));
+    ASSERT(index.has_tag(4096, PageTag::Accessed));
+
+    // Tags survive the tree growing taller.
+    ASSERT(index.insert(1'000'000'000, page(1)));
+    ASSERT_EQ(index.find_next_tagged(0, PageTag::Accessed), 4096u);
+}
+
+TEST(page_index, insert_and_lookup)
+TEST(page_index, range)
+TEST(page_index, tags)
@@ -0,0 +1,51 @@
+#include <di/sync/prelude.h>
+#include <iris/core/global_state.h>
+#include <iris/core/queued_spinlock.h>
+#include <iris/core/scheduler.h>
+#include <iris/core/task.h>
+#include <iris/core/unit_test.h>
+
+constexpr auto queued_spinlock_task_count = 8zu;
+constexpr auto queued_spinlock_iterations = 20000zu;
+
+static auto counter = di::Synchronized<usize, iris::QueuedSpinlock> {};
+
+static void queued_spinlock_task() {
+    for (auto i = 0zu; i < queued_spinlock_iterations; i++) {
+        counter.with_lock([](usize& value) {
+            auto previous = value;
+            asm volatile("" ::: "memory");
+            value = previous + 1;
+        });
+    }
+    iris::current_scheduler()->exit_current_task();
+}
+
+static void contention() {
+    counter.with_lock([](usize& value) {
+        value = 0;
+    });
+    iris::test::run_kernel_tasks(queued_spinlock_task_count, queued_spinlock_task);
+
+    ASSERT_EQ(counter.with_lock([](usize& value) {
+                  return value;
+              }),
+              queued_spinlock_task_count * queued_spinlock_iterations);
+
+#ifdef IRIS_LOCK_STATISTICS
+    ASSERT_GT_EQ(counter.get_lock().statistics().acquisitions.load(di::MemoryOrder::Relaxed),
+                 queued_spinlock_task_count * queued_spinlock_iterations);
+#endif
+}
+
+static void try_lock() {
+    auto lock = iris::QueuedSpinlock {};
+    ASSERT(lock.try_lock());
+    ASSERT(!lock.try_lock());
+    lock.unlock();
+    ASSERT(lock.try_lock());
+    lock.unlock();
+}
+
+TEST(queued_spinlock, contention)
+TEST(queued_spinlock, try_lock)
@@ -0,0 +1,100 @@
+#include <di/sync/prelude.h>
+#include <iris/core/clock.h>
+#include <iris/core/global_state.h>
+#include <iris/core/interrupt_disabler.h>
+#include <iris/core/print.h>
+#include <iris/core/scheduler.h>
+#include <iris/core/task.h>
+#include <iris/core/unit_test.h>
+
+// The amount of busy work each benchmark task performs. This is large enough that each task is preempted several
+// times, which gives the load balancer a chance to move tasks around.
+constexpr auto benchmark_iterations = 20'000'000_u64;
+
+static auto benchmark_processors_used = di::Array<di::Atomic<bool>, iris::mm::AddressSpace::max_processors> {};
+
+static void benchmark_task() {
+    auto value = 0_u64;
+    for (auto i = 0_u64; i < benchmark_iterations; i++) {
+        value = value * 6364136223846793005_u64 + i;
+        asm volatile("" : "+r"(value));
+        if (i % (benchmark_iterations / 8) == 0) {
+            benchmark_processors_used[iris::current_processor()->id()].store(true, di::MemoryOrder::Relaxed);
+        }
+    }
+    iris::current_scheduler()->exit_current_task();
+}
+
+struct ThroughputResult {
+    di::Nanoseconds elapsed;
+    usize processors_used { 0 };
+};
+
+static ThroughputResult run_throughput_benchmark(usize task_count) {
+    for (auto& used : benchmark_processors_used) {
+        used.store(false, di::MemoryOrder::Relaxed);
+    }
+
+    // Every task is created by this processor, and must be spread out by placement, stealing and load balancing.
+    auto start = iris::monotonic_time();
+    iris::test::run_kernel_tasks(task_count, benchmark_task);
+    auto elapsed = iris::monotonic_time() - start;
+
+    auto processors_used = 0zu;
+    for (auto const& used : benchmark_processors_used) {
+        processors_used += used.load(di::MemoryOrder::Relaxed) ? 1 : 0;
+    }
+    return { elapsed, processors_used };
+}
+
+static void throughput() {
+    auto const& global_state = iris::global_state();
+    auto processor_count = di::max(global_state.processor_map.size(), 1zu);
+    auto task_count = processor_count * 4;
+
+    // The baseline places tasks round-robin and never moves them, which is how tasks were placed before work stealing.
+    iris::test::set_task_placement(iris::test::TaskPlacement::RoundRobin);
+    auto baseline = run_throughput_benchmark(task_count);
+    iris::test::set_task_placement(iris::test::TaskPlacement::Balanced);
+    auto result = run_throughput_benchmark(task_count);
+
+    iris::println("scheduler.throughput: tasks={} processors={} baseline_ms={} baseline_processors_used={} "
+                  "elapsed_ms={} processors_used={}"_sv,
+                  task_count, processor_count, u64(baseline.elapsed.count()) / 1'000'000, baseline.processors_used,
+                  u64(result.elapsed.count()) / 1'000'000, result.processors_used);
+    if (processor_count > 1) {
+        ASSERT_GT(result.processors_used, 1u);
+    }
+}
+
+constexpr auto yield_iterations = 100'000_u64;
+
+static void yield_latency() {
+    // When there is nothing else to run, yielding switches away from and back to the current task, which measures the
+    // cost of a kernel context switch.
+    auto start = iris::monotonic_time();
+    for (auto i = 0_u64; i < yield_iterations; i++) {
+        auto guard = iris::InterruptDisabler {};
+        iris::current_processor_unsafe().scheduler().yield();
+    }
+    auto elapsed = iris::monotonic_time() - start;
+
+    iris::println("scheduler.yield_latency: iterations={} ns_per_yield={}"_sv, yield_iterations,
+                  u64(elapsed.count()) / yield_iterations);
+    ASSERT_GT(elapsed.count(), 0);
+}
+
+static void weights() {
+    ASSERT_EQ(iris::nice_to_weight(0), iris::nice_0_weight);
+    for (auto nice = iris::min_nice_value; nice < iris::max_nice_value; nice++) {
+        ASSERT_GT(iris::nice_to_weight(nice), iris::nice_to_weight(nice + 1));
+    }
+
+    // Out of range nice values are clamped.
+    ASSERT_EQ(iris::nice_to_weight(-100), iris::nice_to_weight(iris::min_nice_value));
+    ASSERT_EQ(iris::nice_to_weight(100), iris::nice_to_weight(iris::max_nice_value));
+}
+
+TEST(scheduler, throughput)
+TEST(scheduler, weights)
+TEST(scheduler, yield_latency)
@@ -0,0 +1,70 @@
+#include <iris/core/scheduler.h>
+#include <iris/core/timer_wheel.h>
+#include <iris/core/unit_test.h>
+#include <iris/core/wait_queue.h>
+
+static void expire() {
+    auto wheel = iris::TimerWheel {};
+    // The ids of the timers which ran, as decimal digits in the order they ran.
+    auto fired = 0;
+    auto make_timer = [&](int id) {
+        return iris::KernelTimer([&fired, id] {
+            fired = fired * 10 + id;
+        });
+    };
+
+    // Each timer lands in a different level of the wheel.
+    auto a = make_timer(1);
+    auto b = make_timer(2);
+    auto c = make_timer(3);
+    auto d = make_timer(4);
+    wheel.add(a, 3_ms);
+    wheel.add(b, 1_ms);
+    wheel.add(c, 200_ms);
+    wheel.add(d, 5000_ms);
+    ASSERT_EQ(wheel.pending_count(), 4u);
+    ASSERT_EQ(wheel.next_event(), di::Nanoseconds(1_ms));
+
+    wheel.expire(di::Nanoseconds(500'000));
+    ASSERT_EQ(fired, 0);
+
+    wheel.expire(1_ms);
+    ASSERT_EQ(fired, 2);
+
+    wheel.expire(10_ms);
+    ASSERT_EQ(fired, 21);
+
+    // Deadlines are never rounded down.
+    wheel.expire(199_ms);
+    ASSERT_EQ(fired, 21);
+    wheel.expire(200_ms);
+    ASSERT_EQ(fired, 213);
+
+    ASSERT(d.cancel());
+    ASSERT(!d.cancel());
+    ASSERT_EQ(wheel.pending_count(), 0u);
+    ASSERT(!wheel.next_event());
+
+    wheel.expire(10'000_ms);
+    ASSERT_EQ(fired, 213);
+}
+
+static void sleep() {
+    auto start = iris::monotonic_time();
+    ASSERT(iris::sleep_for(10_ms));
+    ASSERT_GT_EQ((iris::monotonic_time() - start).count(), di::Nanoseconds(10_ms).count());
+}
+
+static void wait_timeout() {
+    auto wait_queue = iris::WaitQueue {};
+    auto start = iris::monotonic_time();
+    auto result = wait_queue.wait_until(start + 5_ms, [] {
+        return false;
+    });
+    ASSERT_EQ(result, di::Unexpected(iris::Error::TimedOut));
+    ASSERT_GT_EQ((iris::monotonic_time() - start).count(), di::Nanoseconds(5_ms).count());
+}
+
+TEST(timer_wheel, expire)
+TEST(timer_wheel, sleep)
+TEST(timer_wheel, wait_timeout)
@@ -1,15 +1,98 @@
+#include <di/execution/algorithm/into_result.h>
 #include <di/execution/algorithm/sync_wait.h>
+#include <di/math/prelude.h>
+#include <iris/core/clock.h>
+#include <iris/core/futex.h>
 #include <iris/core/print.h>
+#include <iris/core/scheduler.h>
 #include <iris/core/task.h>
 #include <iris/core/userspace_access.h>
 #include <iris/core/userspace_ptr.h>
 #include <iris/fs/initrd.h>
 #include <iris/fs/path.h>
+#include <iris/fs/statistics_file.h>
 #include <iris/hw/power.h>
+#include <iris/uapi/create_task.h>
+#include <iris/uapi/futex.h>
+#include <iris/uapi/io_vector.h>
+#include <iris/uapi/map_file.h>
 #include <iris/uapi/metadata.h>
+#include <iris/uapi/scheduling.h>
+#include <iris/uapi/statistics.h>
 #include <iris/uapi/syscall.h>
 
 namespace iris {
+template<typename T>
+using IoVectorBuffers = di::Array<di::Optional<UserspaceBuffer<T>>, io_vector_max_count>;
+
+// Copy in an array of io vectors, and validate every buffer it describes before any I/O is done.
+template<typename T>
+static Expected<di::Span<di::Optional<UserspaceBuffer<T>> const>>
+copy_io_vectors_from_user(IoVector const* vectors, usize count, IoVectorBuffers<T>& buffers) {
+    if (count > io_vector_max_count) {
+        return di::Unexpected(Error::InvalidArgument);
+    }
+
+    auto storage = di::Array<IoVector, io_vector_max_count> {};
+    auto vectors_buffer = TRY(di::create<UserspaceBuffer>(vectors, count));
+    TRY(vectors_buffer.copy_to({ storage.data(), count }));
+
+    auto total_length = 0_u64;
+    for (auto i : di::range(count)) {
+        auto [base, length] = storage[i];
+        if (length > di::NumericLimits<i64>::max - total_length) {
+            return di::Unexpected(Error::InvalidArgument);
+        }
+        total_length += length;
+        buffers[i] = TRY(di::create<UserspaceBuffer>(static_cast<T*>(base), length));
+    }
+    return *buffers.first(count);
+}
+
+// Validate a userspace file offset, and ensure that advancing it by @p amount bytes cannot overflow.
+static Expected<u64> validate_file_offset(u64 offset, usize amount) {
+    if (offset > u64(di::NumericLimits<i64>::max) || amount > di::NumericLimits<u64>::max - offset) {
+        return di::Unexpected(Error::InvalidArgument);
+    }
+    return offset;
+}
+
+// Fill each buffer in turn, stopping after a short read since there is no more data available. Like a short read, an
+// error after some data was already read just ends the transfer early.
+static di::AnySenderOf<usize> read_file_vectored(File& file,
+                                                 di::Span<di::Optional<UserspaceBuffer<byte>> const> buffers) {
+    auto total = 0zu;
+    for (auto const& buffer : buffers) {
+        auto result = co_await di::execution::into_result(read_file(file, *buffer));
+        if (!result && total > 0) {
+            break;
+        }
+        auto nread = co_await di::move(result);
+        total += nread;
+        if (nread < buffer->size()) {
+            break;
+        }
+    }
+    co_return total;
+}
+
+static di::AnySenderOf<usize> write_file_vectored(File& file,
+                                                  di::Span<di::Optional<UserspaceBuffer<byte const>> const> buffers) {
+    auto total = 0zu;
+    for (auto const& buffer : buffers) {
+        auto result = co_await di::execution::into_result(write_file(file, *buffer));
+        if (!result && total > 0) {
+            break;
+        }
+        auto nwritten = co_await di::move(result);
+        total += nwritten;
+        if (nwritten < buffer->size()) {
+            break;
+        }
+    }
+    co_return total;
+}
+
 Expected<u64> do_syscall(Task& current_task, arch::TaskState& task_state) {
     auto number = task_state.syscall_number();
     switch (number) {
@@ -35,9 +118,17 @@ Expected<u64> do_syscall(Task& current_task, arch::TaskState& task_state) {
             break;
         }
         case SystemCall::create_task: {
+            auto flags = CreateTaskFlags(task_state.syscall_arg1());
+            if (!!(flags & ~CreateTaskFlags::Mask)) {
+                return di::Unexpected(Error::InvalidArgument);
+            }
+
+            auto address_space = !!(flags & CreateTaskFlags::CopyAddressSpace)
+                                     ? TRY(current_task.address_space().clone())
+                                     : current_task.address_space().arc_from_this();
             auto task = TRY(iris::create_user_task(current_task.task_namespace(), current_task.root_tnode(),
                                                    current_task.cwd_tnode(), current_task.file_table(),
-                                                   current_task.address_space().arc_from_this()));
+                                                   di::move(address_space)));
             return task->id().raw_value();
         }
         case SystemCall::load_executable: {
@@ -271,6 +362,158 @@ Expected<u64> do_syscall(Task& current_task, arch::TaskState& task_state) {
                 di::execution::sync_wait(create_node(current_task.root_tnode(), current_task.cwd_tnode(), path, type)) %
                 di::function::value(0));
         }
+        case SystemCall::map_file: {
+            auto file_handle = i32(task_state.syscall_arg1());
+            auto offset = task_state.syscall_arg2();
+            auto length = task_state.syscall_arg3();
+            auto flags = MapFileFlags(task_state.syscall_arg4());
+            if (!!(flags & ~MapFileFlags::Mask) || offset % 4096 != 0 || length == 0 ||
+                length > di::NumericLimits<u64>::max - 4095) {
+                return di::Unexpected(Error::InvalidArgument);
+            }
+
+            auto& handle = TRY(current_task.file_table().lookup_file_handle(file_handle));
+            auto metadata = TRY_UNERASE_ERROR(di::execution::sync_wait(iris::file_metadata(handle)));
+
+            // Only pages which contain file data can be mapped.
+            auto page_aligned_length = di::align_up(length, 4096);
+            auto page_aligned_size = di::align_up(metadata.size, 4096);
+            if (offset > page_aligned_size || page_aligned_length > page_aligned_size - offset) {
+                return di::Unexpected(Error::InvalidArgument);
+            }
+
+            // The mapping gets its own object, which uses the file's object as its copy-on-write source. Read-only
+            // mappings never copy anything, so they always see the file's current contents.
+            auto source = TRY_UNERASE_ERROR(di::execution::sync_wait(iris::file_backing_object(handle)));
+            auto object = TRY(di::make_arc<mm::BackingObject>(di::move(source)));
+
+            auto region_flags = mm::RegionFlags::User | mm::RegionFlags::Readable;
+            if (!!(flags & MapFileFlags::Private)) {
+                region_flags |= mm::RegionFlags::Writable;
+            }
+            auto region = TRY(di::make_box<mm::Region>(mm::VirtualAddress(0), page_aligned_length, region_flags));
+            region->set_backing_object_page_offset(offset / 4096);
+
+            auto& address_space = current_task.address_space();
+            return address_space.lock()
+                ->allocate_region(di::move(object), di::move(region))
+                .transform(&mm::VirtualAddress::raw_value);
+        }
+        case SystemCall::open_statistics: {
+            auto raw_kind = task_state.syscall_arg1();
+            if (raw_kind > u64(di::to_underlying(StatisticsKind::Max))) {
+                return di::Unexpected(Error::InvalidArgument);
+            }
+            auto kind = StatisticsKind(raw_kind);
+
+            auto [file_storage, fd] = TRY(current_task.file_table().allocate_file_handle());
+            file_storage = TRY(File::create(di::in_place_type<StatisticsFile>, kind));
+            return fd;
+        }
+        case SystemCall::set_scheduling_class: {
+            auto task_id = iris::TaskId(i32(task_state.syscall_arg1()));
+            // Validate the raw arguments, since truncating them first could turn an invalid value into a valid one.
+            auto raw_scheduling_class = task_state.syscall_arg2();
+            auto raw_nice = i64(task_state.syscall_arg3());
+            if (raw_scheduling_class > u64(di::to_underlying(SchedulingClass::Max)) || raw_nice < min_nice_value ||
+                raw_nice > max_nice_value) {
+                return di::Unexpected(Error::InvalidArgument);
+            }
+            auto scheduling_class = SchedulingClass(raw_scheduling_class);
+            auto nice = i32(raw_nice);
+
+            // Real-time tasks are never preempted by the scheduler tick, so a single userspace loop could take over a
+            // processor. They are reserved for latency-critical kernel tasks.
+            if (scheduling_class == SchedulingClass::RealTimeFifo) {
+                return di::Unexpected(Error::OperationNotPermitted);
+            }
+
+            auto& task_namespace = current_task.task_namespace();
+            auto task = task_id == iris::TaskId(0) ? current_task.arc_from_this()
+                                                   : TRY(task_namespace.lock()->find_task(task_id));
+            task->set_scheduling_class(scheduling_class, nice);
+            return 0;
+        }
+        case SystemCall::monotonic_time: {
+            return u64(monotonic_time().count());
+        }
+        case SystemCall::sleep_for: {
+            auto duration = di::Nanoseconds(i64(task_state.syscall_arg1()));
+            if (duration.count() < 0) {
+                return di::Unexpected(Error::InvalidArgument);
+            }
+            TRY(sleep_for(duration));
+            return 0;
+        }
+        case SystemCall::sleep_until: {
+            auto deadline = di::Nanoseconds(i64(task_state.syscall_arg1()));
+            TRY(sleep_until(deadline));
+            return 0;
+        }
+        case SystemCall::futex_wait: {
+            auto const* address = reinterpret_cast<u32 const*>(task_state.syscall_arg1());
+            auto expected_value = u32(task_state.syscall_arg2());
+            auto timeout = i64(task_state.syscall_arg3());
+
+            auto deadline = di::Optional<di::Nanoseconds> {};
+            if (timeout != futex_wait_forever) {
+                if (timeout < 0) {
+                    return di::Unexpected(Error::InvalidArgument);
+                }
+                deadline = deadline_after(di::Nanoseconds(timeout));
+            }
+            TRY(iris::futex_wait(current_task.address_space(), address, expected_value, deadline));
+            return 0;
+        }
+        case SystemCall::futex_wake: {
+            auto const* address = reinterpret_cast<u32 const*>(task_state.syscall_arg1());
+            auto count = u32(task_state.syscall_arg2());
+            return TRY(iris::futex_wake(current_task.address_space(), address, count));
+        }
+        case SystemCall::pread: {
+            auto file_handle = i32(task_state.syscall_arg1());
+            auto* buffer = reinterpret_cast<di::Byte*>(task_state.syscall_arg2());
+            auto amount = task_state.syscall_arg3();
+            auto offset = TRY(validate_file_offset(task_state.syscall_arg4(), amount));
+
+            auto& handle = TRY(current_task.file_table().lookup_file_handle(file_handle));
+
+            return TRY_UNERASE_ERROR(di::execution::sync_wait(
+                iris::read_file_at(handle, TRY(di::create<UserspaceBuffer>(buffer, amount)), offset)));
+        }
+        case SystemCall::pwrite: {
+            auto file_handle = i32(task_state.syscall_arg1());
+            auto const* buffer = reinterpret_cast<di::Byte const*>(task_state.syscall_arg2());
+            auto amount = task_state.syscall_arg3();
+            auto offset = TRY(validate_file_offset(task_state.syscall_arg4(), amount));
+
+            auto& handle = TRY(current_task.file_table().lookup_file_handle(file_handle));
+
+            return TRY_UNERASE_ERROR(di::execution::sync_wait(
+                iris::write_file_at(handle, TRY(di::create<UserspaceBuffer>(buffer, amount)), offset)));
+        }
+        case SystemCall::readv: {
+            auto file_handle = i32(task_state.syscall_arg1());
+            auto const* vectors = reinterpret_cast<IoVector const*>(task_state.syscall_arg2());
+            auto count = task_state.syscall_arg3();
+
+            auto& handle = TRY(current_task.file_table().lookup_file_handle(file_handle));
+
+            auto storage = IoVectorBuffers<byte> {};
+            auto buffers = TRY(copy_io_vectors_from_user(vectors, count, storage));
+            return TRY_UNERASE_ERROR(di::execution::sync_wait(read_file_vectored(handle, buffers)));
+        }
+        case SystemCall::writev: {
+            auto file_handle = i32(task_state.syscall_arg1());
+            auto const* vectors = reinterpret_cast<IoVector const*>(task_state.syscall_arg2());
+            auto count = task_state.syscall_arg3();
+
+            auto& handle = TRY(current_task.file_table().lookup_file_handle(file_handle));
+
+            auto storage = IoVectorBuffers<byte const> {};
+            auto buffers = TRY(copy_io_vectors_from_user(vectors, count, storage));
+            return TRY_UNERASE_ERROR(di::execution::sync_wait(write_file_vectored(handle, buffers)));
+        }
         default:
             iris::println("Encounted unexpected system call: {}"_sv, di::to_underlying(number));
             break;
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <ccpp/bits/config.h>
+#include <ccpp/bits/size_t.h>
+#include <ccpp/bits/ssize_t.h>
+
+__CCPP_BEGIN_DECLARATIONS
+
+struct iovec {
+    void* iov_base;
+    size_t iov_len;
+};
+
+ssize_t readv(int __fd, struct iovec const* __iov, int __iovcnt);
+ssize_t writev(int __fd, struct iovec const* __iov, int __iovcnt);
+
+__CCPP_END_DECLARATIONS
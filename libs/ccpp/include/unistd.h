@@ -21,6 +21,8 @@ off_t lseek(int __fd, off_t __offset, int __whence);
 int close(int __fd);
 ssize_t read(int __fd, void* __buffer, size_t __count);
 ssize_t write(int __fd, void const* __buffer, size_t __count);
+ssize_t pread(int __fd, void* __buffer, size_t __count, off_t __offset);
+ssize_t pwrite(int __fd, void const* __buffer, size_t __count, off_t __offset);
 
 int chdir(char const* __path);
 int fchdir(int __fd);
@@ -3,12 +3,52 @@
 // NOTE: this is an extension of fread(), which does not lock file.
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/fread.html
 extern "C" size_t fread_unlocked(void* __restrict buffer, size_t size, size_t count, FILE* __restrict file) {
-    for (auto nbytes : di::range(count * size)) {
-        auto ch = fgetc_unlocked(file);
-        if (ch == EOF) {
-            return nbytes / size;
+    auto& inner = file->get_unlocked();
+
+    // If we're are EOF or already error'ed, ignore.
+    if (size == 0 || count == 0 || inner.at_eof() || inner.has_error()) {
+        return 0;
+    }
+
+    // Ensure the stream is readable.
+    if (auto result = inner.mark_as_readable(); !result) {
+        errno = di::to_underlying(result.error().value());
+        return 0;
+    }
+
+    auto const total = size * count;
+    auto data = di::Span { static_cast<byte*>(buffer), total };
+
+    // Take as much as possible from the buffer.
+    auto from_buffer = di::min(inner.buffer_size, total);
+    di::copy(*di::Span { inner.buffer + inner.buffer_offset, inner.buffer_size }.first(from_buffer), data.data());
+    inner.buffer_offset += from_buffer;
+    inner.buffer_size -= from_buffer;
+    data = *data.subspan(from_buffer);
+
+    // Read the rest directly into the caller's buffer, refilling the stream's buffer with the same system call.
+    while (!data.empty()) {
+        auto refill = di::Span<byte> {};
+        if (inner.buffer_mode == ccpp::BufferMode::FullBuffered) {
+            refill = { inner.buffer, inner.buffer_capacity };
+        }
+
+        auto buffers = di::Array { data, refill };
+        auto nread = inner.file.read_some_vectored(buffers.span());
+        if (!nread) {
+            errno = di::to_underlying(nread.error().value());
+            inner.mark_as_error();
+            return (total - data.size()) / size;
         }
-        static_cast<byte*>(buffer)[nbytes] = byte(ch);
+        if (*nread == 0) {
+            inner.mark_as_eof();
+            return (total - data.size()) / size;
+        }
+
+        auto into_data = di::min(*nread, data.size());
+        data = *data.subspan(into_data);
+        inner.buffer_offset = 0;
+        inner.buffer_size = *nread - into_data;
     }
     return count;
 }
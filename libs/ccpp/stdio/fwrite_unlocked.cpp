@@ -1,13 +1,64 @@
 #include <ccpp/bits/file_implementation.h>
+#include <di/container/algorithm/prelude.h>
 
 // NOTE: this is an extension of fwrite(), which does not lock file.
 // https://pubs.opengroup.org/onlinepubs/9699919799/functions/fwrite.html
 extern "C" size_t fwrite_unlocked(void const* __restrict buffer, size_t size, size_t count, FILE* __restrict file) {
-    for (auto nbytes : di::range(count * size)) {
-        auto ch = fputc_unlocked(di::to_integer<int>(static_cast<byte const*>(buffer)[nbytes]), file);
-        if (ch == EOF) {
-            return nbytes / size;
+    auto& inner = file->get_unlocked();
+    if (size == 0 || count == 0 || inner.has_error()) {
+        return 0;
+    }
+
+    // Ensure the stream is writable.
+    if (auto result = inner.mark_as_writable(); !result) {
+        errno = di::to_underlying(result.error().value());
+        return 0;
+    }
+
+    auto const total = size * count;
+    auto data = di::Span { static_cast<byte const*>(buffer), total };
+
+    // Line buffered streams must write out everything up to and including the last newline.
+    auto must_write = 0zu;
+    if (inner.buffer_mode == ccpp::BufferMode::LineBuffered) {
+        if (auto newline = di::find_last(data, byte('\n')); !newline.empty()) {
+            must_write = usize(newline.begin() - data.begin()) + 1;
+        }
+    }
+
+    // Small writes are only appended to the buffer.
+    if (must_write == 0 && total <= inner.buffer_capacity - inner.buffer_size) {
+        di::copy(data, inner.buffer + inner.buffer_size);
+        inner.buffer_size += total;
+        return count;
+    }
+
+    // Keep the tail of the data in the buffer if it fits, and write out everything else.
+    auto to_write = data;
+    auto to_buffer = di::Span<byte const> {};
+    if (inner.buffer_mode != ccpp::BufferMode::NotBuffered && total - must_write <= inner.buffer_capacity) {
+        to_write = *data.first(must_write);
+        to_buffer = *data.subspan(must_write);
+    }
+
+    // Write the buffered data and the new data together, which usually takes a single system call.
+    auto buffered = di::Span { static_cast<byte const*>(inner.buffer), di::exchange(inner.buffer_size, 0) };
+    inner.buffer_offset = 0;
+    while (!buffered.empty() || !to_write.empty()) {
+        auto buffers = di::Array { buffered, to_write };
+        auto nwritten = inner.file.write_some_vectored(buffers.span());
+        if (!nwritten || *nwritten == 0) {
+            errno = !nwritten ? di::to_underlying(nwritten.error().value()) : EIO;
+            inner.mark_as_error();
+            return (data.size() - to_write.size() - to_buffer.size()) / size;
         }
+
+        auto from_buffered = di::min(*nwritten, buffered.size());
+        buffered = *buffered.subspan(from_buffered);
+        to_write = *to_write.subspan(*nwritten - from_buffered);
     }
+
+    di::copy(to_buffer, inner.buffer);
+    inner.buffer_size = to_buffer.size();
     return count;
 }
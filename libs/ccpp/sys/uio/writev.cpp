@@ -0,0 +1,13 @@
+#include <dius/system/system_call.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+// https://pubs.opengroup.org/onlinepubs/9699919799/functions/writev.html
+extern "C" ssize_t writev(int fd, struct iovec const* iov, int iovcnt) {
+    auto result = dius::system::system_call<ssize_t>(dius::system::Number::writev, fd, iov, iovcnt);
+    if (!result) {
+        errno = int(result.error());
+        return -1;
+    }
+    return *result;
+}
@@ -0,0 +1,156 @@
+#include <di/container/string/prelude.h>
+#include <dius/sync_file.h>
+#include <dius/test/prelude.h>
+#include <stdio.h>
+
+namespace stdio_h {
+constexpr auto buffer_capacity = 8zu;
+constexpr auto alphabet = "abcdefghijklmnopqrstuvwxyz"_tsv;
+
+// Read back what has reached the underlying file, bypassing the stream's buffer.
+static di::TransparentString written(FILE* file) {
+    auto raw = dius::SyncFile(dius::SyncFile::Owned::No, fileno(file));
+    auto data = di::Array<di::Byte, 64> {};
+    auto nread = raw.read_some(0, data.span());
+    ASSERT(nread);
+
+    auto result = di::TransparentString {};
+    for (auto byte : *data.first(*nread)) {
+        result.push_back(char(byte));
+    }
+    return result;
+}
+
+static void write(FILE* file, di::TransparentStringView data) {
+    ASSERT_EQ(fwrite(data.data(), 1, data.size(), file), data.size());
+}
+
+// Only what reaches the file once the stream is flushed is specified by the C standard. When ccpp is the libc under
+// test, how much each buffering mode holds back is checked as well.
+static void fwrite_unbuffered() {
+    auto* file = tmpfile();
+    ASSERT(file);
+    ASSERT_EQ(setvbuf(file, nullptr, _IONBF, 0), 0);
+
+    write(file, "abc"_tsv);
+#ifdef DIUS_USE_RUNTIME
+    ASSERT_EQ(written(file), "abc"_tsv);
+#endif
+
+    // Larger than the buffer used by the other tests, which makes no difference here.
+    write(file, "0123456789abcdef"_tsv);
+    ASSERT_EQ(fflush(file), 0);
+    ASSERT_EQ(written(file), "abc0123456789abcdef"_tsv);
+
+    ASSERT_EQ(fclose(file), 0);
+}
+
+static void fwrite_line_buffered() {
+    char buffer[buffer_capacity];
+
+    auto* file = tmpfile();
+    ASSERT(file);
+    ASSERT_EQ(setvbuf(file, buffer, _IOLBF, sizeof(buffer)), 0);
+
+    // Text after the last newline stays in the buffer.
+    write(file, "ab\ncd"_tsv);
+#ifdef DIUS_USE_RUNTIME
+    ASSERT_EQ(written(file), "ab\n"_tsv);
+#endif
+
+    // Everything up to the last newline is written, even when it does not fit in the buffer.
+    write(file, "0123456789abcdef\nxy"_tsv);
+#ifdef DIUS_USE_RUNTIME
+    ASSERT_EQ(written(file), "ab\ncd0123456789abcdef\n"_tsv);
+#endif
+
+    ASSERT_EQ(fflush(file), 0);
+    ASSERT_EQ(written(file), "ab\ncd0123456789abcdef\nxy"_tsv);
+
+    ASSERT_EQ(fclose(file), 0);
+}
+
+static void fwrite_full_buffered() {
+    char buffer[buffer_capacity];
+
+    auto* file = tmpfile();
+    ASSERT(file);
+    ASSERT_EQ(setvbuf(file, buffer, _IOFBF, sizeof(buffer)), 0);
+
+    write(file, "ab\nc"_tsv);
+#ifdef DIUS_USE_RUNTIME
+    ASSERT_EQ(written(file), ""_tsv);
+#endif
+
+    // A write larger than the buffer goes out together with what was already buffered.
+    auto const expected = "ab\nc0123456789abcdef"_tsv;
+    write(file, "0123456789abcdef"_tsv);
+#ifdef DIUS_USE_RUNTIME
+    ASSERT_EQ(written(file), expected);
+#endif
+
+    ASSERT_EQ(fflush(file), 0);
+    ASSERT_EQ(written(file), expected);
+
+    ASSERT_EQ(fclose(file), 0);
+}
+
+static void do_fread(int mode) {
+    char buffer[buffer_capacity];
+
+    auto* file = tmpfile();
+    ASSERT(file);
+
+    // Fill the file through its descriptor, which leaves the stream's offset at the start.
+    auto raw = dius::SyncFile(dius::SyncFile::Owned::No, fileno(file));
+    ASSERT(raw.write_exactly(0, di::as_bytes(alphabet.span())));
+
+    if (mode == _IONBF) {
+        ASSERT_EQ(setvbuf(file, nullptr, mode, 0), 0);
+    } else {
+        ASSERT_EQ(setvbuf(file, buffer, mode, sizeof(buffer)), 0);
+    }
+
+    auto read = [&](usize count) {
+        auto data = di::Array<char, 32> {};
+        auto nread = fread(data.data(), 1, count, file);
+
+        auto result = di::TransparentString {};
+        for (auto ch : *data.first(nread)) {
+            result.push_back(ch);
+        }
+        return result;
+    };
+
+    // When fully buffered, the first read also fills the buffer, so the second is partly served from the buffer and
+    // then refills it.
+    ASSERT_EQ(read(3), "abc"_tsv);
+    ASSERT_EQ(read(12), "defghijklmno"_tsv);
+    ASSERT_EQ(read(4), "pqrs"_tsv);
+    ASSERT(!feof(file));
+
+    ASSERT_EQ(read(20), "tuvwxyz"_tsv);
+    ASSERT(feof(file));
+
+    ASSERT_EQ(fclose(file), 0);
+}
+
+static void fread_unbuffered() {
+    do_fread(_IONBF);
+}
+
+static void fread_line_buffered() {
+    do_fread(_IOLBF);
+}
+
+static void fread_full_buffered() {
+    do_fread(_IOFBF);
+}
+
+TEST(stdio_h, fwrite_unbuffered)
+TEST(stdio_h, fwrite_line_buffered)
+TEST(stdio_h, fwrite_full_buffered)
+TEST(stdio_h, fread_unbuffered)
+TEST(stdio_h, fread_line_buffered)
+TEST(stdio_h, fread_full_buffered)
+}
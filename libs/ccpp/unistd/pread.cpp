@@ -0,0 +1,13 @@
+#include <dius/system/system_call.h>
+#include <errno.h>
+#include <unistd.h>
+
+// https://pubs.opengroup.org/onlinepubs/9699919799/functions/pread.html
+extern "C" ssize_t pread(int fd, void* buffer, size_t count, off_t offset) {
+    auto result = dius::system::system_call<ssize_t>(dius::system::Number::pread, fd, buffer, count, offset);
+    if (!result) {
+        errno = int(result.error());
+        return -1;
+    }
+    return *result;
+}
@@ -238,7 +238,12 @@ public:
         }
 
         if (new_capacity <= m_buckets.size()) {
-            return;
+            if constexpr (concepts::LanguageVoid<decltype(util::declval<Buckets&>().reserve_from_nothing(
+                              new_capacity))>) {
+                return;
+            } else {
+                return {};
+            }
         }
 
         auto new_buckets = Buckets {};
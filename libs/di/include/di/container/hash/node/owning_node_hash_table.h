@@ -90,18 +90,24 @@ public:
         }
 
         auto const hash = this->hash(needle);
-        auto const bucket_index = hash % this->bucket_count();
-        auto* bucket = &vector::lookup(this->m_buckets, bucket_index);
-
-        auto before_it = bucket->before_begin();
-        while (container::next(before_it) != bucket->end()) {
-            auto&& current = *container::next(before_it);
-            if (this->equal(this->node_value(current), needle)) {
-                break;
+        auto bucket_index = usize(0);
+        auto* bucket = static_cast<meta::ContainerValue<Buckets>*>(nullptr);
+        auto before_it = meta::ContainerIterator<meta::ContainerValue<Buckets>> {};
+        auto it = before_it;
+        auto find_insertion_point = [&] {
+            bucket_index = hash % this->bucket_count();
+            bucket = &vector::lookup(this->m_buckets, bucket_index);
+            before_it = bucket->before_begin();
+            while (container::next(before_it) != bucket->end()) {
+                auto&& current = *container::next(before_it);
+                if (this->equal(this->node_value(current), needle)) {
+                    break;
+                }
+                ++before_it;
             }
-            ++before_it;
-        }
-        auto it = container::next(before_it);
+            it = container::next(before_it);
+        };
+        find_insertion_point();
 
         auto do_insert = [&] {
             if constexpr (is_multi) {
@@ -119,10 +125,10 @@ public:
                 } else {
                     this->reserve(new_capacity);
                 }
+
+                // Rehashing moves every node to a new bucket, so the insertion point must be found again.
+                find_insertion_point();
             }
-            bucket = &vector::lookup(this->m_buckets, bucket_index);
-            before_it = bucket->before_begin();
-            it = container::next(before_it);
             ++this->m_size;
         } else if constexpr (!is_multi) {
             return vocab::Tuple(Iterator { this->m_buckets.span(), bucket_index, before_it }, false);
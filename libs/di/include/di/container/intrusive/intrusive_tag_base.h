@@ -16,6 +16,15 @@ struct IntrusiveTagBase {
         return true;
     }
 
+    /// @brief Whether nodes store data computed from their subtree.
+    ///
+    /// Augmented trees call `update_augmented_data()` on a node whenever its children change, always after its
+    /// children have been updated. This allows maintaining summaries (like a subtree maximum) in O(log n) time.
+    template<typename T>
+    constexpr static bool is_augmented(InPlaceType<T>) {
+        return false;
+    }
+
     template<typename T>
     constexpr static NodeType node_type(InPlaceType<T>);
 
@@ -24,6 +33,8 @@ struct IntrusiveTagBase {
         return static_cast<T&>(node);
     }
 
+    constexpr static void update_augmented_data(auto&) {}
+
     constexpr static void did_insert(auto&, auto&) {}
     constexpr static void did_remove(auto&, auto&) {}
 };
@@ -42,6 +42,8 @@ private:
     using ConcreteNode = decltype(Tag::node_type(in_place_type<Value>));
     using ConcreteSelf = meta::Conditional<concepts::SameAs<Void, Self>, RBTree, Self>;
 
+    constexpr static bool is_augmented = Tag::is_augmented(in_place_type<Value>);
+
     constexpr decltype(auto) down_cast_self() {
         if constexpr (concepts::SameAs<Void, Self>) {
             return *this;
@@ -208,6 +210,22 @@ protected:
         return const_cast<RBTree&>(*this).node_value(const_cast<Node&>(node));
     }
 
+    // Recompute the augmented data of a single node, whose children are up to date.
+    constexpr void update_augmented_data(Node& node) {
+        if constexpr (is_augmented) {
+            Tag::update_augmented_data(static_cast<ConcreteNode&>(node));
+        }
+    }
+
+    // Recompute the augmented data of every node from the passed node up to the root.
+    constexpr void update_augmented_data_to_root(Node* node) {
+        if constexpr (is_augmented) {
+            for (; node; node = node->parent) {
+                update_augmented_data(*node);
+            }
+        }
+    }
+
     // Compute the color of a node, defaulting to Black.
     constexpr Node::Color node_color(Node* node) const {
         if (!node) {
@@ -235,6 +253,11 @@ protected:
         }
         y.left = &x;
         x.parent = &y;
+
+        // x is now y's child, so it must be updated first. The subtree rooted at y covers the same nodes as the one
+        // previously rooted at x, so no other nodes are affected.
+        update_augmented_data(x);
+        update_augmented_data(y);
     }
 
     // Swaps the passed node with its left child in the tree.
@@ -256,6 +279,9 @@ protected:
         }
         x.right = &y;
         y.parent = &x;
+
+        update_augmented_data(y);
+        update_augmented_data(x);
     }
 
     struct InsertPosition {
@@ -307,6 +333,7 @@ protected:
         if (position.parent == nullptr) {
             m_root = m_minimum = m_maximum = &to_insert;
             m_size = 1;
+            update_augmented_data(to_insert);
             return;
         }
 
@@ -318,6 +345,7 @@ protected:
         } else {
             parent.right = &to_insert;
         }
+        update_augmented_data_to_root(&to_insert);
 
         // Step 3: maintain the Red-Black properties.
         do_insert_rebalancing(&to_insert);
@@ -401,6 +429,8 @@ protected:
         }
 
         // Step 2: actually remove the node from the tree.
+        // The lowest node whose subtree changed, which is where augmented data must be recomputed from.
+        Node* lowest_changed = to_delete.parent;
         if (to_delete.left == nullptr) {
             // Case 1: there is no left child, so promote the right child.
             x = to_delete.right;
@@ -416,10 +446,12 @@ protected:
             x = y->right;
 
             if (y->parent == &to_delete) {
+                lowest_changed = y;
                 if (x) {
                     x->parent = y;
                 }
             } else {
+                lowest_changed = y->parent;
                 transplant(*y, y->right);
                 y->right = to_delete.right;
                 y->right->parent = y;
@@ -429,6 +461,7 @@ protected:
             y->left->parent = y;
             y->color = to_delete.color;
         }
+        update_augmented_data_to_root(lowest_changed);
 
         // Step 3: maintain the Red-Black properties.
         if (y_color == Node::Color::Black && x) {
@@ -1,4 +1,5 @@
 #include <di/container/intrusive/prelude.h>
+#include <di/container/vector/prelude.h>
 #include <di/container/view/prelude.h>
 #include <dius/test/prelude.h>
 
@@ -103,6 +104,71 @@ constexpr void list() {
     ASSERT_EQ(list.pop_front().transform(&Node::value), di::nullopt);
 }
 
+struct SubtreeSizeNode;
+
+// Each node tracks the size of its subtree, which is the simplest form of augmented data.
+struct SubtreeSizeTag : di::IntrusiveTreeSetTag<SubtreeSizeTag> {
+    template<typename T>
+    constexpr static bool is_augmented(di::InPlaceType<T>) {
+        return true;
+    }
+
+    constexpr static void update_augmented_data(auto& node);
+};
+
+struct SubtreeSizeNode : di::IntrusiveTreeSetNode<SubtreeSizeTag> {
+    constexpr explicit SubtreeSizeNode(int v) : value(v) {}
+
+    int value;
+    usize subtree_size { 1 };
+
+    constexpr friend bool operator==(SubtreeSizeNode const& a, SubtreeSizeNode const& b) { return a.value == b.value; }
+    constexpr friend auto operator<=>(SubtreeSizeNode const& a, SubtreeSizeNode const& b) {
+        return a.value <=> b.value;
+    }
+
+    constexpr friend bool operator==(SubtreeSizeNode const& a, int b) { return a.value == b; }
+    constexpr friend auto operator<=>(SubtreeSizeNode const& a, int b) { return a.value <=> b; }
+};
+
+constexpr usize subtree_size(di::IntrusiveTreeSetNode<SubtreeSizeTag>* node) {
+    return node ? static_cast<SubtreeSizeNode*>(node)->subtree_size : 0;
+}
+
+constexpr void SubtreeSizeTag::update_augmented_data(auto& node) {
+    static_cast<SubtreeSizeNode&>(node).subtree_size = 1 + subtree_size(node.left) + subtree_size(node.right);
+}
+
+constexpr void tree_set_augmented() {
+    auto nodes = di::Vector<SubtreeSizeNode> {};
+    for (auto i : di::range(64)) {
+        nodes.emplace_back((i * 37) % 64);
+    }
+
+    auto set = di::IntrusiveTreeSet<SubtreeSizeNode, SubtreeSizeTag> {};
+    auto validate = [&] {
+        for (auto& node : set) {
+            ASSERT_EQ(node.subtree_size, 1 + subtree_size(node.left) + subtree_size(node.right));
+            if (!node.parent) {
+                ASSERT_EQ(node.subtree_size, set.size());
+            }
+        }
+    };
+
+    for (auto& node : nodes) {
+        set.insert(node);
+        validate();
+    }
+    ASSERT_EQ(set.size(), 64u);
+
+    for (auto i = 0; i < 64; i += 3) {
+        set.erase(i);
+        validate();
+    }
+    ASSERT_EQ(set.size(), 42u);
+}
+
 TESTC(container_intrusive, forward_list)
 TESTC(container_intrusive, list)
+TESTC(container_intrusive, tree_set_augmented)
 }
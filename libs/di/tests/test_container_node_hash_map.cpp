@@ -94,8 +94,24 @@ constexpr void stress() {
     ASSERT_EQ(r1, ex1);
 }
 
+static void rehash() {
+    auto x = di::NodeHashMap<int, int> {};
+    for (auto i = 0; i < 1000; ++i) {
+        ASSERT(di::get<1>(x.insert({ i, i })));
+
+        // Inserting an existing key after the table grew must not add a duplicate.
+        ASSERT(!di::get<1>(x.insert({ i / 2, 0 })));
+    }
+
+    ASSERT_EQ(x.size(), 1000u);
+    for (auto i = 0; i < 1000; ++i) {
+        ASSERT_EQ(x.at(i), i);
+    }
+}
+
 // NOTE: GCC refuses to compile anything involving linked-lists at compile-time.
 TESTC_CLANG(container_node_hash_map, basic)
 TESTC_CLANG(container_node_hash_map, multi)
 TESTC_CLANG(container_node_hash_map, stress)
+TEST(container_node_hash_map, rehash)
 }
@@ -0,0 +1,28 @@
+#include <di/math/prelude.h>
+#include <dius/condition_variable.h>
+
+namespace dius {
+void ConditionVariable::notify_one() {
+    di::AtomicRef(m_sequence).fetch_add(1, di::MemoryOrder::SequentialConsistency);
+    if (di::AtomicRef(m_waiters).load(di::MemoryOrder::SequentialConsistency) > 0) {
+        (void) futex_wake(&m_sequence, 1);
+    }
+}
+
+void ConditionVariable::notify_all() {
+    di::AtomicRef(m_sequence).fetch_add(1, di::MemoryOrder::SequentialConsistency);
+    if (di::AtomicRef(m_waiters).load(di::MemoryOrder::SequentialConsistency) > 0) {
+        (void) futex_wake(&m_sequence, di::NumericLimits<u32>::max);
+    }
+}
+
+void ConditionVariable::wait(Mutex& mutex) {
+    di::AtomicRef(m_waiters).fetch_add(1, di::MemoryOrder::SequentialConsistency);
+    auto sequence = di::AtomicRef(m_sequence).load(di::MemoryOrder::SequentialConsistency);
+
+    mutex.unlock();
+    (void) futex_wait(&m_sequence, sequence);
+    di::AtomicRef(m_waiters).fetch_sub(1, di::MemoryOrder::Relaxed);
+    mutex.lock();
+}
+}
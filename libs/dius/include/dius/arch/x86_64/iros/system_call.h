@@ -1,6 +1,6 @@
 #pragma once
 
-#define DIUS_SYSTEM_CALL_INSTRUCTION "int $0x80"
+#define DIUS_SYSTEM_CALL_INSTRUCTION "syscall"
 
 #define DIUS_SYSTEM_CALL_ASM_RESULT "=a"
 #define DIUS_SYSTEM_CALL_ASM_ERROR  "=d"
@@ -13,4 +13,4 @@
 #define DIUS_SYSTEM_CALL_ASM_ARG5 "r8"
 #define DIUS_SYSTEM_CALL_ASM_ARG6 "r9"
 
-#define DIUS_SYSTEM_CALL_CLOBBER "memory", "cc"
+#define DIUS_SYSTEM_CALL_CLOBBER "memory", "rcx", "r11", "cc"
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <di/function/prelude.h>
+#include <di/types/prelude.h>
+#include <dius/mutex.h>
+
+namespace dius {
+/// @brief A synchronization primitive which lets threads wait until they are notified.
+///
+/// This class is modeled after the C++ standard library
+/// [std::condition_variable](https://en.cppreference.com/w/cpp/thread/condition_variable), but waits on a dius::Mutex
+/// directly instead of a lock guard.
+class ConditionVariable {
+public:
+    ConditionVariable() = default;
+
+    ConditionVariable(ConditionVariable const&) = delete;
+    ConditionVariable& operator=(ConditionVariable const&) = delete;
+
+    void notify_one();
+    void notify_all();
+
+    /// @brief Atomically unlock @p mutex and wait until notified, and then lock @p mutex again.
+    ///
+    /// @warning The calling thread must hold @p mutex. Threads can wake up spuriously.
+    void wait(Mutex& mutex);
+
+    /// @brief Wait on @p mutex until @p predicate is satisfied.
+    template<di::concepts::InvocableTo<bool> Pred>
+    void wait(Mutex& mutex, Pred&& predicate) {
+        while (!di::invoke(predicate)) {
+            wait(mutex);
+        }
+    }
+
+private:
+    /// Incremented on every notification, so that a waiter which was notified before it went to sleep does not sleep.
+    u32 m_sequence { 0 };
+    u32 m_waiters { 0 };
+};
+}
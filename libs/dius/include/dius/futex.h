@@ -0,0 +1,19 @@
+#pragma once
+
+#include <di/types/prelude.h>
+#include <di/vocab/error/prelude.h>
+#include <dius/error.h>
+
+namespace dius {
+/// @brief Block the calling thread if the futex word at @p address holds @p expected_value.
+///
+/// Checking the futex word and going to sleep happen atomically with respect to futex_wake(), so a wake which follows a
+/// store to the futex word cannot be missed. Threads may wake up spuriously, so callers must check their condition
+/// again after this returns.
+///
+/// @return Returns an error if the futex word did not hold @p expected_value, or if the wait was interrupted.
+di::Result<void> futex_wait(u32 const* address, u32 expected_value);
+
+/// @brief Wake up to @p count threads blocked in futex_wait() on the futex word at @p address.
+di::Result<void> futex_wake(u32 const* address, u32 count);
+}
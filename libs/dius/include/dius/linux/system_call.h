@@ -24,6 +24,8 @@ enum class Number : int {
     io_uring_register = __NR_io_uring_register,
     pread = __NR_pread64,
     pwrite = __NR_pwrite64,
+    readv = __NR_readv,
+    writev = __NR_writev,
     read = __NR_read,
     write = __NR_write,
     close = __NR_close,
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <di/sync/prelude.h>
+#include <di/types/prelude.h>
+#include <dius/futex.h>
+
+namespace dius {
+/// @brief A mutual exclusion lock which blocks contending threads.
+///
+/// This class is modeled after the C++ standard library [std::mutex](https://en.cppreference.com/w/cpp/thread/mutex).
+/// Threads which fail to acquire the lock spin for a short while, since locks are usually held briefly, and then sleep
+/// on a futex. Unlocking only enters the kernel if some thread is sleeping.
+class Mutex {
+public:
+    Mutex() = default;
+
+    Mutex(Mutex const&) = delete;
+    Mutex& operator=(Mutex const&) = delete;
+
+    void lock() {
+        if (!try_lock()) {
+            lock_slow();
+        }
+    }
+
+    bool try_lock() {
+        auto expected = unlocked;
+        return di::AtomicRef(m_state).compare_exchange_strong(expected, locked, di::MemoryOrder::Acquire,
+                                                              di::MemoryOrder::Relaxed);
+    }
+
+    void unlock() {
+        if (di::AtomicRef(m_state).exchange(unlocked, di::MemoryOrder::Release) == contended) {
+            (void) futex_wake(&m_state, 1);
+        }
+    }
+
+private:
+    constexpr static u32 unlocked = 0;
+    constexpr static u32 locked = 1;
+    /// Locked, and some thread may be sleeping on the futex.
+    constexpr static u32 contended = 2;
+
+    void lock_slow();
+
+    u32 m_state { unlocked };
+};
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <di/types/prelude.h>
+#include <dius/futex.h>
+
+namespace dius {
+/// @brief A counting semaphore which blocks threads while its count is zero.
+///
+/// This class is modeled after the C++ standard library
+/// [std::counting_semaphore](https://en.cppreference.com/w/cpp/thread/counting_semaphore).
+class Semaphore {
+public:
+    constexpr explicit Semaphore(u32 initial_count = 0) : m_count(initial_count) {}
+
+    Semaphore(Semaphore const&) = delete;
+    Semaphore& operator=(Semaphore const&) = delete;
+
+    /// @brief Decrement the count, waiting until it is positive.
+    void acquire();
+
+    /// @brief Decrement the count if it is positive, without blocking.
+    bool try_acquire();
+
+    /// @brief Increment the count by @p count, waking up blocked threads.
+    void release(u32 count = 1);
+
+private:
+    u32 m_count { 0 };
+    u32 m_waiters { 0 };
+};
+}
@@ -74,6 +74,19 @@ public:
     di::Expected<size_t, di::GenericCode> write_some(u64 offset, di::Span<di::Byte const>) const;
     di::Expected<size_t, di::GenericCode> write_some(di::Span<di::Byte const>) const;
 
+    /// @brief The most buffers which can be passed to read_some_vectored() or write_some_vectored().
+    constexpr static auto max_io_vectors = 16zu;
+
+    /// @brief Read into each of @p buffers in order, using a single system call.
+    ///
+    /// @return Returns an InvalidArgument error if more than max_io_vectors buffers are passed.
+    di::Expected<size_t, di::GenericCode> read_some_vectored(di::Span<di::Span<di::Byte> const> buffers) const;
+
+    /// @brief Write each of @p buffers in order, using a single system call.
+    ///
+    /// @return Returns an InvalidArgument error if more than max_io_vectors buffers are passed.
+    di::Expected<size_t, di::GenericCode> write_some_vectored(di::Span<di::Span<di::Byte const> const> buffers) const;
+
     di::Expected<void, di::GenericCode> read_exactly(u64 offset, di::Span<di::Byte>) const;
     di::Expected<void, di::GenericCode> read_exactly(di::Span<di::Byte>) const;
     di::Expected<void, di::GenericCode> write_exactly(u64 offset, di::Span<di::Byte const>) const;
@@ -0,0 +1,15 @@
+#include <dius/futex.h>
+#include <dius/system/system_call.h>
+#include <iris/uapi/futex.h>
+
+namespace dius {
+di::Result<void> futex_wait(u32 const* address, u32 expected_value) {
+    TRY(system::system_call<int>(system::Number::futex_wait, address, expected_value, iris::futex_wait_forever));
+    return {};
+}
+
+di::Result<void> futex_wake(u32 const* address, u32 count) {
+    TRY(system::system_call<u32>(system::Number::futex_wake, address, count));
+    return {};
+}
+}
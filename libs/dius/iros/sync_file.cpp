@@ -2,15 +2,52 @@
 #include <di/math/prelude.h>
 #include <dius/sync_file.h>
 #include <dius/system/system_call.h>
+#include <iris/uapi/io_vector.h>
 #include <iris/uapi/open.h>
 
 namespace dius {
-di::Expected<usize, di::GenericCode> sys_read(int fd, u64 offset, di::Span<byte> data) {
-    return system::system_call<usize>(system::Number::read, fd, data.data(), data.size(), offset);
+static_assert(SyncFile::max_io_vectors == iris::io_vector_max_count);
+
+di::Expected<usize, di::GenericCode> sys_read(int fd, di::Span<byte> data) {
+    return system::system_call<usize>(system::Number::read, fd, data.data(), data.size());
+}
+
+di::Expected<usize, di::GenericCode> sys_write(int fd, di::Span<byte const> data) {
+    return system::system_call<usize>(system::Number::write, fd, data.data(), data.size());
+}
+
+di::Expected<usize, di::GenericCode> sys_pread(int fd, u64 offset, di::Span<byte> data) {
+    return system::system_call<usize>(system::Number::pread, fd, data.data(), data.size(), offset);
 }
 
-di::Expected<usize, di::GenericCode> sys_write(int fd, u64 offset, di::Span<byte const> data) {
-    return system::system_call<usize>(system::Number::write, fd, data.data(), data.size(), offset);
+di::Expected<usize, di::GenericCode> sys_pwrite(int fd, u64 offset, di::Span<byte const> data) {
+    return system::system_call<usize>(system::Number::pwrite, fd, data.data(), data.size(), offset);
+}
+
+di::Expected<usize, di::GenericCode> sys_readv(int fd, di::Span<di::Span<byte> const> buffers) {
+    if (buffers.size() > iris::io_vector_max_count) {
+        return di::Unexpected(PosixError::InvalidArgument);
+    }
+
+    auto vectors = di::Array<iris::IoVector, iris::io_vector_max_count> {};
+    auto count = buffers.size();
+    for (auto i : di::range(count)) {
+        vectors[i] = { buffers[i].data(), buffers[i].size() };
+    }
+    return system::system_call<usize>(system::Number::readv, fd, vectors.data(), count);
+}
+
+di::Expected<usize, di::GenericCode> sys_writev(int fd, di::Span<di::Span<byte const> const> buffers) {
+    if (buffers.size() > iris::io_vector_max_count) {
+        return di::Unexpected(PosixError::InvalidArgument);
+    }
+
+    auto vectors = di::Array<iris::IoVector, iris::io_vector_max_count> {};
+    auto count = buffers.size();
+    for (auto i : di::range(count)) {
+        vectors[i] = { const_cast<byte*>(buffers[i].data()), buffers[i].size() };
+    }
+    return system::system_call<usize>(system::Number::writev, fd, vectors.data(), count);
 }
 
 di::Expected<void, di::GenericCode> sys_close(int fd) {
@@ -36,19 +73,27 @@ di::Expected<void, di::GenericCode> SyncFile::close() {
 }
 
 di::Expected<usize, di::GenericCode> SyncFile::read_some(di::Span<byte> data) const {
-    return sys_read(m_fd, di::NumericLimits<u64>::max, data);
+    return sys_read(m_fd, data);
 }
 
 di::Expected<usize, di::GenericCode> SyncFile::read_some(u64 offset, di::Span<byte> data) const {
-    return sys_read(m_fd, offset, data);
+    return sys_pread(m_fd, offset, data);
 }
 
 di::Expected<usize, di::GenericCode> SyncFile::write_some(di::Span<byte const> data) const {
-    return sys_write(m_fd, di::NumericLimits<u64>::max, data);
+    return sys_write(m_fd, data);
 }
 
 di::Expected<usize, di::GenericCode> SyncFile::write_some(u64 offset, di::Span<byte const> data) const {
-    return sys_write(m_fd, offset, data);
+    return sys_pwrite(m_fd, offset, data);
+}
+
+di::Expected<usize, di::GenericCode> SyncFile::read_some_vectored(di::Span<di::Span<byte> const> buffers) const {
+    return sys_readv(m_fd, buffers);
+}
+
+di::Expected<usize, di::GenericCode> SyncFile::write_some_vectored(di::Span<di::Span<byte const> const> buffers) const {
+    return sys_writev(m_fd, buffers);
 }
 
 di::Expected<void, di::GenericCode> SyncFile::resize_file(u64 size) const {
@@ -0,0 +1,19 @@
+#include <di/math/prelude.h>
+#include <dius/futex.h>
+#include <dius/system/system_call.h>
+#include <linux/futex.h>
+
+namespace dius {
+di::Result<void> futex_wait(u32 const* address, u32 expected_value) {
+    TRY(system::system_call<int>(system::Number::futex, address, FUTEX_WAIT_PRIVATE, expected_value, nullptr));
+    return {};
+}
+
+di::Result<void> futex_wake(u32 const* address, u32 count) {
+    // Linux reads the wake count as a signed int, so larger counts would wrap to negative values and wake only one
+    // waiter.
+    auto const linux_count = int(di::min(count, u32(di::NumericLimits<int>::max)));
+    TRY(system::system_call<int>(system::Number::futex, address, FUTEX_WAKE_PRIVATE, linux_count));
+    return {};
+}
+}
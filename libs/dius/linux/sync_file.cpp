@@ -4,6 +4,12 @@
 #include <dius/sync_file.h>
 #include <dius/system/system_call.h>
 
+#ifdef DIUS_USE_RUNTIME
+#include <linux/uio.h>
+#else
+#include <sys/uio.h>
+#endif
+
 namespace dius {
 di::Expected<usize, di::GenericCode> sys_read(int fd, di::Span<byte> data) {
     return system::system_call<usize>(system::Number::read, fd, data.data(), data.size());
@@ -21,6 +27,32 @@ di::Expected<usize, di::GenericCode> sys_pwrite(int fd, u64 offset, di::Span<byt
     return system::system_call<usize>(system::Number::pwrite, fd, data.data(), data.size(), offset);
 }
 
+di::Expected<usize, di::GenericCode> sys_readv(int fd, di::Span<di::Span<byte> const> buffers) {
+    if (buffers.size() > SyncFile::max_io_vectors) {
+        return di::Unexpected(PosixError::InvalidArgument);
+    }
+
+    auto vectors = di::Array<iovec, SyncFile::max_io_vectors> {};
+    auto count = buffers.size();
+    for (auto i : di::range(count)) {
+        vectors[i] = { buffers[i].data(), buffers[i].size() };
+    }
+    return system::system_call<usize>(system::Number::readv, fd, vectors.data(), count);
+}
+
+di::Expected<usize, di::GenericCode> sys_writev(int fd, di::Span<di::Span<byte const> const> buffers) {
+    if (buffers.size() > SyncFile::max_io_vectors) {
+        return di::Unexpected(PosixError::InvalidArgument);
+    }
+
+    auto vectors = di::Array<iovec, SyncFile::max_io_vectors> {};
+    auto count = buffers.size();
+    for (auto i : di::range(count)) {
+        vectors[i] = { const_cast<byte*>(buffers[i].data()), buffers[i].size() };
+    }
+    return system::system_call<usize>(system::Number::writev, fd, vectors.data(), count);
+}
+
 di::Expected<void, di::GenericCode> sys_close(int fd) {
     return system::system_call<int>(system::Number::close, fd) % di::into_void;
 }
@@ -71,6 +103,14 @@ di::Expected<usize, di::GenericCode> SyncFile::write_some(u64 offset, di::Span<b
     return sys_pwrite(m_fd, offset, data);
 }
 
+di::Expected<usize, di::GenericCode> SyncFile::read_some_vectored(di::Span<di::Span<byte> const> buffers) const {
+    return sys_readv(m_fd, buffers);
+}
+
+di::Expected<usize, di::GenericCode> SyncFile::write_some_vectored(di::Span<di::Span<byte const> const> buffers) const {
+    return sys_writev(m_fd, buffers);
+}
+
 di::Expected<void, di::GenericCode> SyncFile::resize_file(u64 new_size) const {
     return sys_ftruncate(file_descriptor(), new_size);
 }
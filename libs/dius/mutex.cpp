@@ -0,0 +1,22 @@
+#include <dius/mutex.h>
+
+namespace dius {
+/// The number of times to retry acquiring a contended lock before sleeping.
+constexpr static auto mutex_spin_count = 100u;
+
+void Mutex::lock_slow() {
+    auto state = di::AtomicRef(m_state);
+    for (auto i = 0u; i < mutex_spin_count; i++) {
+        if (state.load(di::MemoryOrder::Relaxed) == unlocked && try_lock()) {
+            return;
+        }
+        di::cpu_relax();
+    }
+
+    // Once marked as contended, the owner wakes a sleeping thread when unlocking. This thread cannot tell if others are
+    // sleeping, so it keeps the contended state even when it acquires the lock.
+    while (state.exchange(contended, di::MemoryOrder::Acquire) != unlocked) {
+        (void) futex_wait(&m_state, contended);
+    }
+}
+}
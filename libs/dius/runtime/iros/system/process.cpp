@@ -1,5 +1,6 @@
 #include <dius/system/process.h>
 #include <dius/system/system_call.h>
+#include <iris/uapi/create_task.h>
 
 namespace dius::system {
 di::Result<ProcessResult> Process::spawn_and_wait() && {
@@ -8,7 +9,7 @@ di::Result<ProcessResult> Process::spawn_and_wait() && {
                              }) |
                              di::to<di::Vector>();
 
-    auto tid = TRY(system_call<i32>(Number::create_task));
+    auto tid = TRY(system_call<i32>(Number::create_task, iris::CreateTaskFlags::None));
     TRY(system_call<i32>(Number::set_task_arguments, tid, arguments_as_view.data(), arguments_as_view.size(), nullptr,
                          0));
     TRY(system_call<i32>(Number::load_executable, tid, m_arguments[0].data(), m_arguments[0].size()));
@@ -3,6 +3,7 @@
 #include <dius/system/process.h>
 #include <dius/system/system_call.h>
 #include <dius/thread.h>
+#include <iris/uapi/create_task.h>
 
 namespace dius {
 di::Result<di::Box<PlatformThread, PlatformThreadDeleter>> PlatformThread::create(runtime::TlsInfo) {
@@ -47,7 +48,7 @@ di::Result<Thread> Thread::do_start(di::Function<void()> entry) {
 
     platform_thread->stack = stack.data();
 
-    auto id = TRY(system::system_call<int>(system::Number::create_task));
+    auto id = TRY(system::system_call<int>(system::Number::create_task, iris::CreateTaskFlags::None));
     platform_thread->thread_id = id;
 
     TRY(system::system_call<int>(system::Number::set_userspace_thread_pointer, id, platform_thread.get()));
@@ -0,0 +1,43 @@
+#include <di/sync/prelude.h>
+#include <dius/semaphore.h>
+
+namespace dius {
+/// The number of times to retry acquiring the semaphore before sleeping.
+constexpr static auto semaphore_spin_count = 100u;
+
+bool Semaphore::try_acquire() {
+    auto count = di::AtomicRef(m_count);
+    auto value = count.load(di::MemoryOrder::Relaxed);
+    while (value > 0) {
+        if (count.compare_exchange_weak(value, value - 1, di::MemoryOrder::Acquire, di::MemoryOrder::Relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Semaphore::acquire() {
+    for (auto i = 0u; i < semaphore_spin_count; i++) {
+        if (try_acquire()) {
+            return;
+        }
+        di::cpu_relax();
+    }
+
+    // Registering as a waiter before checking the count ensures that release() either sees the waiter or the count
+    // check sees the released count.
+    auto waiters = di::AtomicRef(m_waiters);
+    waiters.fetch_add(1, di::MemoryOrder::SequentialConsistency);
+    while (!try_acquire()) {
+        (void) futex_wait(&m_count, 0);
+    }
+    waiters.fetch_sub(1, di::MemoryOrder::Relaxed);
+}
+
+void Semaphore::release(u32 count) {
+    di::AtomicRef(m_count).fetch_add(count, di::MemoryOrder::SequentialConsistency);
+    if (di::AtomicRef(m_waiters).load(di::MemoryOrder::SequentialConsistency) > 0) {
+        (void) futex_wake(&m_count, count);
+    }
+}
+}
@@ -0,0 +1,139 @@
+#include <di/container/vector/prelude.h>
+#include <di/sync/prelude.h>
+#include <dius/condition_variable.h>
+#include <dius/mutex.h>
+#include <dius/semaphore.h>
+#include <dius/test/prelude.h>
+#include <dius/thread.h>
+
+namespace synchronization {
+constexpr auto thread_count = 4zu;
+constexpr auto iterations = 10000zu;
+
+static void mutex() {
+    auto mutex = dius::Mutex {};
+    auto counter = 0zu;
+
+    auto threads = di::Vector<dius::Thread> {};
+    for (auto i = 0zu; i < thread_count; i++) {
+        threads.push_back(*dius::Thread::create([&] {
+            for (auto j = 0zu; j < iterations; j++) {
+                auto guard = di::ScopedLock(mutex);
+                counter++;
+            }
+        }));
+    }
+    for (auto& thread : threads) {
+        ASSERT(thread.join());
+    }
+
+    ASSERT_EQ(counter, thread_count * iterations);
+    ASSERT(mutex.try_lock());
+    ASSERT(!mutex.try_lock());
+    mutex.unlock();
+}
+
+static void condition_variable() {
+    auto mutex = dius::Mutex {};
+    auto condition = dius::ConditionVariable {};
+    auto queue = di::Vector<usize> {};
+    auto done = false;
+    auto sum = 0zu;
+
+    auto consumer = *dius::Thread::create([&] {
+        auto guard = di::ScopedLock(mutex);
+        for (;;) {
+            condition.wait(mutex, [&] {
+                return done || !queue.empty();
+            });
+            while (auto value = queue.pop_back()) {
+                sum += *value;
+            }
+            if (done) {
+                return;
+            }
+        }
+    });
+
+    for (auto i = 1zu; i <= iterations; i++) {
+        auto guard = di::ScopedLock(mutex);
+        queue.push_back(i);
+        condition.notify_one();
+    }
+    {
+        auto guard = di::ScopedLock(mutex);
+        done = true;
+        condition.notify_all();
+    }
+    ASSERT(consumer.join());
+
+    ASSERT_EQ(sum, iterations * (iterations + 1) / 2);
+}
+
+static void condition_variable_notify_all() {
+    constexpr auto waiter_count = 3zu;
+
+    auto mutex = dius::Mutex {};
+    auto condition = dius::ConditionVariable {};
+    auto waiting = 0zu;
+    auto released = false;
+
+    auto waiters = di::Vector<dius::Thread> {};
+    for (auto i = 0zu; i < waiter_count; i++) {
+        waiters.push_back(*dius::Thread::create([&] {
+            auto guard = di::ScopedLock(mutex);
+            waiting++;
+            condition.wait(mutex, [&] {
+                return released;
+            });
+        }));
+    }
+
+    // Each waiter only drops the mutex once it has registered with the condition variable, so seeing every waiter
+    // counted while holding the mutex means they are all parked on it.
+    for (;;) {
+        auto guard = di::ScopedLock(mutex);
+        if (waiting == waiter_count) {
+            released = true;
+            condition.notify_all();
+            break;
+        }
+    }
+
+    for (auto& waiter : waiters) {
+        ASSERT(waiter.join());
+    }
+}
+
+static void semaphore() {
+    auto items = dius::Semaphore(0);
+    auto slots = dius::Semaphore(1);
+    auto value = 0zu;
+    auto sum = 0zu;
+
+    // The two semaphores hand a single value back and forth between the threads.
+    auto consumer = *dius::Thread::create([&] {
+        for (auto i = 0zu; i < iterations; i++) {
+            items.acquire();
+            sum += value;
+            slots.release();
+        }
+    });
+    for (auto i = 1zu; i <= iterations; i++) {
+        slots.acquire();
+        value = i;
+        items.release();
+    }
+    ASSERT(consumer.join());
+
+    ASSERT_EQ(sum, iterations * (iterations + 1) / 2);
+    ASSERT(slots.try_acquire());
+    ASSERT(!slots.try_acquire());
+    ASSERT(!items.try_acquire());
+}
+
+TEST(synchronization, mutex)
+TEST(synchronization, condition_variable)
+TEST(synchronization, condition_variable_notify_all)
+TEST(synchronization, semaphore)
+}